@@ -0,0 +1,316 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// host side encoder: gcode file => stream of binary frames (see BinaryProtocol.h) and text lines
+//
+// GCodeToBinary infile outfile
+//
+// simple G0/G1 lines (axis words and F only) are sent as binary frame (relative move in mm1000),
+// all other lines are passed as text => the controller answers each frame or line with "ok" or "error:"
+//
+// the current position is tracked to calculate the deltas,
+// lines which change the position in a way not known by the encoder (e.g. G28, G92, parameters) invalidate it
+//
+////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "../../Sketch/libraries/CNCLib/src/BinaryProtocol.h"
+
+////////////////////////////////////////////////////////
+
+#define NUM_AXIS	6
+#define MAXWORDS	32
+
+static const char _axisChars[NUM_AXIS+1] = "XYZABC";
+
+////////////////////////////////////////////////////////
+
+struct SWord
+{
+	char	Letter;
+	double	Value;
+};
+
+////////////////////////////////////////////////////////
+
+class CGCodeToBinary
+{
+public:
+
+	CGCodeToBinary(FILE* out)			{ _out = out; }
+
+	void Start()
+	{
+		uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+		WriteFrame(frame, CBinaryProtocol::BuildFrame(frame, _seq++, BINARYCMD_SYNC, NULL, 0));
+	}
+
+	void Line(const char* line)
+	{
+		_textBytes += strlen(line) + 1;
+		_lines++;
+
+		SWord words[MAXWORDS];
+		int count = 0;
+		bool simple = Scan(line, words, count);
+
+		if (simple && count > 0 && EncodeMove(words, count))
+			return;
+
+		// text line => update state (modal and position)
+
+		UpdateState(words, count, simple);
+		WriteText(line);
+	}
+
+	void PrintStatistics(FILE* out)
+	{
+		fprintf(out, "lines=%i binary=%i text=%i bytes: gcode=%li out=%li (%.0f%%)\n",
+			_lines, _frames, _lines - _frames, _textBytes, _outBytes, _textBytes ? 100.0 * _outBytes / _textBytes : 0.0);
+	}
+
+private:
+
+	FILE*	_out;
+	uint8_t	_seq = 0;
+
+	bool	_absolut = true;
+	bool	_inch = false;
+	int		_motion = 0;					// 0 => G0, 1 => G1, else not a linear move
+	bool	_known[NUM_AXIS] = { false };
+	int32_t	_pos[NUM_AXIS] = { 0 };		// mm1000
+
+	int		_lines = 0;
+	int		_frames = 0;
+	long	_textBytes = 0;
+	long	_outBytes = 0;
+
+	static int AxisIndex(char letter)
+	{
+		const char* axis = strchr(_axisChars, letter);
+		return axis && letter ? (int) (axis - _axisChars) : -1;
+	}
+
+	int32_t ToMm1000(double value)		{ return (int32_t) lround(value * (_inch ? 25400.0 : 1000.0)); }
+
+	// split line into words, return false if the line contains more than simple words (e.g. expressions, parameters)
+
+	static bool Scan(const char* line, SWord* words, int& count)
+	{
+		count = 0;
+
+		while (*line)
+		{
+			char ch = (char) toupper(*line);
+
+			if (isspace(ch))				{ line++; continue; }
+			if (ch == ';')					break;
+			if (ch == '(')
+			{
+				const char* end = strchr(line, ')');
+				if (end == NULL) break;
+				line = end + 1;
+				continue;
+			}
+			if (!isalpha(ch) || count >= MAXWORDS)
+				return false;
+
+			char* end;
+			double value = strtod(line + 1, &end);
+			if (end == line + 1)
+				return false;			// e.g. "#1" or "[..]" or "$"
+
+			words[count].Letter = ch;
+			words[count].Value = value;
+			count++;
+			line = end;
+		}
+
+		return true;
+	}
+
+	// G0/G1 with axis words (and F for G1) only
+
+	bool EncodeMove(const SWord* words, int count)
+	{
+		int motion = _motion;
+		bool hasFeed = false;
+		int32_t feedrate = 0;
+		uint8_t axes = 0;
+		int32_t delta[NUM_AXIS] = { 0 };
+		int32_t newpos[NUM_AXIS];
+
+		memcpy(newpos, _pos, sizeof(_pos));
+
+		for (int i = 0; i < count; i++)
+		{
+			char letter = words[i].Letter;
+			int axis = AxisIndex(letter);
+
+			if (letter == 'G' && (words[i].Value == 0.0 || words[i].Value == 1.0))
+				motion = (int) words[i].Value;
+			else if (letter == 'F' && !hasFeed)
+			{
+				hasFeed = true;
+				feedrate = ToMm1000(words[i].Value);
+			}
+			else if (letter == 'N')
+				;
+			else if (axis >= 0 && (axes & (1 << axis)) == 0)
+			{
+				int32_t value = ToMm1000(words[i].Value);
+
+				if (_absolut)
+				{
+					if (!_known[axis])
+						return false;			// send as text => position is known afterwards
+					delta[axis] = value - _pos[axis];
+				}
+				else
+					delta[axis] = value;
+
+				newpos[axis] = _pos[axis] + delta[axis];
+				axes |= 1 << axis;
+			}
+			else
+				return false;
+		}
+
+		if (motion != 0 && motion != 1)			return false;
+		if (hasFeed && motion == 0)				return false;		// error of the controller => keep the text
+		if (axes == 0 && !hasFeed)				return false;
+
+		uint8_t data[32];
+		uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+		uint8_t length = CBinaryProtocol::BuildMove(data, motion == 0, axes, NUM_AXIS, delta, hasFeed, feedrate);
+		WriteFrame(frame, CBinaryProtocol::BuildFrame(frame, _seq++, BINARYCMD_MOVE, data, length));
+
+		_motion = motion;
+		memcpy(_pos, newpos, sizeof(_pos));
+		_frames++;
+		return true;
+	}
+
+	void UpdateState(const SWord* words, int count, bool simple)
+	{
+		bool positionUnknown = !simple;
+
+		for (int i = 0; i < count; i++)
+		{
+			if (words[i].Letter != 'G')
+				continue;
+
+			double g = words[i].Value;
+
+			if (g == 90.0)						_absolut = true;
+			else if (g == 91.0)					_absolut = false;
+			else if (g == 20.0)					_inch = true;
+			else if (g == 21.0)					_inch = false;
+			else if (g == 0.0 || g == 1.0 || g == 2.0 || g == 3.0)	_motion = (int) g;
+			else if (g == 80.0)					_motion = -1;
+			else if (g == 4.0 || g == 17.0 || g == 18.0 || g == 19.0 || g == 61.0 || g == 64.0 || g == 94.0) {}
+			else								positionUnknown = true;			// G28, G53, G92, probe, canned cycles, ...
+		}
+
+		if (positionUnknown)
+		{
+			for (int axis = 0; axis < NUM_AXIS; axis++)
+				_known[axis] = false;
+			return;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			int axis = AxisIndex(words[i].Letter);
+			if (axis < 0)
+				continue;
+
+			int32_t value = ToMm1000(words[i].Value);
+
+			if (_absolut)
+			{
+				_pos[axis] = value;
+				_known[axis] = true;
+			}
+			else
+				_pos[axis] += value;
+		}
+	}
+
+	void WriteFrame(const uint8_t* frame, uint8_t size)
+	{
+		fwrite(frame, 1, size, _out);
+		_outBytes += size;
+	}
+
+	void WriteText(const char* line)
+	{
+		fputs(line, _out);
+		fputc('\n', _out);
+		_outBytes += strlen(line) + 1;
+	}
+};
+
+////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s infile outfile\n", argv[0]);
+		return 1;
+	}
+
+	FILE* in = fopen(argv[1], "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	FILE* out = fopen(argv[2], "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "cannot create %s\n", argv[2]);
+		fclose(in);
+		return 1;
+	}
+
+	CGCodeToBinary encoder(out);
+	encoder.Start();
+
+	char line[256];
+	while (fgets(line, sizeof(line), in))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		encoder.Line(line);
+	}
+
+	encoder.PrintStatistics(stderr);
+
+	fclose(in);
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#include <stdarg.h>
+#include <errno.h>
+
+#include "Arduino.h"
+
+////////////////////////////////////////////////////////
+
+uint8_t SREG = 0x80;
+
+#define MAXDIGITALREADPINS 256
+
+static uint8_t digitalReadValues[MAXDIGITALREADPINS] = { LOW };
+
+std::function<uint8_t(short)> digitalReadEvent = NULL;
+
+uint8_t digitalRead(short pin)
+{
+	uint8_t value = DIGITALREADNOVALUE;
+
+	if (digitalReadEvent != NULL)
+		value = digitalReadEvent(pin);
+
+	if (value == DIGITALREADNOVALUE && pin >= 0 && pin < MAXDIGITALREADPINS)
+		value = digitalReadValues[pin];
+
+	if (value == DIGITALREADNOVALUE)
+		value = LOW;
+
+	if (pin >= 0 && pin < MAXDIGITALREADPINS)
+	{
+		// remember last value
+		digitalReadValues[pin] = value;
+	}
+
+	return value;
+}
+
+////////////////////////////////////////////////////////
+
+static char* ultoa_(unsigned long value, char* str, int base, bool negative)
+{
+	char tmp[sizeof(unsigned long) * 8 + 2];
+	char* p = tmp;
+
+	do
+	{
+		int digit = (int)(value % base);
+		*(p++) = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+		value /= base;
+	}
+	while (value != 0);
+
+	char* dest = str;
+	if (negative)
+		*(dest++) = '-';
+
+	while (p != tmp)
+		*(dest++) = *(--p);
+
+	*dest = 0;
+	return str;
+}
+
+char* ultoa(unsigned long value, char* str, int base)
+{
+	return ultoa_(value, str, base, false);
+}
+
+char* ltoa(long value, char* str, int base)
+{
+	if (value < 0 && base == 10)
+		return ultoa_((unsigned long)(-value), str, base, true);
+	return ultoa_((unsigned long)value, str, base, false);
+}
+
+char* itoa(int value, char* str, int base)
+{
+	return ltoa(value, str, base);
+}
+
+////////////////////////////////////////////////////////
+
+static uint64_t _virtualTime = 0;
+
+std::function<void(uint64_t)> virtualDelayEvent = NULL;
+
+uint64_t GetVirtualTime()
+{
+	return _virtualTime;
+}
+
+void SetVirtualTime(uint64_t ns)
+{
+	_virtualTime = ns;
+}
+
+static void VirtualDelay(uint64_t ns)
+{
+	uint64_t until = _virtualTime + ns;
+
+	if (virtualDelayEvent != NULL)
+		virtualDelayEvent(until);
+
+	if (_virtualTime < until)
+		_virtualTime = until;
+}
+
+void delay(unsigned long ms)
+{
+	VirtualDelay(ms * 1000000ull);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	VirtualDelay(us * 1000ull);
+}
+
+////////////////////////////////////////////////////////
+
+void Stream::printf_(const char* format, ...)
+{
+	char buffer[128];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (len > 0)
+		write(buffer, len < (int) sizeof(buffer) ? len : sizeof(buffer) - 1);
+}
+
+////////////////////////////////////////////////////////
+
+HardwareSerial::HardwareSerial()
+{
+	_fd = STDIN_FILENO;
+	_out = stdout;
+	_eof = false;
+	_echo = false;
+	_bufferIdx = _bufferCount = 0;
+}
+
+HardwareSerial::~HardwareSerial()
+{
+	if (_fd != STDIN_FILENO)
+		close(_fd);
+}
+
+bool HardwareSerial::OpenInput(const char* filename)
+{
+	int fd = open(filename, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return false;
+
+	SetInput(fd);
+	return true;
+}
+
+void HardwareSerial::SetInput(int fd)
+{
+	if (_fd != STDIN_FILENO && _fd != fd)
+		close(_fd);
+
+	_fd = fd;
+	_eof = false;
+	_bufferIdx = _bufferCount = 0;
+}
+
+void HardwareSerial::write(const char* s, size_t len)
+{
+	if (_out != NULL)
+		fwrite(s, 1, len, _out);
+}
+
+bool HardwareSerial::Fill(int timeoutms)
+{
+	if (_bufferIdx < _bufferCount)
+		return true;
+
+	if (_eof || _fd < 0)
+		return false;
+
+	struct pollfd pfd;
+	pfd.fd = _fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	if (poll(&pfd, 1, timeoutms) <= 0)
+		return false;
+
+	ssize_t cnt = ::read(_fd, _buffer, sizeof(_buffer));
+	if (cnt < 0 && (errno == EAGAIN || errno == EINTR))
+		return false;
+
+	if (cnt <= 0)
+	{
+		// end of file or closed pipe
+		_eof = true;
+		return false;
+	}
+
+	_bufferIdx = 0;
+	_bufferCount = (int) cnt;
+	return true;
+}
+
+int HardwareSerial::available()
+{
+	if (Fill(0))
+		return _bufferCount - _bufferIdx;
+
+	if (_pIdle) _pIdle();
+	return 0;
+}
+
+char HardwareSerial::read()
+{
+	if (!Fill(-1))
+		return (char) -1;
+
+	char ch = _buffer[_bufferIdx++];
+
+	if (_echo)
+		write(ch);
+
+	return ch;
+}
@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// Arduino emulation for a Linux host (see HAL_Linux.h)
+// time is virtual: millis() and micros() are driven by the simulated timers
+//
+////////////////////////////////////////////////////////
+
+#pragma once
+
+// the posix "timer_t" and the gnu "error_t" collide with the types of the StepperLib
+// => include all system headers with renamed types before the StepperLib defines its own
+
+#define timer_t posix_timer_t
+#define error_t posix_error_t
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#undef timer_t
+#undef error_t
+
+// arduino: min/max are macros (mixed types allowed)
+
+template<typename T1, typename T2> inline typename std::common_type<T1, T2>::type min(T1 a, T2 b) { return (b < a) ? b : a; }
+template<typename T1, typename T2> inline typename std::common_type<T1, T2>::type max(T1 a, T2 b) { return (a < b) ? b : a; }
+
+#define OUTPUT 1
+#define INPUT_PULLUP 1
+#define INPUT 2
+#define LOW 0
+#define HIGH 1
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define INTERNAL 3
+#define DEFAULT 1
+#define EXTERNAL 0
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+
+#define NOT_AN_INTERRUPT -1
+
+#define ISR(a) void a(void)
+
+#define __FlashStringHelper char
+
+#define strcpy_P(a,b) strcpy(a,b)
+#define strcat_P(a,b) strcat(a,b)
+#define strcmp_P(a,b) strcmp(a,b)
+#define strcasecmp_P(a,b) strcasecmp(a,b)
+#define _stricmp(a,b) strcasecmp(a,b)
+
+#define memcpy_P(a,b,c) memcpy(a,b,c)
+
+#define eeprom_read_block(a,b,c) memcpy(a,b,c)
+#define eeprom_write_block(a,b,c) memcpy(b,a,c)
+
+inline void eeprom_write_dword(uint32_t *  __p, uint32_t  	__value) { *__p = __value;  }
+inline uint32_t eeprom_read_dword(const uint32_t * __p) { return *__p;  }
+inline uint8_t eeprom_read_byte(const uint8_t * __p) { return *__p; }
+
+#define F(a) a
+#define PSTR(a) a
+#define PROGMEM
+typedef  const char* PGM_P;
+
+inline char pgm_read_byte(const char* p) { return *p; }
+inline uint32_t pgm_read_dword(const void* p) { return *(const uint32_t*)p; }
+inline unsigned short pgm_read_word(const void* p) { return *(const unsigned short*)p; }
+inline uint8_t pgm_read_byte(const void* p) { return *(const uint8_t*)p; }
+inline const void* pgm_read_ptr(const void* p) { return *((void * const*) p); }
+
+inline void attachInterrupt(uint8_t, void(*)(), int /* mode */) {};
+inline void detachInterrupt(uint8_t) {};
+
+inline uint8_t digitalPinToInterrupt(uint8_t p) { return ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT)); }
+
+inline void analogWrite(short, int)	{};
+inline int analogRead(short) { return 0; };
+inline void digitalWrite(short, short)	{};
+extern uint8_t digitalRead(short pin);
+inline void pinMode(short, short)		{};
+
+#define DIGITALREADNOVALUE 255
+extern std::function<uint8_t(short)> digitalReadEvent;
+
+#define LED_BUILTIN (13)
+
+#define PIN_A0   (14)
+#define PIN_A1   (15)
+#define PIN_A2   (16)
+#define PIN_A3   (17)
+#define PIN_A4   (18)
+#define PIN_A5   (19)
+#define PIN_A6   (20)
+#define PIN_A7   (21)
+
+static const uint8_t A0 = PIN_A0;
+
+extern uint8_t SREG;
+
+extern char* itoa(int value, char* str, int base);
+extern char* ltoa(long value, char* str, int base);
+extern char* ultoa(unsigned long value, char* str, int base);
+
+////////////////////////////////////////////////////////
+// virtual time, resolution 1ns
+// see CHAL::InitTimer1OneShot: a delay executes the simulated timer events
+
+extern uint64_t GetVirtualTime();
+extern void SetVirtualTime(uint64_t ns);
+extern std::function<void(uint64_t)> virtualDelayEvent;	// advance the virtual time to "ns" and execute pending events
+
+inline unsigned long millis() { return (unsigned long) (GetVirtualTime() / 1000000ull); }
+inline unsigned long micros() { return (unsigned long) (GetVirtualTime() / 1000ull); }
+
+extern void delay(unsigned long ms);
+extern void delayMicroseconds(unsigned int us);
+
+////////////////////////////////////////////////////////
+
+#define STDIO 0
+#define DEC 10
+#define HEX 16
+
+class Stream
+{
+public:
+
+	virtual ~Stream() {}
+
+	void SetIdle(void(*pIdle)())	{ _pIdle = pIdle;  }
+
+	void print(char c)				{ printf_("%c", c); };
+	void print(unsigned int ui)		{ printf_("%u", ui); };
+	void print(int i)				{ printf_("%i", i); };
+	void print(long l)				{ printf_("%li", l); };
+	void print(unsigned long ul)	{ printf_("%lu", ul); };
+	void print(unsigned long ul, uint8_t base)
+	{
+		if (base == 10) printf_("%lu", ul);
+		if (base == 16) printf_("%lx", ul);
+	}
+	void print(const char*s)		{ printf_("%s", s); };
+	void print(float f)				{ printf_("%f", f); };
+	void print(double f)			{ printf_("%f", f); };
+
+	void println()					{ print('\n'); };
+	template<typename T> void println(T v)	{ print(v); println(); }
+	void println(unsigned long ul, uint8_t base) { print(ul, base); println(); };
+
+	void begin(long )				{ };
+
+	virtual void write(const char* s, size_t len) = 0;
+	void write(char c)				{ write(&c, 1); }
+
+	virtual int available()	= 0;
+	virtual char read() = 0;
+
+protected:
+
+	void printf_(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+	void(*_pIdle)() = NULL;
+};
+
+////////////////////////////////////////////////////////
+// Serial: read from a file descriptor (stdin, file or pipe), write to a FILE (default stdout)
+
+class HardwareSerial : public Stream
+{
+public:
+
+	HardwareSerial();
+	~HardwareSerial();
+
+	bool OpenInput(const char* filename);		// e.g. gcode file or named pipe
+	void SetInput(int fd);
+	void SetOutput(FILE* f)				{ _out = f; }
+	void SetEcho(bool echo)				{ _echo = echo; }
+
+	bool IsEOF() const					{ return _eof && _bufferIdx >= _bufferCount; }
+
+	virtual void write(const char* s, size_t len) override;
+	using Stream::write;
+
+	virtual int available() override;
+	virtual char read() override;
+
+private:
+
+	bool Fill(int timeoutms);
+
+	int		_fd;
+	FILE*	_out;
+	bool	_eof;
+	bool	_echo;
+
+	char	_buffer[512];
+	int		_bufferIdx;
+	int		_bufferCount;
+};
+
+class CSerial : public HardwareSerial
+{
+};
+
+extern CSerial Serial;
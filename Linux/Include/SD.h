@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// SD emulation for a Linux host: no card inserted
+// (CNCLibEx compiles and runs without print from SD, see VS/Arduino.VC/Include/SD.h for a file system emulation)
+//
+////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////////
+
+#define FILE_READ 1
+#define FILE_WRITE 2
+
+////////////////////////////////////////////////////////////
+
+class File : public Stream
+{
+public:
+
+	operator bool()								{ return false; }
+
+	virtual void write(const char* , size_t ) override	{ }
+	virtual int available() override			{ return 0; }
+	virtual char read() override				{ return 0; }
+
+	void close()								{ }
+	unsigned long size()						{ return 0; }
+	char* name()								{ return (char*) ""; }
+	bool isDirectory()							{ return false; }
+	File openNextFile()							{ return File(); }
+	void rewindDirectory()						{ }
+
+	bool seek(unsigned long )					{ return false; }
+	unsigned long position()					{ return 0; }
+};
+
+////////////////////////////////////////////////////////////
+
+class SDClass
+{
+public:
+
+	bool begin(uint8_t )						{ return false; }
+
+	File open(const char* , uint8_t = FILE_READ)	{ return File(); }
+	bool remove(const char* )					{ return false; }
+	bool exists(const char* )					{ return false; }
+	bool mkdir(const char* )					{ return false; }
+};
+
+inline SDClass SD;
+
+////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include "LinuxStepper.h"
+
+////////////////////////////////////////////////////////////
+
+CLinuxStepper::CLinuxStepper()
+{
+	_isReferenceMove = false;
+	_isReferenceId = 0;
+	_referenceMoveSteps = 0;
+	_stepEvents = 0;
+	_firstStepTime = _lastStepTime = 0;
+
+	memset(_level, 0, sizeof(_level));
+	memset(_stepPosition, 0, sizeof(_stepPosition));
+	memset(_stepCount, 0, sizeof(_stepCount));
+}
+
+////////////////////////////////////////////////////////////
+
+void CLinuxStepper::OnWait(EnumAsByte(EWaitType) wait)
+{
+	super::OnWait(wait);
+
+	// advance the virtual time to the next timer1 ISR
+
+	if (!CHAL::RunNextTimer1())
+		delay(1);
+}
+
+////////////////////////////////////////////////////////////
+
+void CLinuxStepper::HandleIdle()
+{
+	// waiting for input => time goes on (step ISR and timer0)
+	delay(1);
+}
+
+////////////////////////////////////////////////////////////
+
+uint8_t CLinuxStepper::GetReferenceValue(uint8_t referenceid)
+{
+	uint8_t refhitvalue = _pod._referenceHitValue[referenceid];
+	uint8_t refoffvalue = _pod._referenceHitValue[referenceid] == LOW ? HIGH : LOW;
+
+	if (!_isReferenceMove || referenceid != _isReferenceId)
+	{
+		return refoffvalue;
+	}
+
+	_referenceMoveSteps++;
+
+	return (_referenceMoveSteps / 16) % 2 == 0 ? refhitvalue : refoffvalue;
+}
+
+////////////////////////////////////////////////////////////
+
+bool CLinuxStepper::MoveReference(axis_t axis, uint8_t referenceid, bool toMin, steprate_t vMax, sdist_t maxdist, sdist_t distToRef, sdist_t distIfRefIsOn)
+{
+	_referenceMoveSteps = 15;
+	_isReferenceMove = true;
+	_isReferenceId = referenceid;
+	bool ret = super::MoveReference(axis, referenceid, toMin, vMax, maxdist, distToRef, distIfRefIsOn);
+	_isReferenceMove = false;
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+
+void CLinuxStepper::Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp)
+{
+	uint64_t now = GetVirtualTime();
+
+	if (_stepEvents++ == 0)
+		_firstStepTime = now;
+	_lastStepTime = now;
+
+	for (axis_t axis = 0; axis < NUM_AXIS; axis++)
+	{
+		_stepCount[axis] += steps[axis];
+		if ((directionUp & (1 << axis)) != 0)
+			_stepPosition[axis] += steps[axis];
+		else
+			_stepPosition[axis] -= steps[axis];
+	}
+}
+
+////////////////////////////////////////////////////////////
+
+void CLinuxStepper::InitTest()
+{
+	Init();
+
+	SetDefaultMaxSpeed(5000, 100, 150);
+	ContinueMove();
+
+	for (axis_t x = 0; x < NUM_AXIS; x++)
+	{
+		SetJerkSpeed(x, 500);
+		SetPosition(x, 0);
+	}
+
+	_stepEvents = 0;
+	_firstStepTime = _lastStepTime = 0;
+	memset(_stepPosition, 0, sizeof(_stepPosition));
+	memset(_stepCount, 0, sizeof(_stepCount));
+
+	SetWaitConditional(false);
+}
+
+////////////////////////////////////////////////////////////
+
+void CLinuxStepper::EndTest()
+{
+	OptimizeMovementQueue(true);
+	WaitBusy();
+}
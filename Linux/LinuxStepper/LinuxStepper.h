@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+#include <StepperLib.h>
+
+////////////////////////////////////////////////////////
+// Stepper for the linux host (virtual time, see HAL_Linux.h)
+//
+// the timer1 ISR (HandleInterrupt => StepRequest) is called while waiting (OnWait, delay, idle)
+// the steps are counted, the time between the first and the last step is measured in virtual time
+
+class CLinuxStepper : public CStepper
+{
+private:
+
+	typedef CStepper super;
+
+public:
+
+	CLinuxStepper();
+
+	virtual void OnWait(EnumAsByte(EWaitType) wait) override;
+
+	virtual uint8_t GetReferenceValue(uint8_t referenceId) override;
+	virtual bool IsAnyReference() override { return GetReferenceValue(0) == _pod._referenceHitValue[0]; };
+
+	virtual bool MoveReference(axis_t axis, uint8_t referenceid, bool toMin, steprate_t vMax, sdist_t maxdist, sdist_t distToRef, sdist_t distIfRefIsOn) override;
+
+	void MoveRel3(sdist_t dX, sdist_t dY, sdist_t dZ, steprate_t vMax = 0)	{ MoveRelEx(vMax, X_AXIS, dX, Y_AXIS, dY, Z_AXIS, dZ, -1); }
+	void MoveAbs3(udist_t X, udist_t Y, udist_t Z, steprate_t vMax = 0)		{ MoveAbsEx(vMax, X_AXIS, X, Y_AXIS, Y, Z_AXIS, Z, -1); }
+
+protected:
+
+	virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override;
+
+	virtual void SetEnable(axis_t axis, uint8_t level, bool /* force */) override	{ _level[axis] = level; };
+	virtual uint8_t GetEnable(axis_t axis) override									{ return _level[axis]; }
+
+public:
+
+	// Test extensions
+
+	void InitTest();
+	void EndTest();
+
+	void HandleIdle();											// call ISR while waiting for serial input (Serial.SetIdle)
+
+	sdist_t  GetStepPosition(axis_t axis) const					{ return _stepPosition[axis]; }
+	uint32_t GetStepCount(axis_t axis) const						{ return _stepCount[axis]; }
+	uint32_t GetStepEvents() const								{ return _stepEvents; }		// calls of Step()
+	uint64_t GetMoveTime() const								{ return _lastStepTime - _firstStepTime; }	// ns, virtual time first to last step
+
+private:
+
+	uint8_t  _level[NUM_AXIS];
+
+	sdist_t  _stepPosition[NUM_AXIS];
+	uint32_t _stepCount[NUM_AXIS];
+	uint32_t _stepEvents;
+
+	uint64_t _firstStepTime;
+	uint64_t _lastStepTime;
+
+	bool	 _isReferenceMove;
+	uint8_t	 _isReferenceId;
+	int		 _referenceMoveSteps;
+};
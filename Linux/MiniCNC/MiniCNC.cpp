@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// MiniCNC on a linux host
+//
+// MiniCNC [-e eepromfile] [gcodefile|pipe]
+//
+// serial input is read from the file (or stdin), output is written to stdout
+// the program terminates at end of input (after all movements are finished)
+//
+////////////////////////////////////////////////////////
+
+#include <math.h>
+
+#include "../LinuxStepper/LinuxStepper.h"
+#include <GCodeParserBase.h>
+#include "MyControl.h"
+
+CSerial Serial;
+
+static void setup();
+static void loop();
+static void Idle();
+
+CLinuxStepper MyStepper;
+class CStepper& Stepper = MyStepper;
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+		{
+			CHAL::SetEepromFilename(argv[++i]);
+		}
+		else if (!Serial.OpenInput(argv[i]))
+		{
+			fprintf(stderr, "cannot open %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);		// send each line (e.g. "ok") immediately to a pipe
+
+	digitalReadEvent = [](short pin) -> uint8_t
+	{
+		switch (pin)
+		{
+#ifdef KILL_PIN
+			case KILL_PIN: return KILL_PIN_ON == LOW ? HIGH : LOW;
+#endif
+		}
+		return DIGITALREADNOVALUE;
+	};
+
+	setup();
+
+	while (!CGCodeParserBase::_exit)
+	{
+		loop();
+	}
+
+	MyStepper.EndTest();
+
+	return 0;
+}
+
+void setup()
+{
+	MyStepper.InitTest();
+	Serial.SetIdle(Idle);
+}
+
+void loop()
+{
+	Control.Run();
+}
+
+static void Idle()
+{
+	MyStepper.HandleIdle();
+
+	if (Serial.IsEOF() && !MyStepper.IsBusy())
+	{
+#ifdef USE_BLOCKQUEUE
+		if (!CMotionControlBase::GetInstance()->IsBlockQueueEmpty())
+			return;
+#endif
+#ifdef USE_REALTIMECOMMAND
+		if (!Control.IsLookaheadEmpty())
+			return;
+#endif
+		CGCodeParserBase::_exit = true;
+	}
+}
@@ -0,0 +1,442 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// ISR cost benchmark: replay move mixes and measure StepOut, CalcNextSteps and OptimizeMovementQueue
+//
+// StepperBenchmark [-q] [-r repeat] [-o jsonfile]
+//
+// "step" is one timer ISR (one entry of the step buffer)
+// the cycles for AVR/SAM are estimated: host cycles (calibrated) * platform factor
+//
+// max_step_rate is measured: the mix is replayed with the cost of each StepOut, CalcNextSteps and OptimizeMovementQueue
+// added to the virtual time (host, AVR or SAM), the max speed is raised until the steps are late (step buffer runs empty)
+//
+////////////////////////////////////////////////////////
+
+#include <math.h>
+
+#include "../LinuxStepper/LinuxStepper.h"
+
+CSerial Serial;
+HardwareSerial& StepperSerial = Serial;
+
+////////////////////////////////////////////////////////
+
+#define AVR_MHZ					16.0
+#define SAM_MHZ					84.0
+
+#define AVR_CYCLEFACTOR			10.0	// 8 bit ALU, 16/32 bit arithmetic, no barrel shifter, IPC 1 <=> superscalar 64 bit host
+#define SAM_CYCLEFACTOR			2.5		// cortex m3: 32 bit, hardware divide, IPC <= 1
+
+#define AVR_ISROVERHEAD			80		// cycles: push/pop registers, timer reload
+#define SAM_ISROVERHEAD			40
+
+#define MAXSTEPRATE				((steprate_t)min((unsigned long)STEPRATE_MAX, (unsigned long)SPEED_MULTIPLIER_7))	// 7 steps each ISR
+
+////////////////////////////////////////////////////////
+
+static uint64_t NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////
+
+class CBenchmarkStepper : public CLinuxStepper
+{
+private:
+
+	typedef CLinuxStepper super;
+
+public:
+
+	enum ESection
+	{
+		SectionStepOut = ProfileStepOut,
+		SectionCalcNextSteps = ProfileCalcNextSteps,
+		SectionOptimizeMovementQueue = ProfileSectionCount,
+		SectionCount
+	};
+
+	struct SSection
+	{
+		uint64_t Ns;
+		uint64_t Calls;
+		uint64_t Steps;
+	};
+
+	SSection Sections[SectionCount];
+	uint64_t MeasureOverheadNs;
+	double	 CostNs[SectionCount];								// virtual time of StepOut (per call), CalcNextSteps (per step) and OptimizeMovementQueue (per call), 0 => no cost
+
+	CBenchmarkStepper()											{ MeasureOverheadNs = 0; _isrNs = 0; ResetSections(); NoCost(); }
+
+	void NoCost()												{ for (uint8_t i = 0; i < SectionCount; i++) CostNs[i] = 0; }
+
+	void ResetSections()										{ memset(Sections, 0, sizeof(Sections)); }
+
+	virtual void OptimizeMovementQueue(bool force) override
+	{
+		Begin(SectionOptimizeMovementQueue);
+		super::OptimizeMovementQueue(force);
+		End(SectionOptimizeMovementQueue, GetOptimizedMovements());
+	}
+
+protected:
+
+	virtual void ProfileBegin(EnumAsByte(EProfileSection) section) override				{ Begin(section); }
+	virtual void ProfileEnd(EnumAsByte(EProfileSection) section, uint8_t steps) override	{ End(section, steps); }
+
+private:
+
+	uint64_t _start[SectionCount];
+	uint64_t _isrNs;											// sum of the cost of the ISR (virtual time)
+
+	void Begin(uint8_t section)									{ _start[section] = NowNs(); }
+	void End(uint8_t section, uint8_t steps)
+	{
+		uint64_t ns = NowNs() - _start[section];
+		Sections[section].Ns += ns > MeasureOverheadNs ? ns - MeasureOverheadNs : 0;
+		Sections[section].Calls++;
+		Sections[section].Steps += steps;
+
+		uint64_t cost = (uint64_t)(section == SectionCalcNextSteps ? CostNs[section] * steps : CostNs[section]);
+		if (cost == 0)
+			return;
+
+		if (section == SectionOptimizeMovementQueue)
+		{
+			RunMainLoop(cost);
+		}
+		else
+		{
+			SetVirtualTime(GetVirtualTime() + cost);		// the next timer ISR is late if the cost exceeds the step period
+			_isrNs += cost;
+		}
+	}
+
+	void RunMainLoop(uint64_t cost)
+	{
+		// the main loop is interrupted by the ISR => done after "cost" without the time of the ISR
+		while (cost > 0)
+		{
+			uint64_t start = GetVirtualTime();
+			uint64_t isrNs = _isrNs;
+			CHAL::RunVirtualTimer(start + cost);
+			uint64_t done = (GetVirtualTime() - start) - (_isrNs - isrNs);
+			cost = done >= cost ? 0 : cost - done;
+		}
+	}
+};
+
+CBenchmarkStepper Stepper;
+
+////////////////////////////////////////////////////////
+// move mixes
+
+static bool _quick = false;
+
+static steprate_t _vMax;								// max speed of the mix (acc/dec scaled)
+static steprate_t _acc;
+static steprate_t _dec;
+
+static void SetDefaultMaxSpeed()
+{
+	Stepper.SetDefaultMaxSpeed(_vMax, _acc, _dec);
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+		Stepper.SetMaxSpeed(i, _vMax);
+}
+
+static void MixCruise()
+{
+	// long moves, mostly constant speed
+	SetDefaultMaxSpeed();
+	for (int i = 0; i < (_quick ? 2 : 10); i++)
+	{
+		Stepper.MoveRel3(40000, 20000, 0);
+		Stepper.MoveRel3(-40000, -20000, 0);
+	}
+}
+
+static void MixSegments()
+{
+	// circle with many tiny segments (CAM output)
+	SetDefaultMaxSpeed();
+	const int segments = 360;
+	const double radius = 4000;
+	udist_t x0 = 10000;
+	udist_t y0 = 10000;
+
+	Stepper.MoveAbs3(x0 + (udist_t)radius, y0, 0);
+
+	for (int loop = 0; loop < (_quick ? 1 : 4); loop++)
+	{
+		for (int i = 1; i <= segments; i++)
+		{
+			double rad = 2.0 * M_PI * i / segments;
+			Stepper.MoveAbs3(x0 + (udist_t)lround(radius * cos(rad)), y0 + (udist_t)lround(radius * sin(rad)), 0);
+		}
+	}
+}
+
+static void MixHighSpeed()
+{
+	// fast moves => step multiplier
+	SetDefaultMaxSpeed();
+	for (int i = 0; i < (_quick ? 2 : 10); i++)
+	{
+		Stepper.MoveRel3(100000, 30000, 1000);
+		Stepper.MoveRel3(-100000, -30000, -1000);
+	}
+}
+
+static void MixZigZag()
+{
+	// short moves with direction change (jerk)
+	SetDefaultMaxSpeed();
+	for (int i = 0; i < (_quick ? 50 : 400); i++)
+	{
+		Stepper.MoveRel3(800, 100, 0);
+		Stepper.MoveRel3(-800, 100, 0);
+	}
+}
+
+struct SMix
+{
+	const char* Name;
+	void(*Run)();
+	steprate_t VMax;
+	steprate_t Acc;
+	steprate_t Dec;
+};
+
+static const SMix _mixes[] =
+{
+	{ "cruise", MixCruise, 8000, 400, 450 },
+	{ "segments", MixSegments, 8000, 400, 450 },
+	{ "highspeed", MixHighSpeed, 45000, 2000, 2200 },
+	{ "zigzag", MixZigZag, 8000, 400, 450 },
+};
+
+static void SetMixSpeed(const SMix& mix, steprate_t vMax)
+{
+	// same ramp (time) as with the default speed of the mix
+	_vMax = vMax;
+	_acc = (steprate_t)max(1.0, (double)mix.Acc * vMax / mix.VMax);
+	_dec = (steprate_t)max(1.0, (double)mix.Dec * vMax / mix.VMax);
+}
+
+static uint64_t RunMix(const SMix& mix)
+{
+	Stepper.InitTest();
+	Stepper.ResetSections();
+	mix.Run();
+	Stepper.EndTest();
+	return Stepper.GetMoveTime();
+}
+
+////////////////////////////////////////////////////////
+
+static double CalibrateHostGHz()
+{
+	// dependent add chain => about 1 cycle per loop
+	const uint64_t loops = 200000000ull;
+	uint64_t x = 0;
+	uint64_t start = NowNs();
+	for (uint64_t i = 0; i < loops; i++)
+	{
+		x += i;
+		__asm__ volatile("" : "+r"(x));
+	}
+	uint64_t ns = NowNs() - start;
+	return (double)loops / (double)ns;
+}
+
+static uint64_t CalibrateMeasureOverhead()
+{
+	const int loops = 1000000;
+	uint64_t start = NowNs();
+	for (int i = 0; i < loops; i++)
+	{
+		uint64_t a = NowNs();
+		__asm__ volatile("" : : "r"(a));
+	}
+	return (NowNs() - start) / loops;
+}
+
+////////////////////////////////////////////////////////
+
+static bool KeepsUp(const SMix& mix, steprate_t vMax, const double costNs[CBenchmarkStepper::SectionCount])
+{
+	// the steps are late if the move takes longer with the cost of the ISR and planner in virtual time
+
+	SetMixSpeed(mix, vMax);
+	Stepper.NoCost();
+	uint64_t moveTime = RunMix(mix);
+
+	memcpy(Stepper.CostNs, costNs, sizeof(Stepper.CostNs));
+	uint64_t moveTimeCost = RunMix(mix);
+	Stepper.NoCost();
+
+	return moveTimeCost <= moveTime + moveTime / 100;
+}
+
+static steprate_t MeasureMaxStepRate(const SMix& mix, double nsStepOut, double nsCalc, double nsOptimizeCall, double nsFactor, double isrOverheadNs)
+{
+	// raise the max speed until the steps are late (step buffer runs empty), the quick mix is sufficient
+
+	double costNs[CBenchmarkStepper::SectionCount];
+	costNs[CBenchmarkStepper::SectionStepOut] = nsStepOut * nsFactor + isrOverheadNs;
+	costNs[CBenchmarkStepper::SectionCalcNextSteps] = nsCalc * nsFactor;
+	costNs[CBenchmarkStepper::SectionOptimizeMovementQueue] = nsOptimizeCall * nsFactor;
+
+	bool quick = _quick;
+	_quick = true;
+
+	// double the speed until the steps are late => bisect
+
+	steprate_t ok = 0;
+	steprate_t late = 4000;
+
+	while (KeepsUp(mix, late, costNs))
+	{
+		ok = late;
+		if (late == MAXSTEPRATE)
+			break;
+		late = (steprate_t)min((unsigned long)late * 2, (unsigned long)MAXSTEPRATE);
+	}
+
+	while (ok != late && late - ok > late / 100)
+	{
+		steprate_t vMax = ok + (late - ok) / 2;
+		if (KeepsUp(mix, vMax, costNs))
+			ok = vMax;
+		else
+			late = vMax;
+	}
+
+	_quick = quick;
+	return ok;
+}
+
+////////////////////////////////////////////////////////
+
+static double PerStep(const CBenchmarkStepper::SSection& section, uint64_t steps)	{ return steps ? (double)section.Ns / (double)steps : 0.0; }
+
+int main(int argc, char* argv[])
+{
+	int repeat = 5;
+	const char* outfilename = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-q") == 0)						{ _quick = true; repeat = 1; }
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)	{ repeat = max(1, atoi(argv[++i])); }
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)	{ outfilename = argv[++i]; }
+		else
+		{
+			fprintf(stderr, "usage: %s [-q] [-r repeat] [-o jsonfile]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	FILE* out = outfilename ? fopen(outfilename, "wt") : stdout;
+	if (out == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", outfilename);
+		return 1;
+	}
+
+	Serial.SetOutput(stderr);		// keep stdout clean for json
+
+	double hostGHz = CalibrateHostGHz();
+	Stepper.MeasureOverheadNs = CalibrateMeasureOverhead();
+
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"config\": { \"num_axis\": %i, \"stepbuffersize\": %i, \"movementbuffersize\": %i, \"repeat\": %i,\n", NUM_AXIS, STEPBUFFERSIZE, MOVEMENTBUFFERSIZE, repeat);
+#ifdef USE_RAMPTABLE
+	fprintf(out, "\t\t\"ramptable\": true,\n");
+#else
+	fprintf(out, "\t\t\"ramptable\": false,\n");
+#endif
+	fprintf(out, "\t\t\"host_ghz\": %.3f, \"measure_overhead_ns\": %llu,\n", hostGHz, (unsigned long long) Stepper.MeasureOverheadNs);
+	fprintf(out, "\t\t\"avr_mhz\": %.1f, \"avr_cyclefactor\": %.2f, \"avr_isroverhead\": %i, \"sam_mhz\": %.1f, \"sam_cyclefactor\": %.2f, \"sam_isroverhead\": %i },\n",
+		AVR_MHZ, AVR_CYCLEFACTOR, AVR_ISROVERHEAD, SAM_MHZ, SAM_CYCLEFACTOR, SAM_ISROVERHEAD);
+	fprintf(out, "\t\"mixes\": [\n");
+
+	const int mixcount = sizeof(_mixes) / sizeof(_mixes[0]);
+
+	for (int m = 0; m < mixcount; m++)
+	{
+		CBenchmarkStepper::SSection best[CBenchmarkStepper::SectionCount];
+		uint64_t moveTime = 0;
+		uint64_t steps = 0;
+
+		for (int r = 0; r < repeat; r++)
+		{
+			SetMixSpeed(_mixes[m], _mixes[m].VMax);
+			RunMix(_mixes[m]);
+
+			// use fastest run of each section
+			for (int s = 0; s < CBenchmarkStepper::SectionCount; s++)
+			{
+				if (r == 0 || Stepper.Sections[s].Ns < best[s].Ns)
+					best[s] = Stepper.Sections[s];
+			}
+			moveTime = Stepper.GetMoveTime();
+			steps = Stepper.Sections[CBenchmarkStepper::SectionStepOut].Steps;
+		}
+
+		const CBenchmarkStepper::SSection& optimize = best[CBenchmarkStepper::SectionOptimizeMovementQueue];
+
+		double nsStepOut  = PerStep(best[CBenchmarkStepper::SectionStepOut], steps);
+		double nsCalc     = PerStep(best[CBenchmarkStepper::SectionCalcNextSteps], steps);
+		double nsOptimize = PerStep(optimize, steps);
+		double nsOptimizeCall = optimize.Calls ? (double)optimize.Ns / (double)optimize.Calls : 0.0;
+		double entriesPerCall = optimize.Calls ? (double)optimize.Steps / (double)optimize.Calls : 0.0;	// movement entries recalculated per call
+
+		double hostCycles[3] = { nsStepOut * hostGHz, nsCalc * hostGHz, nsOptimize * hostGHz };
+
+		// sustained rate: StepOut and CalcNextSteps (ISR) and the planner (main loop) must fit into the step periods
+		// otherwise the step buffer (or the movement queue) runs empty
+
+		double avrFactor = hostGHz * AVR_CYCLEFACTOR * 1000.0 / AVR_MHZ;		// host ns => avr ns
+		double samFactor = hostGHz * SAM_CYCLEFACTOR * 1000.0 / SAM_MHZ;
+
+		steprate_t rateHost = MeasureMaxStepRate(_mixes[m], nsStepOut, nsCalc, nsOptimizeCall, 1.0, 0.0);
+		steprate_t rateAvr  = MeasureMaxStepRate(_mixes[m], nsStepOut, nsCalc, nsOptimizeCall, avrFactor, AVR_ISROVERHEAD * 1000.0 / AVR_MHZ);
+		steprate_t rateSam  = MeasureMaxStepRate(_mixes[m], nsStepOut, nsCalc, nsOptimizeCall, samFactor, SAM_ISROVERHEAD * 1000.0 / SAM_MHZ);
+
+		fprintf(out, "\t\t{ \"name\": \"%s\", \"steps\": %llu, \"planner_calls\": %llu, \"virtual_time_ms\": %.3f,\n", _mixes[m].Name, (unsigned long long) steps, (unsigned long long) optimize.Calls, moveTime / 1000000.0);
+		fprintf(out, "\t\t\t\"stepout\":       { \"ns_per_step\": %.2f, \"avr_cycles\": %.0f, \"sam_cycles\": %.0f },\n", nsStepOut, hostCycles[0] * AVR_CYCLEFACTOR, hostCycles[0] * SAM_CYCLEFACTOR);
+		fprintf(out, "\t\t\t\"calcnextsteps\": { \"ns_per_step\": %.2f, \"avr_cycles\": %.0f, \"sam_cycles\": %.0f },\n", nsCalc, hostCycles[1] * AVR_CYCLEFACTOR, hostCycles[1] * SAM_CYCLEFACTOR);
+		fprintf(out, "\t\t\t\"optimizemovementqueue\": { \"ns_per_step\": %.2f, \"ns_per_call\": %.1f, \"entries_per_call\": %.2f, \"avr_cycles\": %.0f, \"sam_cycles\": %.0f },\n", nsOptimize, nsOptimizeCall, entriesPerCall, hostCycles[2] * AVR_CYCLEFACTOR, hostCycles[2] * SAM_CYCLEFACTOR);
+		fprintf(out, "\t\t\t\"max_step_rate\": { \"host\": %lu, \"avr\": %lu, \"sam\": %lu, \"limit\": %lu } }%s\n",
+			(unsigned long) rateHost, (unsigned long) rateAvr, (unsigned long) rateSam, (unsigned long) MAXSTEPRATE, m + 1 < mixcount ? "," : "");
+	}
+
+	fprintf(out, "\t]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// minimal replacement of the msvc "CppUnitTest.h"
+// the tests of VS/Arduino.VC/StepperSystem.Test can be compiled unchanged (TEST_CLASS, TEST_METHOD, Assert)
+//
+////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <typeinfo>
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework
+{
+	////////////////////////////////////////////////////////
+
+	struct STestMethod
+	{
+		const char* ClassName;		// mangled (typeid)
+		const char* MethodName;
+		void(*Run)();
+	};
+
+	inline std::vector<STestMethod>& GetTestMethods()
+	{
+		static std::vector<STestMethod> methods;
+		return methods;
+	}
+
+	struct CTestRegistrar
+	{
+		CTestRegistrar(const char* classname, const char* methodname, void(*run)())
+		{
+			GetTestMethods().push_back({ classname, methodname, run });
+		}
+	};
+
+	template<class T>
+	class CTestClass
+	{
+	protected:
+		typedef T ThisClass;
+	};
+
+	////////////////////////////////////////////////////////
+
+	struct CAssertFailed
+	{
+		std::string Message;
+	};
+
+	class Assert
+	{
+	public:
+
+		template<typename T>
+		static void AreEqual(const T& expected, const T& actual, const wchar_t* message = NULL)
+		{
+			if (!(expected == actual))
+				Fail(ToString(expected), ToString(actual), message);
+		}
+
+		static void AreEqual(const char* expected, const char* actual, const wchar_t* message = NULL)
+		{
+			if (strcmp(expected, actual) != 0)
+				Fail(expected, actual, message);
+		}
+
+		static void AreEqual(char* expected, char* actual, const wchar_t* message = NULL)
+		{
+			AreEqual((const char*)expected, (const char*)actual, message);
+		}
+
+		static void AreEqual(double expected, double actual, double tolerance, const wchar_t* message = NULL)
+		{
+			if (fabs(expected - actual) > tolerance)
+				Fail(ToString(expected), ToString(actual), message);
+		}
+
+		static void AreEqual(float expected, float actual, float tolerance, const wchar_t* message = NULL)
+		{
+			AreEqual((double)expected, (double)actual, (double)tolerance, message);
+		}
+
+		template<typename T>
+		static void AreNotEqual(const T& notexpected, const T& actual, const wchar_t* message = NULL)
+		{
+			if (notexpected == actual)
+				Fail("!" + ToString(notexpected), ToString(actual), message);
+		}
+
+		template<typename T>
+		static void AreSame(const T& expected, const T& actual, const wchar_t* message = NULL)
+		{
+			if (&expected != &actual)
+				Fail("same", "other", message);
+		}
+
+		static void IsTrue(bool condition, const wchar_t* message = NULL)
+		{
+			if (!condition)
+				Fail("true", "false", message);
+		}
+
+		static void IsFalse(bool condition, const wchar_t* message = NULL)
+		{
+			if (condition)
+				Fail("false", "true", message);
+		}
+
+		static void Fail(const wchar_t* message = NULL)
+		{
+			Fail("", "fail", message);
+		}
+
+	private:
+
+		template<typename T>
+		static std::string ToString(const T& value)
+		{
+			if constexpr (std::is_enum<T>::value)
+				return std::to_string((long long)value);
+			else if constexpr (std::is_arithmetic<T>::value)
+				return std::to_string(+value);
+			else if constexpr (std::is_pointer<T>::value)
+				return std::to_string((unsigned long long)(uintptr_t)value);
+			else
+				return "?";
+		}
+
+		static void Fail(const std::string& expected, const std::string& actual, const wchar_t* message)
+		{
+			CAssertFailed failed;
+			failed.Message = "expected <" + expected + "> actual <" + actual + ">";
+			if (message != NULL)
+			{
+				char msg[256];
+				snprintf(msg, sizeof(msg), " - %ls", message);
+				failed.Message += msg;
+			}
+			throw failed;
+		}
+	};
+}}}
+
+////////////////////////////////////////////////////////
+
+#define TEST_CLASS(classname) \
+	class classname : public Microsoft::VisualStudio::CppUnitTestFramework::CTestClass<classname>
+
+#define TEST_METHOD(methodname) \
+	struct methodname##_Registrar \
+	{ \
+		methodname##_Registrar() \
+		{ \
+			static Microsoft::VisualStudio::CppUnitTestFramework::CTestRegistrar reg(typeid(ThisClass).name(), #methodname, []() { ThisClass test; test.methodname(); }); \
+		} \
+	}; \
+	inline static methodname##_Registrar methodname##_registrar; \
+	void methodname()
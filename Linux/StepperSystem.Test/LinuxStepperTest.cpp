@@ -0,0 +1,1988 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#include "../LinuxStepper/LinuxStepper.h"
+#include <CNCLib.h>
+#include <MotionControlBase.h>
+#include <GCodeParser.h>
+#include <GCodeBinaryParser.h>
+#include <GCode3DParser.h>
+
+#include <math.h>
+#include <vector>
+
+#include "CppUnitTest.h"
+
+////////////////////////////////////////////////////////
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace StepperSystemTest
+{
+	class CProfileStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		std::vector<uint64_t> StepTime;				// virtual time of each step event
+
+		void InitTest()								{ super::InitTest(); StepTime.clear(); }
+
+		// max acceleration and max change of acceleration (steps/sec^2 and steps/sec^3) of the step events
+		void GetProfile(double& maxAcc, double& maxJerk, uint8_t avg)
+		{
+			maxAcc = maxJerk = 0;
+			double lastV = 0, lastA = 0, lastT = 0;
+			bool first = true;
+
+			for (size_t i = avg; i + avg < StepTime.size(); i += avg)
+			{
+				double t = (StepTime[i] - StepTime[0]) / 1e9;
+				double v = avg / ((StepTime[i] - StepTime[i - avg]) / 1e9);
+				if (i > avg)
+				{
+					double a = (v - lastV) / (t - lastT);
+					maxAcc = max(maxAcc, fabs(a));
+					if (!first)
+						maxJerk = max(maxJerk, fabs(a - lastA) / (t - lastT));
+					first = i == avg * 2 ? false : first;
+					lastA = a;
+				}
+				lastV = v;
+				lastT = t;
+			}
+		}
+
+		// max deceleration (steps/sec^2) from step to step, speed of a step is averaged over "avg" steps (timer resolution), without the stop at the end
+		double GetMaxDec(size_t from, uint8_t avg)
+		{
+			double maxDec = 0;
+			for (size_t i = max(from, (size_t)avg * 2); i + avg < StepTime.size(); i++)
+			{
+				double v0 = avg / ((StepTime[i - 1] - StepTime[i - 1 - avg]) / 1e9);
+				double v1 = avg / ((StepTime[i] - StepTime[i - avg]) / 1e9);
+				double d = (v0 - v1) / ((StepTime[i] - StepTime[i - 1]) / 1e9);
+				maxDec = max(maxDec, d);
+			}
+			return maxDec;
+		}
+
+		// max jerk (steps/sec^3) of the position sampled every dt (third difference), without the first and last sample (jerk speed at start/stop)
+		double GetMaxJerk(double dt)
+		{
+			std::vector<double> pos;
+			double tEnd = (StepTime.back() - StepTime[0]) / 1e9;
+			size_t k = 0;
+
+			for (double t = 0; t < tEnd; t += dt)
+			{
+				while (k + 1 < StepTime.size() && (StepTime[k + 1] - StepTime[0]) / 1e9 <= t)
+					k++;
+
+				double t0 = (StepTime[k] - StepTime[0]) / 1e9, t1 = (StepTime[k + 1] - StepTime[0]) / 1e9;
+				pos.push_back(k + (t - t0) / (t1 - t0));
+			}
+
+			double maxJerk = 0;
+			for (size_t i = 1; i + 4 < pos.size(); i++)
+				maxJerk = max(maxJerk, fabs(pos[i + 3] - 3 * pos[i + 2] + 3 * pos[i + 1] - pos[i]) / (dt * dt * dt));
+			return maxJerk;
+		}
+
+#ifdef USE_INPUTSHAPING
+		// max amplitude of an undamped oscillator (frequency in Hz) driven by the step position, after the movement has finished
+		double GetResidualVibration(double frequency)
+		{
+			double w = 2 * M_PI * frequency, dt = 1e-5;
+			double x = 0, v = 0, maxResidual = 0;
+			double tEnd = (StepTime.back() - StepTime[0]) / 1e9;
+			size_t k = 0;
+
+			for (double t = 0; t < tEnd + 1.0; t += dt)
+			{
+				while (k + 1 < StepTime.size() && (StepTime[k + 1] - StepTime[0]) / 1e9 <= t)
+					k++;
+
+				double p = (double) k;
+				if (k + 1 < StepTime.size())
+				{
+					double t0 = (StepTime[k] - StepTime[0]) / 1e9, t1 = (StepTime[k + 1] - StepTime[0]) / 1e9;
+					p += (t - t0) / (t1 - t0);
+				}
+
+				v += w * w * (p - x) * dt;
+				x += v * dt;
+				if (t > tEnd)
+					maxResidual = max(maxResidual, fabs(x - p));
+			}
+			return maxResidual;
+		}
+#endif
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			StepTime.push_back(GetVirtualTime());
+		}
+	};
+
+#ifndef REDUCED_SIZE
+	class CSpeedOverrideStepper : public CProfileStepper
+	{
+	private:
+
+		typedef CProfileStepper super;
+
+	public:
+
+		uint32_t OverrideAtStep = 0;				// change speed override while moving
+		EnumAsByte(ESpeedOverride) Override = SpeedOverride100P;
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			if (GetStepCount(X_AXIS) == OverrideAtStep)
+				SetSpeedOverride(Override);
+		}
+	};
+#endif
+
+#ifdef STEPPERPROFILE
+	class CStepBufferStepper : public CLinuxStepper
+	{
+	public:
+
+		unsigned long StepBufferEntries = 0;		// elements added to the step buffer
+
+	protected:
+
+		virtual void ProfileEnd(EnumAsByte(EProfileSection) section, uint8_t steps) override
+		{
+			if (section == ProfileCalcNextSteps)
+				StepBufferEntries += steps;
+		}
+	};
+#endif
+
+#if STEPSMOOTHING_MAXLEVEL > 0
+	class CSmoothStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		std::vector<uint64_t> StepTime;				// virtual time of each step of the Y axis
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			if (steps[Y_AXIS])
+				StepTime.push_back(GetVirtualTime());
+		}
+	};
+#endif
+
+#ifdef USE_ARCMOVE
+	class CArcStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		sdist_t StartX = 0, StartY = 0;				// start position relative to center
+		float MaxRadius = 0, MinRadius = 1e9;		// distance of all step positions to center
+
+		unsigned long StepCount = 0;				// steps of axis X/Y (one or both)
+
+		static void ArcNext(sdist_t& x, sdist_t& y, long& f, bool clockwise)
+		{
+			// reference path: midpoint circle, one step at a time (as the ISR)
+
+			sdist_t tx = clockwise ? y : -y;
+			sdist_t ty = clockwise ? -x : x;
+			sdist_t& major = labs(tx) >= labs(ty) ? x : y;
+			sdist_t& minor = labs(tx) >= labs(ty) ? y : x;
+			sdist_t tMajor = labs(tx) >= labs(ty) ? tx : ty;
+			sdist_t tMinor = labs(tx) >= labs(ty) ? ty : tx;
+
+			int8_t d = tMajor > 0 ? 1 : -1;
+			f += 2 * major * d + 1;
+			major += d;
+
+			int8_t s = tMinor > 0 ? 1 : (tMinor < 0 ? -1 : (minor > 0 ? -1 : 1));
+			long f2 = f + 2 * minor * s + 1;
+			if (labs(f2) < labs(f))
+			{
+				f = f2;
+				minor += s;
+			}
+		}
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			StepCount += max(steps[X_AXIS], steps[Y_AXIS]);
+			float r = hypot((float)(StartX + GetStepPosition(X_AXIS)), (float)(StartY + GetStepPosition(Y_AXIS)));
+			MaxRadius = max(MaxRadius, r);
+			MinRadius = min(MinRadius, r);
+		}
+	};
+#endif
+
+#ifdef USE_ADVANCE
+	class CAdvanceStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		sdist_t MaxLead = 0, MinLead = 0;			// B (extruder) ahead of the nominal position (X/10)
+		sdist_t LeadAtX = 0, LeadAtXValue = 0;		// lead at position X
+
+		void InitTest()								{ super::InitTest(); MaxLead = MinLead = LeadAtXValue = 0; }
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			sdist_t lead = GetStepPosition(B_AXIS) - GetStepPosition(X_AXIS) / 10;
+			MaxLead = max(MaxLead, lead);
+			MinLead = min(MinLead, lead);
+			if (GetStepPosition(X_AXIS) == LeadAtX)
+				LeadAtXValue = lead;
+		}
+	};
+#endif
+
+#ifdef USE_BACKLASHBLEND
+	class CBacklashStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		unsigned long Pulses = 0;					// step pulses of Y (including backlash)
+		unsigned long StepsX = 0;
+		uint64_t FirstX = 0, LastX = 0;				// virtual time of first and last step of X
+		uint64_t LastY = 0, MinIntervalY = 0;		// min time between two pulses of Y
+
+		void InitTest()								{ super::InitTest(); Pulses = StepsX = 0; FirstX = LastX = LastY = 0; MinIntervalY = (uint64_t)-1; }
+		uint64_t GetTimeX() const					{ return LastX - FirstX; }
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			Pulses += steps[Y_AXIS];
+			if (steps[Y_AXIS] != 0)
+			{
+				if (LastY != 0)
+					MinIntervalY = min(MinIntervalY, GetVirtualTime() - LastY);
+				LastY = GetVirtualTime();
+			}
+			if (steps[X_AXIS] != 0)
+			{
+				if (StepsX++ == 0)
+					FirstX = GetVirtualTime();
+				LastX = GetVirtualTime();
+			}
+		}
+	};
+#endif
+
+#ifdef USE_PLANNER2PASS
+	class CPlannerStepper : public CLinuxStepper
+	{
+	public:
+
+		// HPGL file (PU x y; / PD x y;), pen up with rapid speed, returns false if the file is not found
+		bool MovePlt(const char* filename, steprate_t feed, steprate_t rapid)
+		{
+			FILE* f = fopen(filename, "rt");
+			if (f == NULL)
+				return false;
+
+			char line[64];
+			while (fgets(line, sizeof(line), f))
+			{
+				int x, y;
+				if (line[0] == 'P' && (line[1] == 'U' || line[1] == 'D') && sscanf(line + 2, "%i %i", &x, &y) == 2)
+					MoveAbs3(x, y, 0, line[1] == 'U' ? rapid : feed);
+			}
+			fclose(f);
+			return true;
+		}
+	};
+#endif
+
+	class CPathStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		std::vector<std::pair<sdist_t, sdist_t>> Path;	// X/Y after each step event
+
+		void InitTest()								{ super::InitTest(); Path.clear(); }
+
+		// min distance of the path to the point
+		double GetDistance(sdist_t x, sdist_t y) const
+		{
+			double dist = 1e9;
+			for (auto& p : Path)
+				dist = min(dist, sqrt(double(p.first - x) * (p.first - x) + double(p.second - y) * (p.second - y)));
+			return dist;
+		}
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			super::Step(steps, directionUp);
+			Path.push_back(std::make_pair(GetStepPosition(X_AXIS), GetStepPosition(Y_AXIS)));
+		}
+	};
+
+#ifdef USE_RAMPTABLE
+	class CRampTableStepper : public CLinuxStepper
+	{
+	public:
+		using CStepper::GetRampFactor;
+	};
+#endif
+
+#ifdef USE_STATUSSNAPSHOT
+	class CSnapshotStepper : public CLinuxStepper
+	{
+	private:
+
+		typedef CLinuxStepper super;
+
+	public:
+
+		steprate_t MaxSpeed = 0;
+		bool Monotonic = true;					// X position of the snapshot never decrements
+		udist_t LastX = 0;
+
+		void InitTest()								{ super::InitTest(); MaxSpeed = 0; Monotonic = true; LastX = 0; }
+
+	protected:
+
+		virtual void Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) override
+		{
+			// like a status request in the middle of the movement
+
+			super::Step(steps, directionUp);
+
+			SStatusSnapshot status;
+			GetStatusSnapshot(status);
+			if (status._speed > MaxSpeed)
+				MaxSpeed = status._speed;
+			if (status._current[X_AXIS] < LastX)
+				Monotonic = false;
+			LastX = status._current[X_AXIS];
+		}
+	};
+#endif
+
+	class CSegmentMotionControl : public CMotionControlBase
+	{
+	private:
+
+		typedef CMotionControlBase super;
+
+	public:
+
+		std::vector<std::pair<mm1000_t, mm1000_t>> Segments;	// X/Y end point of each segment (MoveAbs)
+
+		virtual void MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrate) override
+		{
+			Segments.push_back(std::make_pair(to[X_AXIS], to[Y_AXIS]));
+			super::MoveAbs(to, feedrate);
+		}
+
+		virtual bool IsArcMoveAllowed(axis_t /* axis_0 */, axis_t /* axis_1 */) override	{ return false; }	// always segments
+
+		// max distance of the points (curve) to the segments, start is the position before the first segment
+		double GetMaxDeviation(mm1000_t startX, mm1000_t startY, const std::vector<std::pair<double, double>>& curve) const
+		{
+			double maxDist = 0;
+			for (auto& p : curve)
+			{
+				double dist = 1e9;
+				double x0 = startX, y0 = startY;
+				for (auto& s : Segments)
+				{
+					double dx = s.first - x0, dy = s.second - y0;
+					double len2 = dx * dx + dy * dy;
+					double u = len2 > 0 ? ((p.first - x0) * dx + (p.second - y0) * dy) / len2 : 0;
+					u = u < 0 ? 0 : (u > 1 ? 1 : u);
+					dist = min(dist, hypot(x0 + u * dx - p.first, y0 + u * dy - p.second));
+					x0 = s.first; y0 = s.second;
+				}
+				maxDist = max(maxDist, dist);
+			}
+			return maxDist;
+		}
+	};
+
+	class CTestControl : public CControl
+	{
+	public:
+
+		virtual bool IsKill() override	{ return false; }
+
+		// parse one line with the gcode parser, true if no error
+		static bool Parse(const char* line)
+		{
+			char buffer[128];
+			strcpy(buffer, line);
+			CStreamReader reader;
+			reader.Init(buffer);
+			CGCodeParser parser(&reader, NULL);
+			parser.ParseCommand();
+			return !parser.IsError();
+		}
+
+		// parse one line with the 3D printer gcode parser (see CNCLibEx)
+		static bool Parse3D(const char* line)
+		{
+			char buffer[128];
+			strcpy(buffer, line);
+			CStreamReader reader;
+			reader.Init(buffer);
+			CGCode3DParser parser(&reader, NULL);
+			parser.ParseCommand();
+			return !parser.IsError();
+		}
+
+#ifdef USE_BINARYPROTOCOL
+		bool Binary(const uint8_t* frame)		{ return BinaryCommand(frame, NULL); }
+
+		// frame of BINARYCMD_MOVE with the deltas of X, Y and Z (0 => not in the axis mask)
+		static const uint8_t* MoveFrame(uint8_t seq, bool rapid, int32_t x, int32_t y, int32_t z, int32_t feedrate = 0)
+		{
+			static uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+			uint8_t data[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+			int32_t delta[NUM_AXIS] = { x, y, z };
+			uint8_t axes = (x ? 1 : 0) | (y ? 2 : 0) | (z ? 4 : 0);
+			uint8_t length = CBinaryProtocol::BuildMove(data, rapid, axes, NUM_AXIS, delta, feedrate != 0, feedrate);
+			CBinaryProtocol::BuildFrame(frame, seq, BINARYCMD_MOVE, data, length);
+			return frame;
+		}
+
+		static const uint8_t* Frame(uint8_t seq, uint8_t cmd, const uint8_t* data, uint8_t length)
+		{
+			static uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+			CBinaryProtocol::BuildFrame(frame, seq, cmd, data, length);
+			return frame;
+		}
+#endif
+	};
+
+	TEST_CLASS(CLinuxStepperTest)
+	{
+	public:
+
+		CLinuxStepper Stepper;
+
+		TEST_METHOD(LinuxStepperMoveRelTest)
+		{
+			Stepper.InitTest();
+
+			Stepper.MoveRel3(3200, 1600, 100);
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)3200, Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)1600, Stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((sdist_t)100, Stepper.GetStepPosition(Z_AXIS));
+
+			Assert::AreEqual((udist_t)3200, Stepper.GetCurrentPosition(X_AXIS));
+			Assert::AreEqual((udist_t)1600, Stepper.GetCurrentPosition(Y_AXIS));
+			Assert::AreEqual((udist_t)100, Stepper.GetCurrentPosition(Z_AXIS));
+		}
+
+		TEST_METHOD(LinuxStepperMoveBackTest)
+		{
+			Stepper.InitTest();
+
+			Stepper.MoveAbs3(2000, 1000, 500);
+			Stepper.MoveAbs3(500, 1500, 0);
+			Stepper.MoveAbs3(0, 0, 0);
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(Z_AXIS));
+
+			Assert::AreEqual((uint32_t)(2000 + 1500 + 500), Stepper.GetStepCount(X_AXIS));
+			Assert::AreEqual((uint32_t)(1000 + 500 + 1500), Stepper.GetStepCount(Y_AXIS));
+			Assert::AreEqual((uint32_t)(500 + 500), Stepper.GetStepCount(Z_AXIS));
+		}
+
+		TEST_METHOD(LinuxStepperVirtualTimeTest)
+		{
+			Stepper.InitTest();
+
+			uint64_t start = GetVirtualTime();
+
+			// 10000 steps with max 5000 steps/sec => at least 2 sec
+			Stepper.MoveRel3(10000, 0, 0, 5000);
+			Stepper.EndTest();
+
+			uint64_t movetime = Stepper.GetMoveTime();
+
+			Assert::IsTrue(movetime >= 2000000000ull);
+			Assert::IsTrue(movetime < 4000000000ull);
+			Assert::IsTrue(GetVirtualTime() - start >= movetime);
+		}
+
+#ifdef USE_RAMPTABLE
+		TEST_METHOD(LinuxStepperRampTableTest)
+		{
+			// compare with Cn = Cn-1 * (4n-1)/(4n+1)
+			double factor = 1.0;
+			rampfactor_t last = CRampTableStepper::GetRampFactor(0);
+
+			for (mdist_t n = 1; n < 200000; n++)
+			{
+				factor = factor * (4.0 * n - 1.0) / (4.0 * n + 1.0);
+				rampfactor_t rampfactor = CRampTableStepper::GetRampFactor(n);
+
+				Assert::AreEqual(factor, rampfactor / double(1ull << RAMPFACTORBITS), factor * 0.001);
+				Assert::IsTrue(rampfactor <= last);
+				last = rampfactor;
+			}
+		}
+
+		TEST_METHOD(LinuxStepperRampTableMoveTest)
+		{
+			Stepper.InitTest();
+
+			// same as LinuxStepperVirtualTimeTest but with acc/dec and junction
+			Stepper.MoveRel3(10000, 0, 0, 5000);
+			Stepper.MoveRel3(10000, 3000, 0, 5000);
+			Stepper.MoveRel3(-20000, -3000, 0, 5000);
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(Y_AXIS));
+
+			uint64_t movetime = Stepper.GetMoveTime();
+			Assert::IsTrue(movetime >= 8000000000ull);
+			Assert::IsTrue(movetime < 12000000000ull);
+		}
+#endif
+
+#ifdef USE_SCURVE
+		TEST_METHOD(LinuxStepperSCurveTest)
+		{
+			CProfileStepper stepper;
+			double accTrapezoid, jerkTrapezoid, accSCurve, jerkSCurve;
+
+			stepper.InitTest();
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeTrapezoid = stepper.GetMoveTime();
+			stepper.GetProfile(accTrapezoid, jerkTrapezoid, 50);
+
+			stepper.InitTest();
+			stepper.SetMaxJerk(X_AXIS, 20000);
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeSCurve = stepper.GetMoveTime();
+			stepper.GetProfile(accSCurve, jerkSCurve, 50);
+			stepper.SetMaxJerk(X_AXIS, 0);
+
+			Assert::AreEqual((sdist_t)20000, stepper.GetStepPosition(X_AXIS));
+
+			// smooth acceleration, but not much slower than the trapezoid
+			Assert::IsTrue(jerkSCurve * 4 < jerkTrapezoid);
+			Assert::IsTrue(accSCurve < accTrapezoid);
+			Assert::IsTrue(timeSCurve > timeTrapezoid);
+			Assert::IsTrue(timeSCurve < timeTrapezoid * 3 / 2);
+
+			// configured jerk (sampled every 0.1s => quantization of the steps is below 4000 steps/sec^3)
+
+			const unsigned long jerks[] = { 20000, 10000 };
+			for (unsigned long jerk : jerks)
+			{
+				stepper.InitTest();
+				stepper.SetMaxJerk(X_AXIS, jerk);
+				stepper.MoveRel3(20000, 0, 0, 5000);
+				stepper.EndTest();
+				stepper.SetMaxJerk(X_AXIS, 0);
+
+				double maxJerk = stepper.GetMaxJerk(0.1);
+				Assert::IsTrue(maxJerk < jerk * 1.25);
+				Assert::IsTrue(maxJerk > jerk / 2);
+			}
+		}
+
+		TEST_METHOD(LinuxStepperSCurveReplanTest)
+		{
+			// next move is queued while the S-curve accelerates => no stop at the junction
+
+			CProfileStepper stepper;
+
+			stepper.InitTest();
+			stepper.SetMaxJerk(X_AXIS, 20000);
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			delay(300);
+			Assert::IsTrue(stepper.GetStepPosition(X_AXIS) > 0 && stepper.StepTime.size() < 2000);		// in acc
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			stepper.EndTest();
+			stepper.SetMaxJerk(X_AXIS, 0);
+
+			Assert::AreEqual((sdist_t)40000, stepper.GetStepPosition(X_AXIS));
+			double vJunction = 100 / ((stepper.StepTime[20050] - stepper.StepTime[19950]) / 1e9);
+			Assert::IsTrue(vJunction > 4900);
+		}
+#endif
+
+#ifdef USE_INPUTSHAPING
+		TEST_METHOD(LinuxStepperInputShapingTest)
+		{
+			CProfileStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRel3(1000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeRaw = stepper.GetMoveTime();
+			double residualRaw = stepper.GetResidualVibration(5.0);
+
+			stepper.InitTest();
+			stepper.SetInputShaper(X_AXIS, CStepper::InputShaperZV, 5.0, 0);
+			stepper.MoveRel3(1000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeZV = stepper.GetMoveTime();
+			double residualZV = stepper.GetResidualVibration(5.0);
+			Assert::AreEqual((sdist_t)1000, stepper.GetStepPosition(X_AXIS));
+
+			stepper.InitTest();
+			stepper.SetInputShaper(X_AXIS, CStepper::InputShaperZVD, 5.0, 0);
+			stepper.MoveRel3(1000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeZVD = stepper.GetMoveTime();
+			double residualZVD = stepper.GetResidualVibration(5.0);
+			Assert::AreEqual((sdist_t)1000, stepper.GetStepPosition(X_AXIS));
+			stepper.SetInputShaper(X_AXIS, CStepper::InputShaperNone, 0, 0);
+
+			// resonance of 5Hz suppressed, each acc/dec phase is longer by the duration of the shaper (0.1 sec / 0.2 sec)
+			Assert::IsTrue(residualZV * 10 < residualRaw);
+			Assert::IsTrue(residualZVD * 10 < residualRaw);
+			Assert::IsTrue(timeZV > timeRaw);
+			Assert::IsTrue(timeZV < timeRaw + 250000000ull);
+			Assert::IsTrue(timeZVD > timeZV);
+			Assert::IsTrue(timeZVD < timeRaw + 450000000ull);
+
+			// change of the shaper waits for the queued movements (they use the shaper)
+
+			stepper.InitTest();
+			stepper.SetInputShaper(X_AXIS, CStepper::InputShaperZVD, 5.0, 0);
+			stepper.MoveRel3(1000, 0, 0, 5000);
+			stepper.MoveRel3(1000, 100, 0, 5000);
+			stepper.SetInputShaper(X_AXIS, CStepper::InputShaperNone, 0, 0);
+			Assert::IsFalse(stepper.IsBusy());
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)2000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)100, stepper.GetStepPosition(Y_AXIS));
+		}
+#endif
+
+#ifdef USE_ACCCURVE
+		TEST_METHOD(LinuxStepperAccCurveTest)
+		{
+			CProfileStepper stepper;
+			double accConst, accSlow, accFastConst, accFast, jerk;
+
+			// torque decreases with speed: 4 times acc/dec up to 1000 steps/sec
+			// acc/dec of a ramp phase is taken at the mid speed of the phase (from standstill: v/2)
+			static const CStepper::CAccCurve::SLookupTable accCurve[] = { { 1000, 4.0f }, { 4000, 1.0f } };
+
+			stepper.InitTest();
+			stepper.MoveRel3(2000, 0, 0, 1000);
+			stepper.EndTest();
+
+			uint64_t timeConst = stepper.GetMoveTime();
+			stepper.GetProfile(accConst, jerk, 10);
+
+			stepper.InitTest();
+			stepper.SetAccCurve(X_AXIS, accCurve, 2);
+			stepper.MoveRel3(2000, 0, 0, 1000);
+			stepper.EndTest();
+
+			uint64_t timeSlow = stepper.GetMoveTime();
+			stepper.GetProfile(accSlow, jerk, 10);
+			Assert::AreEqual((sdist_t)2000, stepper.GetStepPosition(X_AXIS));
+
+			stepper.InitTest();
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeFastConst = stepper.GetMoveTime();
+			stepper.GetProfile(accFastConst, jerk, 10);
+
+			stepper.InitTest();
+			stepper.SetAccCurve(X_AXIS, accCurve, 2);
+			stepper.MoveRel3(20000, 0, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeFast = stepper.GetMoveTime();
+			stepper.GetProfile(accFast, jerk, 10);
+			Assert::AreEqual((sdist_t)20000, stepper.GetStepPosition(X_AXIS));
+
+			stepper.InitTest();
+			stepper.MoveRel3(10000, 0, 0, 2500);
+			stepper.EndTest();
+
+			uint64_t timeMiddleConst = stepper.GetMoveTime();
+
+			stepper.InitTest();
+			stepper.SetAccCurve(X_AXIS, accCurve, 2);
+			stepper.MoveRel3(10000, 0, 0, 2500);
+			stepper.EndTest();
+
+			uint64_t timeMiddle = stepper.GetMoveTime();
+
+			// slow move: acc/dec 4 times (curve at 500 steps/sec)
+			Assert::IsTrue(accSlow > accConst * 3);
+			Assert::IsTrue(timeSlow + 40000000ull < timeConst);
+
+			// 2500 steps/sec: curve at 1250 steps/sec (3.75 times), 5000 steps/sec: curve at 2500 steps/sec (2.5 times)
+			Assert::IsTrue(timeMiddle < timeMiddleConst);
+			Assert::IsTrue(timeFast < timeFastConst);
+			Assert::IsTrue(accFast > accFastConst * 2 && accFast < accFastConst * 3);
+
+			// junctions: the planner uses the acc/dec of the max speed => ramps of the phases reach the planned junction speed
+
+			stepper.InitTest();
+			stepper.SetAccCurve(X_AXIS, accCurve, 2);
+			stepper.MoveRel3(3000, 0, 0, 1000);
+			stepper.MoveRel3(6000, 0, 0, 5000);
+			stepper.MoveRel3(1000, 0, 0, 2000);
+			stepper.EndTest();
+
+			double accJunction;
+			stepper.GetProfile(accJunction, jerk, 10);
+			Assert::AreEqual((sdist_t)10000, stepper.GetStepPosition(X_AXIS));
+			Assert::IsTrue(accJunction < accSlow * 5 / 4);
+		}
+#endif
+
+#ifdef USE_ADVANCE
+		TEST_METHOD(LinuxStepperAdvanceTest)
+		{
+			CAdvanceStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)400, stepper.GetStepPosition(B_AXIS));
+			Assert::IsTrue(stepper.MaxLead <= 1);
+
+			// k=0.1 sec, speed of extruder 500 steps/sec => lead 50 steps
+
+			stepper.InitTest();
+			stepper.SetAdvance(B_AXIS, 0.1f);
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)4000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)400, stepper.GetStepPosition(B_AXIS));
+			Assert::IsTrue(stepper.MaxLead >= 45 && stepper.MaxLead <= 52);
+			Assert::IsTrue(stepper.MinLead >= -1);
+
+			// speed override 50% => speed of extruder 250 steps/sec => lead 25 steps
+
+			stepper.InitTest();
+			stepper.SetAdvance(B_AXIS, 0.1f);
+			stepper.SetSpeedOverride(CStepper::PToSpeedOverride(50));
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.EndTest();
+			stepper.SetSpeedOverride(CStepper::SpeedOverride100P);
+
+			Assert::AreEqual((sdist_t)400, stepper.GetStepPosition(B_AXIS));
+			Assert::IsTrue(stepper.MaxLead >= 22 && stepper.MaxLead <= 27);
+			Assert::IsTrue(stepper.MinLead >= -1);
+
+			// lead is kept for the following extruding movement, not for the travel
+
+			stepper.InitTest();
+			stepper.SetAdvance(B_AXIS, 0.1f);
+			stepper.LeadAtX = 4000;
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.MoveRelEx(5000, X_AXIS, 4000, -1);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)12000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)800, stepper.GetStepPosition(B_AXIS));
+			Assert::IsTrue(stepper.LeadAtXValue > 40);
+
+			// following extruding movement is shorter than the lead => lead is limited to its steps
+
+			stepper.InitTest();
+			stepper.SetAdvance(B_AXIS, 0.1f);
+			stepper.MoveRelEx(5000, X_AXIS, 4000, B_AXIS, 400, -1);
+			stepper.MoveRelEx(5000, X_AXIS, 50, B_AXIS, 5, -1);
+			stepper.MoveRelEx(5000, X_AXIS, 4000, -1);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)8050, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)405, stepper.GetStepPosition(B_AXIS));
+			Assert::IsTrue(stepper.LeadAtXValue <= 5);						// LeadAtX = 4000
+		}
+
+		TEST_METHOD(LinuxGCode3DParserAdvanceTest)
+		{
+			CMotionControlBase motionControl;
+			CTestControl control;
+
+			Stepper.InitTest();
+			CGCodeParser::Init();
+
+			// M900 K (sec) of the extruder axis (E => B)
+
+			Assert::IsTrue(CTestControl::Parse3D("M900 K0.05"));
+			Assert::AreEqual((axis_t)B_AXIS, Stepper.GetAdvanceAxis());
+			Assert::AreEqual(0.05f, Stepper.GetAdvance());
+
+			Assert::IsTrue(CTestControl::Parse3D("M900"));
+			Assert::IsFalse(CTestControl::Parse3D("M900 K-1"));
+			Assert::AreEqual(0.05f, Stepper.GetAdvance());
+
+			Assert::IsTrue(CTestControl::Parse3D("M900 K0"));
+			Assert::AreEqual(0.0f, Stepper.GetAdvance());
+		}
+#endif
+
+#ifdef USE_BACKLASHBLEND
+		TEST_METHOD(LinuxStepperBacklashTest)
+		{
+			CBacklashStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRel3(1000, 100, 0, 5000);
+			stepper.MoveRel3(1000, -100, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeNoBacklash = stepper.GetTimeX();
+			Assert::AreEqual((unsigned long)200, stepper.Pulses);
+
+			// backlash of Y is taken up while moving (no stop at the reversal)
+			// the split step of 5000 steps/sec is 10000 steps/sec => max speed of axis
+
+			stepper.InitTest();
+			stepper.SetDefaultMaxSpeed(10000);
+			stepper.SetBacklash(Y_AXIS, 50);
+			stepper.SetBacklash(2000);
+			stepper.MoveRel3(1000, 100, 0, 5000);
+			stepper.MoveRel3(1000, -100, 0, 5000);
+			stepper.EndTest();
+
+			uint64_t timeBacklash = stepper.GetTimeX();
+			Assert::AreEqual((unsigned long)300, stepper.Pulses);		// last direction is down after init => 2 reversals
+			Assert::AreEqual((sdist_t)2000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((udist_t)0, stepper.GetCurrentPosition(Y_AXIS));		// backlash steps are not counted
+			Assert::AreEqual(timeNoBacklash, timeBacklash);		// same speed profile of X
+			Assert::IsTrue(stepper.MinIntervalY >= 100000);			// 10000 steps/sec
+
+			// split step faster than the max speed of the axis (5000) => backlash move (stop)
+
+			stepper.InitTest();
+			stepper.SetBacklash(Y_AXIS, 50);
+			stepper.SetBacklash(2000);
+			stepper.MoveRel3(1000, 100, 0, 5000);
+			stepper.MoveRel3(1000, -100, 0, 5000);
+			stepper.EndTest();
+
+			Assert::AreEqual((unsigned long)300, stepper.Pulses);
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(Y_AXIS));
+			Assert::IsTrue(stepper.GetTimeX() > timeNoBacklash);
+			Assert::IsTrue(stepper.MinIntervalY >= 200000);
+
+			// movement too short for the backlash steps at backlash speed (2 steps each) => backlash move
+
+			stepper.InitTest();
+			stepper.MoveRel3(1000, 100, 0, 2000);
+			stepper.MoveRel3(80, -80, 0, 2000);
+			stepper.EndTest();
+
+			uint64_t timeShort = stepper.GetTimeX();
+
+			stepper.InitTest();
+			stepper.SetBacklash(Y_AXIS, 50);
+			stepper.SetBacklash(2000);
+			stepper.MoveRel3(1000, 100, 0, 2000);
+			stepper.MoveRel3(80, -80, 0, 2000);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)1080, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)20, stepper.GetStepPosition(Y_AXIS));
+			Assert::IsTrue(stepper.GetTimeX() > timeShort);
+		}
+#endif
+
+#ifndef REDUCED_SIZE
+		TEST_METHOD(LinuxStepperSpeedOverrideTest)
+		{
+			CSpeedOverrideStepper stepper;
+			double acc100, jerk100, accOverride, jerkOverride;
+
+			stepper.InitTest();
+			stepper.MoveRel3(30000, 0, 0, 3000);
+			stepper.EndTest();
+
+			uint64_t time100 = stepper.GetMoveTime();
+			stepper.GetProfile(acc100, jerk100, 50);
+
+			// 200% in the middle of the move (constant speed)
+
+			stepper.InitTest();
+			stepper.OverrideAtStep = 10000;
+			stepper.Override = CStepper::SpeedOverrideMax;
+			stepper.MoveRel3(30000, 0, 0, 3000);
+			stepper.EndTest();
+			stepper.SetSpeedOverride(CStepper::SpeedOverride100P);
+
+			uint64_t timeOverride = stepper.GetMoveTime();
+			stepper.GetProfile(accOverride, jerkOverride, 50);
+
+			Assert::AreEqual((sdist_t)30000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((uint32_t)30000, stepper.GetStepCount(X_AXIS));
+
+			// faster, but ramped with the acceleration of the move (no jump of speed)
+			Assert::IsTrue(timeOverride < time100 * 8 / 10);
+			Assert::IsTrue(accOverride < acc100 * 2);
+
+			// limited to the max speed of the axis (5000, see InitTest)
+			double maxSpeed = 0;
+			for (size_t i = 50; i < stepper.StepTime.size(); i += 50)
+				maxSpeed = max(maxSpeed, 50 / ((stepper.StepTime[i] - stepper.StepTime[i - 50]) / 1e9));
+			Assert::IsTrue(maxSpeed > 4500 && maxSpeed < 5100);
+
+			// faster than planned down to the end of the move: decelerate step by step with the dec of the move (no speed stairs)
+
+			stepper.InitTest();
+			stepper.OverrideAtStep = 0;
+			stepper.MoveRel3(60000, 0, 0, 3000);
+			stepper.EndTest();
+
+			double dec100 = stepper.GetMaxDec(0, 4);
+
+			stepper.InitTest();
+			stepper.OverrideAtStep = 10000;
+			stepper.Override = CStepper::SpeedOverrideMax;
+			stepper.MoveRel3(60000, 0, 0, 3000);
+			stepper.EndTest();
+			stepper.SetSpeedOverride(CStepper::SpeedOverride100P);
+
+			double decOverride = stepper.GetMaxDec(10000, 4);
+			Assert::IsTrue(decOverride < dec100 * 1.5);
+
+			// rapid override does not change a feed move, but the rapid move
+
+			stepper.InitTest();
+			stepper.MoveRel3(3000, 0, 0, 3000);
+			stepper.EndTest();
+
+			uint64_t timeFeed = stepper.GetMoveTime();
+
+			stepper.InitTest();
+			stepper.SetRapidOverride(CStepper::SpeedOverrideMin);
+			stepper.MoveRel3(3000, 0, 0, 3000);
+			stepper.EndTest();
+
+			Assert::AreEqual(timeFeed, stepper.GetMoveTime());
+
+			stepper.InitTest();
+			stepper.SetRapidOverride(CStepper::SpeedOverrideMin);
+			stepper.SetRapidMove(true);
+			stepper.MoveRel3(3000, 0, 0, 3000);
+			stepper.SetRapidMove(false);
+			stepper.EndTest();
+			stepper.SetRapidOverride(CStepper::SpeedOverride100P);
+
+			Assert::AreEqual((sdist_t)3000, stepper.GetStepPosition(X_AXIS));
+			Assert::IsTrue(stepper.GetMoveTime() > timeFeed * 2);
+		}
+#endif
+
+#ifdef USE_PLANNER2PASS
+		static uint64_t MovePlanner(CPlannerStepper& stepper, bool planner2Pass, bool camFile)
+		{
+			stepper.InitTest();
+			stepper.SetPlanner2Pass(planner2Pass);
+
+			if (camFile)
+			{
+				Assert::IsTrue(stepper.MovePlt(TESTDATADIR "motoguzz.plt", 5000, 5000));
+			}
+			else
+			{
+				// many short (collinear) segments => junction speed is limited by acc over the segments
+				for (int i = 0; i < 500; i++)
+					stepper.MoveRel3(40, 20, 0);
+			}
+
+			stepper.EndTest();
+			return stepper.GetMoveTime();
+		}
+
+		TEST_METHOD(LinuxStepperPlanner2PassTest)
+		{
+			CPlannerStepper stepper;
+
+			// CAM file (HPGL): corners are limited by jerk => small gain
+
+			uint64_t timeIncremental = MovePlanner(stepper, false, true);
+			sdist_t x = stepper.GetStepPosition(X_AXIS), y = stepper.GetStepPosition(Y_AXIS);
+
+			uint64_t time2Pass = MovePlanner(stepper, true, true);
+			Assert::AreEqual(x, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual(y, stepper.GetStepPosition(Y_AXIS));
+			Assert::IsTrue(time2Pass < timeIncremental);
+
+			// short segments: no loss of speed along the chain of moves
+
+			timeIncremental = MovePlanner(stepper, false, false);
+			time2Pass = MovePlanner(stepper, true, false);
+			Assert::AreEqual((sdist_t)20000, stepper.GetStepPosition(X_AXIS));
+			Assert::IsTrue(time2Pass < timeIncremental * 7 / 10);
+		}
+#endif
+
+		static unsigned int MoveWatermark(CLinuxStepper& stepper)
+		{
+			// many tiny segments accelerating from rest => T2H stops at the watermark
+			unsigned int maxOptimized = 0;
+
+			for (int i = 0; i < 500; i++)
+			{
+				stepper.MoveRel3(40, 20, 0);
+				maxOptimized = max(maxOptimized, (unsigned int)stepper.GetOptimizedMovements());
+			}
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)20000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)10000, stepper.GetStepPosition(Y_AXIS));
+
+			return maxOptimized;
+		}
+
+		TEST_METHOD(LinuxStepperOptimizeWatermarkTest)
+		{
+			Stepper.InitTest();
+#ifdef USE_PLANNER2PASS
+			Stepper.SetPlanner2Pass(false);
+#endif
+			unsigned int maxOptimized = MoveWatermark(Stepper);
+
+			// without watermark: all queued entries (T2H and H2T) are recalculated
+			Assert::IsTrue(maxOptimized < MOVEMENTBUFFERSIZE / 2);
+
+#ifdef USE_PLANNER2PASS
+			// 2-pass: faster => longer stop distance, more moves from tail are recalculated, but not the whole queue
+
+			Stepper.InitTest();
+			Assert::IsTrue(MoveWatermark(Stepper) < MOVEMENTBUFFERSIZE);
+#endif
+		}
+
+		static uint64_t MoveMerge(CLinuxStepper& stepper)
+		{
+			stepper.SetMergeTolerance(1);
+
+			// collinear (within 1 step) => merged into tail (first move is head)
+			for (int i = 0; i < 500; i++)
+				stepper.MoveRel3(40, i % 2 == 0 ? 21 : 19, 0);
+
+			Assert::AreEqual((uint8_t)2, stepper.QueuedMovements());
+
+			// corner and other speed => no merge
+			stepper.MoveRel3(0, 100, 0);
+			stepper.MoveRel3(0, 100, 0, 1000);
+			Assert::AreEqual((uint8_t)4, stepper.QueuedMovements());
+
+			stepper.EndTest();
+			stepper.SetMergeTolerance(0);
+
+			Assert::AreEqual((sdist_t)20000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)(10000 + 200), stepper.GetStepPosition(Y_AXIS));
+
+			return stepper.GetMoveTime();
+		}
+
+		TEST_METHOD(LinuxStepperMergeMoveTest)
+		{
+			Stepper.InitTest();
+#ifdef USE_PLANNER2PASS
+			Stepper.SetPlanner2Pass(false);
+#endif
+
+			for (int i = 0; i < 500; i++)
+				Stepper.MoveRel3(40, 20, 0);
+			Stepper.EndTest();
+
+			uint64_t timeNoMerge = Stepper.GetMoveTime();
+
+			Stepper.InitTest();
+#ifdef USE_PLANNER2PASS
+			Stepper.SetPlanner2Pass(false);
+#endif
+
+			// no stop at each junction
+			Assert::IsTrue(MoveMerge(Stepper) < timeNoMerge);
+
+#ifdef USE_PLANNER2PASS
+			// 2-pass: an unmerged chain does not stop at each junction => compare with the same path as one move (the first move is started at once => stop at the end of it)
+
+			Stepper.InitTest();
+			Stepper.MoveRel3(40, 20, 0);
+			Stepper.MoveRel3(19960, 9980, 0);
+			Stepper.MoveRel3(0, 100, 0);
+			Stepper.MoveRel3(0, 100, 0, 1000);
+			Stepper.EndTest();
+
+			uint64_t timeOneMove = Stepper.GetMoveTime();
+
+			Stepper.InitTest();
+			Assert::IsTrue(MoveMerge(Stepper) < timeOneMove * 21 / 20);
+#endif
+
+			// gently curved polyline (arc r=3000, short first segment): each junction point must be within the tolerance of the merged line,
+			// not only the first and the last one (else the middle is 4-5 steps off)
+
+			CPathStepper stepper;
+			stepper.InitTest();
+#ifdef USE_PLANNER2PASS
+			stepper.SetPlanner2Pass(false);
+#endif
+			stepper.SetMergeTolerance(1);
+
+			std::vector<std::pair<sdist_t, sdist_t>> points;
+			sdist_t x = 0, y = 0;
+			for (int i = 0; i < 30; i++)
+			{
+				double angle = 0.3 + 0.001 + i * 0.007;
+				sdist_t nx = (sdist_t)lround(3000.0 * (sin(angle) - sin(0.3)));
+				sdist_t ny = (sdist_t)lround(3000.0 * (cos(0.3) - cos(angle)));
+				stepper.MoveRel3(nx - x, ny - y, 0);
+				points.push_back(std::make_pair(x = nx, y = ny));
+			}
+			stepper.EndTest();
+			stepper.SetMergeTolerance(0);
+
+			for (auto& p : points)
+				Assert::IsTrue(stepper.GetDistance(p.first, p.second) <= 2.0);
+		}
+
+		static uint64_t MoveCircleSegments(CLinuxStepper& stepper, steprate_t jerk, udist_t curveTolerance)
+		{
+			// circle r=500 with 36 segments (deviation 1.9 steps)
+
+			stepper.InitTest();
+			for (axis_t x = 0; x < NUM_AXIS; x++)
+				stepper.SetJerkSpeed(x, jerk);
+			stepper.SetCurveTolerance(curveTolerance);
+			stepper.SetPosition(X_AXIS, 1500);
+			stepper.SetPosition(Y_AXIS, 1000);
+
+			for (int i = 1; i <= 36; i++)
+			{
+				stepper.MoveAbs3((udist_t)lround(1000 + 500 * cos(i * M_PI / 18)), (udist_t)lround(1000 + 500 * sin(i * M_PI / 18)), 0);
+			}
+			stepper.EndTest();
+			stepper.SetCurveTolerance(0);
+
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(Y_AXIS));
+
+			return stepper.GetMoveTime();
+		}
+
+		TEST_METHOD(LinuxStepperCurveJunctionTest)
+		{
+			// jerk limited: speed depends on jerk setting (crawl with small jerk)
+			// curve: centripetal acceleration => v = sqrt(a*r) = sqrt(10000*500) = 2236 => 1.4s for 3140 steps
+
+			uint64_t timeJerk = MoveCircleSegments(Stepper, 50, 0);
+			uint64_t timeCurve = MoveCircleSegments(Stepper, 50, 4 * STEPFRACTION);
+			uint64_t timeCurveJerk = MoveCircleSegments(Stepper, 2000, 4 * STEPFRACTION);
+
+			Assert::IsTrue(timeCurve * 2 < timeJerk);
+			Assert::AreEqual(timeCurve, timeCurveJerk);
+			Assert::IsTrue(timeCurve > 1400000000ull);
+
+			// tolerance less than one step above/below the deviation of the segments (2.5 steps, 2 steps would be a corner)
+
+			Assert::AreEqual(timeCurve, MoveCircleSegments(Stepper, 50, STEPFRACTION * 5 / 2));
+			Assert::AreEqual(timeJerk, MoveCircleSegments(Stepper, 50, STEPFRACTION * 3 / 2));
+		}
+
+		static uint64_t MovePocket(CLinuxStepper& stepper, steprate_t jerk, udist_t junctionDeviation)
+		{
+			// rotated square, 5 rounds => 20 corners of 90 degree
+
+			stepper.InitTest();
+			for (axis_t x = 0; x < NUM_AXIS; x++)
+				stepper.SetJerkSpeed(x, jerk);
+			stepper.SetJunctionDeviation(junctionDeviation);
+			stepper.SetPosition(X_AXIS, 10000);
+			stepper.SetPosition(Y_AXIS, 10000);
+
+			for (int i = 0; i < 5; i++)
+			{
+				stepper.MoveRel3(2000, 1000, 0);
+				stepper.MoveRel3(-1000, 2000, 0);
+				stepper.MoveRel3(-2000, -1000, 0);
+				stepper.MoveRel3(1000, -2000, 0);
+			}
+			stepper.EndTest();
+			stepper.SetJunctionDeviation(0);
+
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(Y_AXIS));
+
+			return stepper.GetMoveTime();
+		}
+
+		TEST_METHOD(LinuxStepperJunctionDeviationTest)
+		{
+			// junction deviation: corner speed depends on angle and deviation, not on the jerk of the axis
+
+			uint64_t timeJerk = MovePocket(Stepper, 50, 0);
+			uint64_t timeDeviation = MovePocket(Stepper, 50, 20 * STEPFRACTION);
+			uint64_t timeDeviationJerk = MovePocket(Stepper, 2000, 20 * STEPFRACTION);
+			uint64_t timeDeviationLarge = MovePocket(Stepper, 50, 100 * STEPFRACTION);
+
+			Assert::IsTrue(timeDeviation < timeJerk);
+			Assert::AreEqual(timeDeviation, timeDeviationJerk);
+			Assert::IsTrue(timeDeviationLarge < timeDeviation);
+
+			// less than one step (low resolution): still the deviation model, not max jerk
+
+			uint64_t timeDeviationSmall = MovePocket(Stepper, 50, STEPFRACTION / 2);
+			uint64_t timeDeviationSmallJerk = MovePocket(Stepper, 2000, STEPFRACTION / 2);
+
+			Assert::IsTrue(timeDeviation < timeDeviationSmall);
+			Assert::AreEqual(timeDeviationSmall, timeDeviationSmallJerk);
+		}
+
+		TEST_METHOD(LinuxGCodeParserCurveParamTest)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+			CTestControl control;
+
+			Stepper.InitTest();
+			CGCodeParser::Init();
+
+			// curve tolerance in mm (1 step = 1/1000 mm)
+
+			Assert::IsTrue(CTestControl::Parse("#6152=0.004"));
+			Assert::AreEqual((udist_t)4 * STEPFRACTION, Stepper.GetCurveTolerance());
+
+			Assert::IsTrue(CTestControl::Parse("#<_curvetol>=#6152*2.5"));
+			Assert::AreEqual((udist_t)10 * STEPFRACTION, Stepper.GetCurveTolerance());
+
+			Assert::IsTrue(CTestControl::Parse("#6152=0"));
+			Assert::AreEqual((udist_t)0, Stepper.GetCurveTolerance());
+
+			// 10 steps/mm: less than one step
+
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_10, CMotionControlBase::ToMachine_1_10);
+
+			Assert::IsTrue(CTestControl::Parse("#6152=0.05"));
+			Assert::AreEqual((udist_t)(0.5 * STEPFRACTION), Stepper.GetCurveTolerance());
+
+			// 2 steps/mm: less than 1/STEPFRACTION step => error, unchanged
+
+			CMotionControlBase::InitConversionStepsPer(0.002f);
+
+			Assert::IsFalse(CTestControl::Parse("#6152=0.001"));
+			Assert::AreEqual((udist_t)(0.5 * STEPFRACTION), Stepper.GetCurveTolerance());
+		}
+
+		TEST_METHOD(LinuxGCodeParserJunctionParamTest)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+			CTestControl control;
+
+			Stepper.InitTest();
+			CGCodeParser::Init();
+
+			// junction deviation in mm (1 step = 1/1000 mm)
+
+			Assert::IsTrue(CTestControl::Parse("#6151=0.02"));
+			Assert::AreEqual((udist_t)20 * STEPFRACTION, Stepper.GetJunctionDeviation());
+
+			Assert::IsTrue(CTestControl::Parse("#<_junctiondev>=0.1"));
+			Assert::AreEqual((udist_t)100 * STEPFRACTION, Stepper.GetJunctionDeviation());
+
+			Assert::IsTrue(CTestControl::Parse("#6151=0"));
+			Assert::AreEqual((udist_t)0, Stepper.GetJunctionDeviation());
+
+			// 10 steps/mm: less than one step
+
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_10, CMotionControlBase::ToMachine_1_10);
+
+			Assert::IsTrue(CTestControl::Parse("#6151=0.02"));
+			Assert::AreEqual((udist_t)(0.2 * STEPFRACTION), Stepper.GetJunctionDeviation());
+			Assert::IsTrue(CTestControl::Parse("#6151=#6151*2"));		// read 0.02mm (not 0)
+			Assert::AreEqual((udist_t)(0.4 * STEPFRACTION), Stepper.GetJunctionDeviation());
+
+			// 2 steps/mm: less than 1/STEPFRACTION step => error, unchanged
+
+			CMotionControlBase::InitConversionStepsPer(0.002f);
+
+			Assert::IsFalse(CTestControl::Parse("#6151=0.001"));
+			Assert::AreEqual((udist_t)(0.4 * STEPFRACTION), Stepper.GetJunctionDeviation());
+			Assert::IsFalse(CTestControl::Parse("#6151=-0.1"));
+		}
+
+#ifdef STEPPERPROFILE
+		TEST_METHOD(LinuxStepperStepBufferRepeatTest)
+		{
+			CStepBufferStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRel3(10000, 0, 0, 5000);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)10000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((uint32_t)10000, stepper.GetStepCount(X_AXIS));
+
+			// constant speed => same step is repeated (max STEPBUFFERMAXREPEAT)
+			Assert::IsTrue(stepper.StepBufferEntries < 10000 / 2);
+			Assert::IsTrue(stepper.StepBufferEntries >= 10000 / (STEPBUFFERMAXREPEAT + 1));
+		}
+#endif
+
+#if STEPSMOOTHING_MAXLEVEL > 0
+		TEST_METHOD(LinuxStepperStepSmoothingTest)
+		{
+			CSmoothStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRel3(3000, 1100, 0, 500);
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)3000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)1100, stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((size_t)1100, stepper.StepTime.size());
+
+			// constant speed: minor axis steps each 2.73 steps of X => without smoothing 2 or 3 X steps (50% jitter)
+
+			uint64_t minDiff = (uint64_t)-1, maxDiff = 0;
+			for (size_t i = 400; i < 700; i++)
+			{
+				uint64_t diff = stepper.StepTime[i] - stepper.StepTime[i - 1];
+				minDiff = min(minDiff, diff);
+				maxDiff = max(maxDiff, diff);
+			}
+
+			Assert::IsTrue((maxDiff - minDiff) * 5 < minDiff);
+		}
+#endif
+
+#ifdef USE_ARCMOVE
+		TEST_METHOD(LinuxStepperArcTest)
+		{
+			CArcStepper stepper;
+
+			stepper.InitTest();
+			stepper.SetPosition(X_AXIS, 12000);
+			stepper.SetPosition(Y_AXIS, 10000);
+			stepper.StartX = 2000;
+
+			// full circle (one movement), r=2000
+
+			udist_t to[NUM_AXIS] = { 12000, 10000, 0 };
+			Assert::IsTrue(stepper.ArcAbs(to, X_AXIS, Y_AXIS, 10000, 10000, false, 2000));
+			Assert::AreEqual((uint8_t)1, stepper.QueuedMovements());
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, stepper.GetStepPosition(Y_AXIS));
+			Assert::IsTrue(stepper.MaxRadius < 2001.0 && stepper.MinRadius > 1999.0);
+
+			// constant speed on the arc: 2*PI*r/v = 6.28s (+0.4s for acc/dec)
+
+			Assert::IsTrue(stepper.GetMoveTime() > 6283000000ull && stepper.GetMoveTime() < 7000000000ull);
+
+			// helix: quarter circle clockwise with z
+
+			udist_t toHelix[NUM_AXIS] = { 10000, 8000, 500 };
+			Assert::IsTrue(stepper.ArcAbs(toHelix, X_AXIS, Y_AXIS, 10000, 10000, true));
+			stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)-2000, stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)-2000, stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((sdist_t)500, stepper.GetStepPosition(Z_AXIS));
+			Assert::AreEqual((udist_t)8000, stepper.GetCurrentPosition(Y_AXIS));
+			Assert::IsTrue(stepper.MaxRadius < 2001.0 && stepper.MinRadius > 1999.0);
+
+			// end not on circle => not possible as arc
+
+			udist_t toOff[NUM_AXIS] = { 10100, 12000, 500 };
+			Assert::IsFalse(stepper.ArcAbs(toOff, X_AXIS, Y_AXIS, 10000, 10000, true));
+		}
+#endif
+
+#ifdef USE_ARCMOVE
+		TEST_METHOD(LinuxStepperArcStepsTest)
+		{
+			// step count (closed form in ArcAbs) must match the path of the ISR
+
+			const sdist_t radius[] = { 3, 17, 250, 4711, 60000 };
+			const udist_t center = 100000;
+			unsigned long rnd = 4711;
+
+			for (sdist_t r : radius)
+			{
+				for (int i = 0; i < 8; i++)
+				{
+					rnd = rnd * 1103515245 + 12345;
+					float angle = (rnd >> 8) % 3600 * float(M_PI) / 1800;
+					bool clockwise = (rnd >> 20) & 1;
+					bool fullCircle = i == 0;
+
+					sdist_t x = (sdist_t)lround(r * cos(angle));
+					sdist_t y = (sdist_t)lround(r * sin(angle));
+					sdist_t r0 = (sdist_t)sqrt((double)x * x + (double)y * y);
+					long f = (long)x * x + (long)y * y - (long)r0 * r0;
+
+					// end: from the reference path => steps are known
+
+					unsigned long steps = fullCircle ? 0 : 1 + (rnd >> 4) % (unsigned long)(r0 * 5);					// less than a full circle
+					sdist_t xEnd = x, yEnd = y;
+					long fEnd = f;
+					for (unsigned long n = 0; n < steps; n++)
+						CArcStepper::ArcNext(xEnd, yEnd, fEnd, clockwise);
+
+					if (fullCircle)
+					{
+						do
+						{
+							CArcStepper::ArcNext(xEnd, yEnd, fEnd, clockwise);
+							steps++;
+						} while (steps < 4 || labs(xEnd - x) > 1 || labs(yEnd - y) > 1);
+						if (xEnd != x || yEnd != y) steps++;
+						xEnd = x;
+						yEnd = y;
+					}
+
+					CArcStepper stepper;
+					stepper.InitTest();
+					stepper.SetPosition(X_AXIS, center + x);
+					stepper.SetPosition(Y_AXIS, center + y);
+					stepper.StartX = x;
+					stepper.StartY = y;
+
+					udist_t to[NUM_AXIS] = { center + xEnd, center + yEnd, 0 };
+					Assert::IsTrue(stepper.ArcAbs(to, X_AXIS, Y_AXIS, center, center, clockwise, 10000));
+					stepper.EndTest();
+
+					Assert::AreEqual(xEnd - x, stepper.GetStepPosition(X_AXIS));
+					Assert::AreEqual(yEnd - y, stepper.GetStepPosition(Y_AXIS));
+					Assert::AreEqual(steps, stepper.StepCount);
+				}
+			}
+		}
+#endif
+
+#ifdef USE_BLOCKQUEUE
+		TEST_METHOD(LinuxMotionControlBlockQueueTest)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+
+			Stepper.InitTest();
+			motionControl.SetPositionFromMachine();
+
+			// fill the movement queue (zigzag => no merge)
+
+			mm1000_t to[NUM_AXIS] = { 0 };
+			feedrate_t feedrate = 240000;
+			int count = 0;
+
+			while (Stepper.CanQueueMovement())
+			{
+				to[X_AXIS] += 100;
+				to[Y_AXIS] = (++count % 2) * 50;
+				motionControl.QueueBlock(to, feedrate);
+			}
+
+			// parsed blocks are queued without waiting
+
+			uint64_t time = GetVirtualTime();
+
+			for (int i = 0; i < BLOCKBUFFERSIZE; i++)
+			{
+				to[X_AXIS] += 100;
+				to[Y_AXIS] = (++count % 2) * 50;
+				motionControl.QueueBlock(to, feedrate);
+			}
+
+			Assert::AreEqual(time, GetVirtualTime());
+			Assert::AreEqual((uint8_t)0, motionControl.GetFreeBlocks());
+			Assert::AreEqual(to[X_AXIS], motionControl.GetPosition(X_AXIS));
+
+			// out of range: error at parse time, not queued
+
+			mm1000_t toOff[NUM_AXIS] = { (mm1000_t)Stepper.GetLimitMax(X_AXIS) + 1, 0 };
+			motionControl.QueueBlock(toOff, feedrate);
+			Assert::IsTrue(motionControl.IsError());
+			Assert::AreEqual(to[X_AXIS], motionControl.GetPosition(X_AXIS));
+			motionControl.ClearError();
+
+			// block queue full => wait for a free entry of the movement queue
+
+			to[X_AXIS] += 100;
+			motionControl.QueueBlock(to, feedrate);
+			Assert::IsTrue(GetVirtualTime() > time);
+
+			motionControl.FlushBlocks();
+			Assert::IsTrue(motionControl.IsBlockQueueEmpty());
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)to[X_AXIS], Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)to[Y_AXIS], Stepper.GetStepPosition(Y_AXIS));
+		}
+
+		static bool PollBlocksEvent(CStepper* /*stepper*/, uintptr_t param, EnumAsByte(CStepper::EStepperEvent) eventtype, uintptr_t /*addinfo*/)
+		{
+			// like CControl::CheckIdlePoll: time goes on while reading the serial input => ISR frees movements
+			if (eventtype == CStepper::OnWaitEvent)
+			{
+				delay(1);
+				((CMotionControlBase*)param)->PollBlocks();
+			}
+			return true;
+		}
+
+		TEST_METHOD(LinuxMotionControlBlockQueuePollTest)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+
+			Stepper.InitTest();
+			motionControl.SetPositionFromMachine();
+
+			CStepper::SEvent oldEvent, dummy;
+			Stepper.AddEvent(PollBlocksEvent, (uintptr_t)&motionControl, oldEvent);
+
+			// movement queue full, blocks pending, then a long move => MoveBlock waits and PollBlocks is called (nested)
+
+			mm1000_t to[NUM_AXIS] = { 0 };
+			feedrate_t feedrate = 240000;
+			int count = 0;
+
+			while (Stepper.CanQueueMovement() || motionControl.GetFreeBlocks() > 1)
+			{
+				to[X_AXIS] += 100;
+				to[Y_AXIS] = (++count % 2) * 50;
+				motionControl.QueueBlock(to, feedrate);
+			}
+
+			to[X_AXIS] += 100000;
+			to[Y_AXIS] = (++count % 2) * 50;
+			motionControl.QueueBlock(to, feedrate);
+
+			for (int i = 0; i < 4; i++)
+			{
+				to[X_AXIS] += 100;
+				to[Y_AXIS] = (++count % 2) * 50;
+				motionControl.QueueBlock(to, feedrate);
+			}
+
+			motionControl.FlushBlocks();
+			Stepper.EndTest();
+			Stepper.AddEvent(oldEvent._event, oldEvent._eventParam, dummy);
+
+			// each block is executed once: Y moves 50 steps in each block
+
+			Assert::AreEqual((sdist_t)to[X_AXIS], Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)to[Y_AXIS], Stepper.GetStepPosition(Y_AXIS));
+			Assert::AreEqual((uint32_t)(count * 50), Stepper.GetStepCount(Y_AXIS));
+		}
+#endif
+
+		TEST_METHOD(LinuxMotionControlBezierTest)
+		{
+			CSegmentMotionControl motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+
+			Stepper.InitTest();
+			Stepper.SetPosition(X_AXIS, 1000);
+			Stepper.SetPosition(Y_AXIS, 1000);
+			motionControl.SetPositionFromMachine();
+
+			mm1000_t p[4][2] = { { 1000, 1000 }, { 1000, 13000 }, { 21000, 13000 }, { 21000, 1000 } };
+			mm1000_t to[NUM_AXIS] = { p[3][0], p[3][1], 0 };
+
+			motionControl.Bezier(to, p[1], p[2], X_AXIS, Y_AXIS, 240000);
+			motionControl.FlushBlocks();
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)20000, Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(Y_AXIS));
+			Assert::IsTrue(motionControl.Segments.back() == std::make_pair(to[X_AXIS], to[Y_AXIS]));
+
+			// distance of the curve to the segments: BEZIER_TOLERANCE (+ rounding of the end points)
+			// segment count: integral of sqrt(|B''|/(8*tolerance)) is the minimum
+
+			std::vector<std::pair<double, double>> curve;
+			double minSegments = 0;
+			const int samples = 2000;
+
+			for (int i = 0; i <= samples; i++)
+			{
+				double t = double(i) / samples;
+				double mt = 1.0 - t;
+				double b[4] = { mt * mt * mt, 3 * mt * mt * t, 3 * mt * t * t, t * t * t };
+				curve.push_back(std::make_pair(b[0] * p[0][0] + b[1] * p[1][0] + b[2] * p[2][0] + b[3] * p[3][0], b[0] * p[0][1] + b[1] * p[1][1] + b[2] * p[2][1] + b[3] * p[3][1]));
+
+				double acc0 = 6 * (mt * (p[0][0] - 2 * p[1][0] + p[2][0]) + t * (p[1][0] - 2 * p[2][0] + p[3][0]));
+				double acc1 = 6 * (mt * (p[0][1] - 2 * p[1][1] + p[2][1]) + t * (p[1][1] - 2 * p[2][1] + p[3][1]));
+				minSegments += sqrt(hypot(acc0, acc1) / (8 * BEZIER_TOLERANCE)) / samples;
+			}
+
+			double deviation = motionControl.GetMaxDeviation(1000, 1000, curve);
+			Assert::IsTrue(deviation <= BEZIER_TOLERANCE + 1.0);
+			Assert::IsTrue(deviation > BEZIER_TOLERANCE / 2);
+			Assert::IsTrue(motionControl.Segments.size() >= minSegments && motionControl.Segments.size() <= minSegments * 1.2 + 1);
+		}
+
+		TEST_METHOD(LinuxMotionControlArcSegmentTest)
+		{
+			CSegmentMotionControl motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+
+			// CCW from angle 0: large radius (quarter), small radius (full circle), tiny radius (3/4, max 20 degree per segment)
+
+			struct { mm1000_t radius; int quarters; } arcs[] = { { 50000, 1 }, { 500, 4 }, { 20, 3 } };
+			const mm1000_t center = 60000;
+
+			for (auto& arc : arcs)
+			{
+				Stepper.InitTest();
+				Stepper.SetPosition(X_AXIS, center + arc.radius);
+				Stepper.SetPosition(Y_AXIS, center);
+				motionControl.SetPositionFromMachine();
+				motionControl.Segments.clear();
+
+				double angle = arc.quarters * M_PI / 2;
+				mm1000_t to[NUM_AXIS] = { center + (mm1000_t)lround(arc.radius * cos(angle)), center + (mm1000_t)lround(arc.radius * sin(angle)), 0 };
+
+				motionControl.Arc(to, -arc.radius, 0, X_AXIS, Y_AXIS, false, 240000);
+				motionControl.FlushBlocks();
+				Stepper.EndTest();
+
+				Assert::AreEqual((sdist_t)(to[X_AXIS] - center - arc.radius), Stepper.GetStepPosition(X_AXIS));
+				Assert::AreEqual((sdist_t)(to[Y_AXIS] - center), Stepper.GetStepPosition(Y_AXIS));
+
+				// segment count: chord error ARC_CHORDTOLERANCE, distance of the circle to the segments
+
+				double thetaTolerance = 2 * acos(1 - ARC_CHORDTOLERANCE / arc.radius);
+				double thetaMax = min(thetaTolerance, 20 * M_PI / 180);
+				double segments = ceil(angle / thetaMax);
+
+				Assert::AreEqual((size_t)segments, motionControl.Segments.size());
+
+				std::vector<std::pair<double, double>> curve;
+				for (int i = 0; i <= 2000; i++)
+					curve.push_back(std::make_pair(center + arc.radius * cos(angle * i / 2000), center + arc.radius * sin(angle * i / 2000)));
+
+				double deviation = motionControl.GetMaxDeviation(center + arc.radius, center, curve);
+				Assert::IsTrue(deviation <= ARC_CHORDTOLERANCE + 1.0);
+				if (thetaTolerance <= thetaMax)		// not limited by the max angle
+					Assert::IsTrue(deviation > ARC_CHORDTOLERANCE / 2);
+			}
+		}
+
+#ifdef USE_BINARYPROTOCOL
+		TEST_METHOD(LinuxGCodeBinaryParserTest)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+			CTestControl control;
+
+			Stepper.InitTest();
+			motionControl.SetPositionFromMachine();
+			CGCodeParser::Init();
+			CGCodeBinaryParser::Init();
+
+			// deltas: int16 (G1 with feedrate) and int32 (G0)
+
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(0, false, 1000, 500, 0, 500000)));
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(1, true, 100000, 0, 70000)));
+			Assert::AreEqual((mm1000_t)101000, motionControl.GetPosition(X_AXIS));
+			Assert::AreEqual((mm1000_t)500, motionControl.GetPosition(Y_AXIS));
+			Assert::AreEqual((mm1000_t)70000, motionControl.GetPosition(Z_AXIS));
+
+			// sequence: a lost or repeated frame is an error (and not executed), the expected sequence is unchanged
+
+			Assert::IsFalse(control.Binary(CTestControl::MoveFrame(3, false, 1000, 0, 0)));
+			Assert::IsFalse(control.Binary(CTestControl::MoveFrame(1, true, 100000, 0, 0)));
+			Assert::AreEqual((mm1000_t)101000, motionControl.GetPosition(X_AXIS));
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(2, false, -1000, 0, 0)));
+			Assert::AreEqual((mm1000_t)100000, motionControl.GetPosition(X_AXIS));
+
+			// crc
+
+			uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+			memcpy(frame, CTestControl::MoveFrame(3, false, 1000, 0, 0), sizeof(frame));
+			frame[BINARYFRAME_IDX_DATA + 2] ^= 1;
+			Assert::IsFalse(control.Binary(frame));
+
+			// length and content of a move (the frame is received => next sequence)
+
+			const uint8_t missingFeed[] = { BINARYMOVE_FEED, 1, 0x10, 0x00 };
+			Assert::IsFalse(control.Binary(CTestControl::Frame(3, BINARYCMD_MOVE, missingFeed, sizeof(missingFeed))));
+			const uint8_t tooShort[] = { 0 };
+			Assert::IsFalse(control.Binary(CTestControl::Frame(4, BINARYCMD_MOVE, tooShort, sizeof(tooShort))));
+			const uint8_t invalidAxis[] = { 0, 1 << NUM_AXIS, 0x10, 0x00 };
+			Assert::IsFalse(control.Binary(CTestControl::Frame(5, BINARYCMD_MOVE, invalidAxis, sizeof(invalidAxis))));
+			Assert::IsFalse(control.Binary(CTestControl::Frame(6, 99, NULL, 0)));
+			Assert::IsFalse(control.Binary(CTestControl::MoveFrame(7, true, 1000, 0, 0, 500000)));		// feedrate with G0
+			Assert::AreEqual((mm1000_t)100000, motionControl.GetPosition(X_AXIS));
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(8, false, 0, 1000, 0)));
+			Assert::AreEqual((mm1000_t)1500, motionControl.GetPosition(Y_AXIS));
+
+			// sync: any sequence
+
+			Assert::IsTrue(control.Binary(CTestControl::Frame(200, BINARYCMD_SYNC, NULL, 0)));
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(201, false, 0, 0, -70000)));
+
+			Stepper.EndTest();
+			Assert::AreEqual((udist_t)100000, Stepper.GetCurrentPosition(X_AXIS));
+			Assert::AreEqual((udist_t)1500, Stepper.GetCurrentPosition(Y_AXIS));
+			Assert::AreEqual((udist_t)0, Stepper.GetCurrentPosition(Z_AXIS));
+
+			// resurrect (after kill) => the host starts with sequence 0
+
+			control.Resurrect();
+			Assert::IsFalse(control.Binary(CTestControl::MoveFrame(202, false, 0, 0, 1000)));
+			Assert::IsTrue(control.Binary(CTestControl::MoveFrame(0, false, 0, 0, 1000)));
+
+			Stepper.EndTest();
+			Assert::AreEqual((udist_t)1000, Stepper.GetCurrentPosition(Z_AXIS));
+		}
+#endif
+
+		TEST_METHOD(LinuxGCodeParserG5Test)
+		{
+			CMotionControlBase motionControl;
+			CMotionControlBase::InitConversion(CMotionControlBase::ToMm1000_1_1000, CMotionControlBase::ToMachine_1_1000);
+			CTestControl control;
+
+			Stepper.InitTest();
+			motionControl.SetPositionFromMachine();
+			CGCodeParser::Init();
+
+			// cubic: IJ and PQ, IJ may be omitted after G5 (reflection of the last control point)
+
+			Assert::IsTrue(CTestControl::Parse("G5 X10 Y0 I2 J5 P-2 Q5"));
+			Assert::IsTrue(CTestControl::Parse("G5 X20 Y0 P-2 Q5"));
+			Assert::IsFalse(CTestControl::Parse("G5 X30 Y0 I2 J5"));
+
+			// other move in between, even if it ends at the end of the last G5 => IJ required
+
+			Assert::IsTrue(CTestControl::Parse("G1 X15 Y5"));
+			Assert::IsTrue(CTestControl::Parse("G1 X20 Y0"));
+			Assert::IsFalse(CTestControl::Parse("G5 X30 Y0 P-2 Q5"));
+
+			// quadratic: IJ required, no reflection after G5.1
+
+			Assert::IsTrue(CTestControl::Parse("G5.1 X30 Y0 I5 J5"));
+			Assert::IsFalse(CTestControl::Parse("G5.1 X40 Y0"));
+			Assert::IsFalse(CTestControl::Parse("G5 X40 Y0 P-2 Q5"));
+
+			// plane change
+
+			Assert::IsTrue(CTestControl::Parse("G5 X40 Y0 I2 J5 P-2 Q5"));
+			Assert::IsTrue(CTestControl::Parse("G18"));
+			Assert::IsTrue(CTestControl::Parse("G17"));
+			Assert::IsFalse(CTestControl::Parse("G5 X50 Y0 P-2 Q5"));
+
+			motionControl.FlushBlocks();
+			Stepper.EndTest();
+
+			Assert::AreEqual((sdist_t)40000, Stepper.GetStepPosition(X_AXIS));
+			Assert::AreEqual((sdist_t)0, Stepper.GetStepPosition(Y_AXIS));
+		}
+
+#ifdef USE_BINARYPROTOCOL
+		TEST_METHOD(LinuxBinaryProtocolTest)
+		{
+			// crc8 (0x07) check value
+
+			Assert::AreEqual((uint8_t)0xF4, CBinaryProtocol::CRC8((const uint8_t*)"123456789", 9));
+
+			int32_t delta[NUM_AXIS] = { 100, -200, 0 };
+			uint8_t data[32];
+			uint8_t frame[BINARYFRAME_MAXSIZE(NUM_AXIS)];
+
+			uint8_t length = CBinaryProtocol::BuildMove(data, false, 3, NUM_AXIS, delta, true, 500000);
+			Assert::AreEqual((uint8_t)(2 + 2 * 2 + 4), length);
+			Assert::AreEqual((uint8_t)BINARYMOVE_FEED, data[0]);
+			Assert::AreEqual((int16_t)-200, CBinaryProtocol::ReadInt16(data + 4));
+			Assert::AreEqual((int32_t)500000, CBinaryProtocol::ReadInt32(data + 6));
+
+			uint8_t size = CBinaryProtocol::BuildFrame(frame, 17, BINARYCMD_MOVE, data, length);
+			Assert::AreEqual((uint8_t)(length + BINARYFRAME_OVERHEAD + 1), size);
+
+			// frame complete with the last byte (crc) only
+
+			Assert::AreEqual((uint8_t)0, CBinaryProtocol::FrameSize(frame, size - 1));
+			Assert::AreEqual(size, CBinaryProtocol::FrameSize(frame, size));
+			Assert::IsTrue(CBinaryProtocol::IsCRCValid(frame));
+
+			frame[BINARYFRAME_IDX_DATA + 2] ^= 1;
+			Assert::IsFalse(CBinaryProtocol::IsCRCValid(frame));
+
+			// deltas out of int16 range => all deltas as int32
+
+			delta[Z_AXIS] = -40000;
+			length = CBinaryProtocol::BuildMove(data, true, 7, NUM_AXIS, delta, false, 0);
+			Assert::AreEqual((uint8_t)(2 + 3 * 4), length);
+			Assert::AreEqual((uint8_t)(BINARYMOVE_RAPID | BINARYMOVE_DELTA32), data[0]);
+			Assert::AreEqual((int32_t)-40000, CBinaryProtocol::ReadInt32(data + 10));
+		}
+#endif
+
+#ifdef USE_STATUSSNAPSHOT
+		TEST_METHOD(LinuxStepperStatusSnapshotTest)
+		{
+			CSnapshotStepper stepper;
+
+			stepper.InitTest();
+			stepper.MoveRel3(10000, 2000, 0, 5000);
+			stepper.EndTest();
+
+			Assert::IsTrue(stepper.Monotonic);
+			Assert::IsTrue(stepper.MaxSpeed > 4500 && stepper.MaxSpeed <= 5500);
+
+			CStepper::SStatusSnapshot status;
+			stepper.GetStatusSnapshot(status);
+
+			Assert::AreEqual((udist_t)10000, status._current[X_AXIS]);
+			Assert::AreEqual((udist_t)2000, status._current[Y_AXIS]);
+			Assert::AreEqual((steprate_t)0, status._speed);
+			Assert::AreEqual((uint8_t)0, status._queued);
+			Assert::IsFalse(status._running);
+		}
+#endif
+
+		TEST_METHOD(LinuxStepperMillisTest)
+		{
+			Stepper.InitTest();
+
+			unsigned long start = millis();
+			delay(100);
+			Assert::AreEqual(start + 100, millis());
+
+			delayMicroseconds(2000);
+			Assert::AreEqual(start + 102, millis());
+		}
+
+		TEST_METHOD(LinuxEepromTest)
+		{
+			char filename[] = "/tmp/StepperSystemTestEepromXXXXXX";
+			int fd = mkstemp(filename);
+			Assert::IsTrue(fd >= 0);
+			close(fd);
+
+			CHAL::SetEepromFilename(filename);
+
+			uint32_t* eeprom = CHAL::GetEepromBaseAdr();
+			CHAL::eeprom_write_dword(eeprom + 1, 0x12345678);
+			CHAL::FlushEeprom();
+
+			CHAL::eeprom_write_dword(eeprom + 1, 0);
+			CHAL::InitEeprom();
+
+			Assert::AreEqual((uint32_t)0x12345678, CHAL::eeprom_read_dword(eeprom + 1));
+
+			CHAL::SetEepromFilename(NULL);
+			unlink(filename);
+		}
+
+		TEST_METHOD(LinuxSerialFileTest)
+		{
+			char filename[] = "/tmp/StepperSystemTestSerialXXXXXX";
+			int fd = mkstemp(filename);
+			Assert::IsTrue(fd >= 0);
+			Assert::AreEqual((ssize_t)12, write(fd, "g1 x10\nm114\n", 12));
+			close(fd);
+
+			HardwareSerial serial;
+			Assert::IsTrue(serial.OpenInput(filename));
+
+			char line[32];
+			int idx = 0;
+
+			while (!serial.IsEOF())
+			{
+				if (serial.available() > 0)
+					line[idx++] = serial.read();
+			}
+			line[idx] = 0;
+
+			Assert::AreEqual("g1 x10\nm114\n", (const char*) line);
+
+			unlink(filename);
+		}
+	};
+}
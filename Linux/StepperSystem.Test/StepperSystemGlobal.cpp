@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#include <cxxabi.h>
+
+#include "../LinuxStepper/LinuxStepper.h"
+
+#include "CppUnitTest.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+CSerial Serial;
+HardwareSerial& StepperSerial = Serial;
+
+////////////////////////////////////////////////////////
+// test runner: StepperSystem.Test [filter]
+// filter is compared with "class::method"
+
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : NULL;
+
+	int run = 0;
+	int failed = 0;
+
+	for (auto& test : GetTestMethods())
+	{
+		int status;
+		char* classname = abi::__cxa_demangle(test.ClassName, NULL, NULL, &status);
+		std::string name = std::string(status == 0 ? classname : test.ClassName) + "::" + test.MethodName;
+		free(classname);
+
+		if (filter != NULL && name.find(filter) == std::string::npos)
+			continue;
+
+		run++;
+
+		try
+		{
+			test.Run();
+			printf("passed: %s\n", name.c_str());
+		}
+		catch (CAssertFailed& ex)
+		{
+			failed++;
+			printf("FAILED: %s: %s\n", name.c_str(), ex.Message.c_str());
+		}
+	}
+
+	printf("%i tests, %i failed\n", run, failed);
+
+	return failed == 0 && run > 0 ? 0 : 1;
+}
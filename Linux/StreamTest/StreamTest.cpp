@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+//
+// host side stress test of the serial protocol: stream short segments to MiniCNC (pipe)
+//
+// StreamTest [-q] [-n lines] [-l latency_us] [-b baud] minicnc
+//
+// the serial link is simulated with a latency (one way): an answer is received 2*latency after the line is sent
+// and optional with a baudrate (10 bits per char)
+//
+// "send-wait": send one line and wait for "ok"
+// "streaming": m129 => "ok Q:free-movements B:free-receivebuffer"
+//              keep lines in flight while the sum of the unanswered lines fits into "B" (character counting)
+// "binary":    same as "streaming" with binary frames (relative moves) instead of text lines, see BinaryProtocol.h
+//
+// status latency while streaming (time from request to answer):
+// "?"          status requested with the text line "?" => answered after the lines in flight
+// realtime     status requested with the real-time char ENQ (0x05) => answered while the parser waits for the movement queue
+//              (latency measured on the host, lines-before-status: answers of segments received before the status)
+//
+// exit code 0 if all lines are answered with "ok"
+//
+////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <stdint.h>
+
+#include "../../Sketch/libraries/CNCLib/src/BinaryProtocol.h"
+
+////////////////////////////////////////////////////////
+
+static uint64_t NowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////
+
+class CMiniCNCProcess
+{
+public:
+
+	bool Start(const char* filename)
+	{
+		int toChild[2];
+		int fromChild[2];
+
+		if (pipe(toChild) != 0 || pipe(fromChild) != 0)
+			return false;
+
+		_pid = fork();
+		if (_pid < 0)
+			return false;
+
+		if (_pid == 0)
+		{
+			dup2(toChild[0], STDIN_FILENO);
+			dup2(fromChild[1], STDOUT_FILENO);
+			close(toChild[0]); close(toChild[1]);
+			close(fromChild[0]); close(fromChild[1]);
+			execl(filename, filename, (char*) NULL);
+			_exit(127);
+		}
+
+		close(toChild[0]);
+		close(fromChild[1]);
+
+		_in = fdopen(fromChild[0], "r");
+		_out = toChild[1];
+		return _in != NULL;
+	}
+
+	int Stop()
+	{
+		int status = 0;
+		if (_out >= 0) close(_out);			// end of input => MiniCNC terminates after all movements are finished
+		_out = -1;
+
+		char line[256];
+		while (ReadLine(line, sizeof(line)));
+
+		if (_in) fclose(_in);
+		_in = NULL;
+
+		waitpid(_pid, &status, 0);
+		return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	}
+
+	bool Send(const char* line)
+	{
+		return Send(line, strlen(line));
+	}
+
+	bool Send(const void* data, size_t len)
+	{
+		return write(_out, data, len) == (ssize_t) len;
+	}
+
+	bool ReadLine(char* line, int size)
+	{
+		return fgets(line, size, _in) != NULL;
+	}
+
+	// read until "ok" or "error:", return false on end of file
+	// status lines of real-time commands ("<...>") are not an answer: time received => statusNs
+
+	bool ReadAnswer(bool& ok, int& credit, uint64_t* statusNs = NULL)
+	{
+		char line[256];
+
+		while (ReadLine(line, sizeof(line)))
+		{
+			if (line[0] == '<')
+			{
+				if (statusNs) *statusNs = NowNs();
+				continue;
+			}
+			if (strncmp(line, "ok", 2) == 0)
+			{
+				const char* b = strstr(line, " B:");
+				if (b) credit = atoi(b + 3);
+				ok = true;
+				return true;
+			}
+			if (strncmp(line, "error:", 6) == 0)
+			{
+				fputs(line, stderr);
+				ok = false;
+				return true;
+			}
+			// info or other messages
+		}
+		return false;
+	}
+
+private:
+
+	pid_t	_pid = -1;
+	FILE*	_in = NULL;
+	int		_out = -1;
+};
+
+////////////////////////////////////////////////////////
+
+enum ERunMode
+{
+	SendWait,
+	Streaming,
+	Binary
+};
+
+enum EStatusMode
+{
+	NoStatus,
+	StatusLine,						// "?"
+	StatusRealtime					// ENQ
+};
+
+#define STATUSEVERY	20				// request status every n lines
+#define REALTIME_STATUS	0x05
+
+struct SResult
+{
+	int			Lines;
+	int			Bytes;
+	int			Ok;
+	int			MaxInFlight;
+	uint64_t	Ns;
+
+	int			Status;
+	uint64_t	StatusNs;
+	uint64_t	StatusMaxNs;
+	int			StatusLines;			// lines answered between request and status
+};
+
+////////////////////////////////////////////////////////
+
+static void Segment(int i, int& x, int& y)
+{
+	// 0.1mm segments in x (back and forth between 0 and 50mm), y zigzag 0..1.75mm
+
+	x = (i % 500) * 100;
+	if ((i / 500) % 2 != 0)
+		x = 50000 - x;
+
+	y = (i % 8) * 250;
+}
+
+static int FormatSegment(char* line, int i)
+{
+	int x, y;
+	Segment(i, x, y);
+	return sprintf(line, "g1x%i.%03iy%i.%03i\n", x / 1000, x % 1000, y / 1000, y % 1000);
+}
+
+static int FormatSegmentBinary(char* line, int i, uint8_t seq)
+{
+	// relative to the previous segment, first segment relative to 0/0 (start position)
+
+	int x, y, lastx = 0, lasty = 0;
+	Segment(i, x, y);
+	if (i > 0)
+		Segment(i - 1, lastx, lasty);
+
+	int32_t delta[2] = { x - lastx, y - lasty };
+	uint8_t data[32];
+	uint8_t length = CBinaryProtocol::BuildMove(data, false, 3, 2, delta, false, 0);
+	return CBinaryProtocol::BuildFrame((uint8_t*) line, seq, BINARYCMD_MOVE, data, length);
+}
+
+////////////////////////////////////////////////////////
+
+static bool Run(const char* minicnc, ERunMode mode, EStatusMode status, int lines, uint64_t latencyNs, uint64_t nsPerChar, SResult& result)
+{
+	bool streaming = mode != SendWait;
+
+	CMiniCNCProcess cnc;
+	memset(&result, 0, sizeof(result));
+
+	if (!cnc.Start(minicnc))
+	{
+		fprintf(stderr, "cannot start %s\n", minicnc);
+		return false;
+	}
+
+	bool ok;
+	int credit = 0;
+
+	cnc.ReadAnswer(ok, credit);					// initialized
+
+	if (!cnc.Send("g1f5000\n") || !cnc.ReadAnswer(ok, credit))
+		return false;
+
+	if (streaming)
+	{
+		credit = 0;
+		if (!cnc.Send("m129s1\n") || !cnc.ReadAnswer(ok, credit) || !ok || credit == 0)
+		{
+			fprintf(stderr, "streaming mode (m129) not supported\n");
+			cnc.Stop();
+			return false;
+		}
+	}
+
+	if (mode == Binary)
+	{
+		uint8_t frame[BINARYFRAME_MAXSIZE(2)];
+		int size = CBinaryProtocol::BuildFrame(frame, 0, BINARYCMD_SYNC, NULL, 0);		// first move with sequence 1
+		if (!cnc.Send(frame, size) || !cnc.ReadAnswer(ok, credit) || !ok)
+		{
+			fprintf(stderr, "binary protocol not supported\n");
+			cnc.Stop();
+			return false;
+		}
+	}
+
+	// lines in flight (length), answered in order
+
+	int maxInFlight = lines + lines / STATUSEVERY + 1;
+	int* inFlight = new int[maxInFlight];
+	bool* isStatus = new bool[maxInFlight];
+	uint64_t* sent = new uint64_t[maxInFlight];
+	int head = 0;
+	int tail = 0;
+	int inFlightSize = 0;
+
+	uint64_t statusSent = 0;
+	uint64_t statusReceived = 0;
+	int statusLines = 0;
+
+	uint64_t start = NowNs();
+	uint64_t linkFree = start;
+
+	char line[64];
+
+	for (int i = 0; i < lines || head != tail; )
+	{
+		int len = 0;
+		bool statusRequest = false;
+		if (i < lines)
+		{
+			if (status == StatusLine && i % STATUSEVERY == STATUSEVERY - 1 && statusSent == 0)
+			{
+				strcpy(line, "?\n");
+				len = 2;
+				statusRequest = true;
+			}
+			else
+				len = mode == Binary ? FormatSegmentBinary(line, i, (uint8_t) (i + 1)) : FormatSegment(line, i);
+		}
+
+		if (status == StatusRealtime && i % STATUSEVERY == STATUSEVERY - 1 && statusSent == 0 && head != tail)
+		{
+			// not a line: does not use the receive buffer (removed by the real-time command handler)
+			char enq = REALTIME_STATUS;
+			if (!cnc.Send(&enq, 1))
+				break;
+			statusSent = NowNs();
+		}
+
+		bool canSend = i < lines && (streaming ? inFlightSize + len <= credit : head == tail);
+
+		if (canSend)
+		{
+			if (nsPerChar)
+			{
+				// serial link busy until the previous line is transmitted
+				uint64_t now = NowNs();
+				if (linkFree > now)
+				{
+					struct timespec ts = { (time_t) ((linkFree - now) / 1000000000ull), (long) ((linkFree - now) % 1000000000ull) };
+					nanosleep(&ts, NULL);
+				}
+				else
+					linkFree = now;
+				linkFree += len * nsPerChar;
+			}
+
+			if (!cnc.Send(line, len))
+				break;
+			result.Bytes += len;
+			sent[tail] = NowNs();
+			isStatus[tail] = statusRequest;
+			inFlight[tail++] = len;
+			inFlightSize += len;
+			if (tail - head > result.MaxInFlight) result.MaxInFlight = tail - head;
+			if (statusRequest)
+				statusSent = sent[tail - 1];
+			else
+				i++;
+		}
+		else
+		{
+			if (!cnc.ReadAnswer(ok, credit, &statusReceived))
+				break;
+
+			if (isStatus[head])
+				statusReceived = NowNs();
+
+			if (statusSent != 0 && statusReceived != 0)
+			{
+				uint64_t ns = statusReceived - statusSent;
+				result.Status++;
+				result.StatusNs += ns;
+				result.StatusLines += statusLines;
+				if (ns > result.StatusMaxNs) result.StatusMaxNs = ns;
+				statusSent = statusReceived = 0;
+				statusLines = 0;
+			}
+			else if (statusSent != 0)
+				statusLines++;
+
+			// round trip of the serial link
+			uint64_t received = sent[head] + 2 * latencyNs;
+			for (uint64_t now = NowNs(); now < received; now = NowNs())
+			{
+				struct timespec ts = { 0, (long) (received - now) };
+				nanosleep(&ts, NULL);
+			}
+
+			bool statusAnswer = isStatus[head];
+			inFlightSize -= inFlight[head++];
+			if (statusAnswer)
+				continue;
+
+			result.Lines++;
+			if (ok) result.Ok++;
+		}
+	}
+
+	result.Ns = NowNs() - start;
+	delete[] inFlight;
+	delete[] isStatus;
+	delete[] sent;
+
+	return cnc.Stop() == 0 && result.Ok == lines;
+}
+
+////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	int lines = 5000;
+	uint64_t latencyNs = 1000000;
+	uint64_t nsPerChar = 0;
+	const char* minicnc = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-q") == 0)						{ lines = 500; }
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)	{ lines = atoi(argv[++i]); }
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)	{ latencyNs = atoi(argv[++i]) * 1000ull; }
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)	{ int baud = atoi(argv[++i]); nsPerChar = baud > 0 ? 10000000000ull / baud : 0; }
+		else if (minicnc == NULL)								{ minicnc = argv[i]; }
+		else													{ minicnc = NULL; break; }
+	}
+
+	if (minicnc == NULL || lines <= 0)
+	{
+		fprintf(stderr, "usage: %s [-q] [-n lines] [-l latency_us] [-b baud] minicnc\n", argv[0]);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	SResult sendWait;
+	SResult streaming;
+	SResult binary;
+	SResult statusLine;
+	SResult statusRealtime;
+
+	bool ret = Run(minicnc, SendWait, NoStatus, lines, latencyNs, nsPerChar, sendWait);
+	ret = Run(minicnc, Streaming, NoStatus, lines, latencyNs, nsPerChar, streaming) && ret;
+	ret = Run(minicnc, Binary, NoStatus, lines, latencyNs, nsPerChar, binary) && ret;
+	ret = Run(minicnc, Streaming, StatusLine, lines, latencyNs, nsPerChar, statusLine) && ret;
+	ret = Run(minicnc, Streaming, StatusRealtime, lines, latencyNs, nsPerChar, statusRealtime) && ret;
+
+	const SResult* results[] = { &sendWait, &streaming, &binary };
+	const char* names[] = { "send-wait", "streaming", "binary" };
+
+	for (int r = 0; r < 3; r++)
+	{
+		double sec = results[r]->Ns / 1e9;
+		printf("%-10s lines=%i ok=%i bytes/line=%.1f maxinflight=%i time=%.3fs lines/sec=%.0f\n",
+			names[r], results[r]->Lines, results[r]->Ok, results[r]->Lines ? (double) results[r]->Bytes / results[r]->Lines : 0.0,
+			results[r]->MaxInFlight, sec, sec > 0 ? results[r]->Lines / sec : 0.0);
+	}
+
+	if (sendWait.Ns > 0 && streaming.Ns > 0)
+		printf("speedup %.2f\n", (double) sendWait.Ns / streaming.Ns);
+	if (streaming.Ns > 0 && binary.Ns > 0)
+		printf("speedup binary/streaming %.2f\n", (double) streaming.Ns / binary.Ns);
+
+	const SResult* status[] = { &statusLine, &statusRealtime };
+	const char* statusNames[] = { "\"?\"", "realtime" };
+
+	for (int r = 0; r < 2; r++)
+	{
+		int n = status[r]->Status;
+		printf("status %-8s requests=%i latency avg=%.0fus max=%.0fus lines-before-status=%.1f\n", statusNames[r], n,
+			n ? status[r]->StatusNs / 1e3 / n : 0.0, status[r]->StatusMaxNs / 1e3, n ? (double) status[r]->StatusLines / n : 0.0);
+	}
+
+	ret = ret && statusRealtime.Status > 0;
+
+	return ret ? 0 : 1;
+}
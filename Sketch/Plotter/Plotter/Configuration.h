@@ -40,7 +40,7 @@
 
 ////////////////////////////////////////////////////////
 
-#define EPROM_SIGNATURE_PLOTTER 0x21438701
+#define EPROM_SIGNATURE_PLOTTER (0x21438700 | (EPROM_SIGNATURE & 0xff))		// layout of SCNCEeprom (01 without input shaper and acc curve)
 
 ////////////////////////////////////////////////////////
 
@@ -45,6 +45,9 @@ protected:
 
 	virtual void TransformFromMachinePosition(const udist_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]) override;
 	virtual bool TransformPosition(const mm1000_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]) override;
+#ifdef USE_ARCMOVE
+	virtual bool IsArcMoveAllowed(axis_t /* axis_0 */, axis_t /* axis_1 */) override	{ return false; }		// arc is not a circle in angles
+#endif
 
 private:
 
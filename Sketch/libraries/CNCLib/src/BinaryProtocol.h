@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////
+//
+// binary motion protocol (see USE_BINARYPROTOCOL), used by CNCLib and the host (encoder)
+//
+// a frame may be sent instead of a text line, the answer is the same as for a text line ("ok" or "error:")
+//
+// frame:	[0]			BINARYFRAME_SYNC (not a valid first char of a text line)
+//			[1]			length of payload (command + data)
+//			[2]			sequence number: +1 for each frame, see BINARYCMD_SYNC
+//			[3]			command
+//			[4..]		data
+//			[last]		crc8 of [1..last-1]
+//
+// BINARYCMD_MOVE:
+//			[0]			flags, see BINARYMOVE_xxx
+//			[1]			axis mask (bit 0 = X)
+//			[2..]		delta (mm1000) of each axis in the mask: int16 or int32 (BINARYMOVE_DELTA32), little endian
+//			[..]		feedrate (mm1000/min) as int32 if BINARYMOVE_FEED: modal like "F" of G1
+//
+////////////////////////////////////////////////////////
+
+#define BINARYFRAME_SYNC		0xfe
+#define BINARYFRAME_HEADER		4			// sync, length, sequence, command
+#define BINARYFRAME_OVERHEAD	4			// sync, length, sequence, crc
+
+#define BINARYFRAME_IDX_LENGTH	1
+#define BINARYFRAME_IDX_SEQ		2
+#define BINARYFRAME_IDX_CMD		3
+#define BINARYFRAME_IDX_DATA	4
+
+#define BINARYCMD_SYNC			0			// no data, accept any sequence number => next = seq+1
+#define BINARYCMD_MOVE			1
+
+#define BINARYMOVE_RAPID		1			// G0, else G1
+#define BINARYMOVE_FEED			2			// feedrate follows the deltas
+#define BINARYMOVE_DELTA32		4			// deltas as int32, else int16
+
+#define BINARYFRAME_MAXSIZE(axes)	(BINARYFRAME_OVERHEAD + 1 + 2 + (axes)*4 + 4)
+
+////////////////////////////////////////////////////////
+
+class CBinaryProtocol
+{
+public:
+
+	static uint8_t CRC8(const uint8_t* data, uint8_t length)
+	{
+		// polynom x^8+x^2+x+1 (0x07)
+		uint8_t crc = 0;
+		while (length--)
+		{
+			crc ^= *data++;
+			for (uint8_t bit = 0; bit < 8; bit++)
+				crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+		}
+		return crc;
+	}
+
+	// size of the frame, 0 if the frame is incomplete (count bytes received)
+
+	static uint8_t FrameSize(const uint8_t* frame, uint8_t count)
+	{
+		if (count <= BINARYFRAME_IDX_LENGTH)
+			return 0;
+		uint8_t size = frame[BINARYFRAME_IDX_LENGTH] + BINARYFRAME_OVERHEAD;
+		return count >= size ? size : 0;
+	}
+
+	static bool IsCRCValid(const uint8_t* frame)
+	{
+		uint8_t length = frame[BINARYFRAME_IDX_LENGTH] + 2;		// length, sequence, payload
+		return CRC8(frame + BINARYFRAME_IDX_LENGTH, length) == frame[BINARYFRAME_IDX_LENGTH + length];
+	}
+
+	static int16_t ReadInt16(const uint8_t* data)					{ return (int16_t)(data[0] | (data[1] << 8)); }
+	static int32_t ReadInt32(const uint8_t* data)					{ return (int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24)); }
+
+	static uint8_t WriteInt16(uint8_t* data, int16_t value)		{ data[0] = (uint8_t)value; data[1] = (uint8_t)(value >> 8); return 2; }
+	static uint8_t WriteInt32(uint8_t* data, int32_t value)		{ WriteInt16(data, (int16_t)value); WriteInt16(data + 2, (int16_t)(value >> 16)); return 4; }
+
+	// host side: build a frame, returns the size of the frame
+
+	static uint8_t BuildFrame(uint8_t* frame, uint8_t seq, uint8_t cmd, const uint8_t* data, uint8_t length)
+	{
+		frame[0] = BINARYFRAME_SYNC;
+		frame[BINARYFRAME_IDX_LENGTH] = length + 1;
+		frame[BINARYFRAME_IDX_SEQ] = seq;
+		frame[BINARYFRAME_IDX_CMD] = cmd;
+		for (uint8_t i = 0; i < length; i++)
+			frame[BINARYFRAME_IDX_DATA + i] = data[i];
+		frame[BINARYFRAME_IDX_DATA + length] = CRC8(frame + BINARYFRAME_IDX_LENGTH, length + 3);
+		return length + BINARYFRAME_HEADER + 1;
+	}
+
+	// host side: build the data of BINARYCMD_MOVE, returns the length of data
+
+	static uint8_t BuildMove(uint8_t* data, bool rapid, uint8_t axes, uint8_t numaxis, const int32_t* delta, bool withFeed, int32_t feedrate)
+	{
+		bool delta32 = false;
+		for (uint8_t axis = 0; axis < numaxis; axis++)
+		{
+			if ((axes & (1 << axis)) && (delta[axis] < -32768 || delta[axis] > 32767))
+				delta32 = true;
+		}
+
+		uint8_t idx = 0;
+		data[idx++] = (rapid ? BINARYMOVE_RAPID : 0) | (withFeed ? BINARYMOVE_FEED : 0) | (delta32 ? BINARYMOVE_DELTA32 : 0);
+		data[idx++] = axes;
+
+		for (uint8_t axis = 0; axis < numaxis; axis++)
+		{
+			if (axes & (1 << axis))
+				idx += delta32 ? WriteInt32(data + idx, delta[axis]) : WriteInt16(data + idx, (int16_t)delta[axis]);
+		}
+
+		if (withFeed)
+			idx += WriteInt32(data + idx, feedrate);
+
+		return idx;
+	}
+};
+
+////////////////////////////////////////////////////////
@@ -147,7 +147,15 @@ public:
 	#define COMMANDSYNTAX_VALUE(a)	(((a)*(1<<COMMANDSYNTAX_BIT))&COMMANDSYNTAX_MASK)
 	#define COMMANDSYNTAX_CLEAR(a)	((a)&~COMMANDSYNTAX_MASK)
 
+#if defined(REDUCED_SIZE) || (!defined(USE_INPUTSHAPING) && !defined(USE_ACCCURVE))
 	#define EPROM_SIGNATURE		0x21436501
+#elif !defined(USE_ACCCURVE)
+	#define EPROM_SIGNATURE		0x21436502		// 02: input shaper of axis
+#elif !defined(USE_INPUTSHAPING)
+	#define EPROM_SIGNATURE		0x21436504		// 04: acc curve of axis
+#else
+	#define EPROM_SIGNATURE		0x21436503		// 03: input shaper and acc curve of axis
+#endif
 
 	struct SCNCEeprom
 	{
@@ -163,8 +171,8 @@ public:
 		uint32_t  info2;
 
 		uint8_t	  stepperdirections;		// bits for each axis, see CStepper::SetDirection
-		uint8_t	  dummy2;
-		uint8_t	  dummy3;
+		uint8_t	  junctionDeviation;		// mm1000 (X axis, 1/STEPFRACTION steps in CStepper), 0 => max jerk, see CStepper::SetJunctionDeviation
+		uint8_t	  curveTolerance;			// mm1000 (X axis, 1/STEPFRACTION steps in CStepper), 0 => off, see CStepper::SetCurveTolerance
 		uint8_t	  spindlefadetime;
 
 		uint16_t  maxspindlespeed;
@@ -198,6 +206,16 @@ public:
 			float		StepsPerMm1000;
 
 			mm1000_t	probesize;
+
+#ifdef USE_INPUTSHAPING
+			uint8_t		inputShaper;			// EInputShaper
+			uint8_t		inputShaperDamping;		// 1/100
+			uint16_t	inputShaperFrequency;	// 1/10 Hz
+#endif
+#ifdef USE_ACCCURVE
+			uint16_t	accCurveSpeed[ACCCURVESIZE];	// steps/sec, sorted, 0 => end of table
+			uint16_t	accCurveFactor[ACCCURVESIZE];	// 1/1000 of acc/dec
+#endif
 #endif
 
 		} axis[NUM_AXIS];
@@ -48,11 +48,34 @@ typedef long inch100000_t;		// 1/100000 inch
 #define SCALE_MM		3
 #define SCALE_INCH		5
 
+#define ARC_CHORDTOLERANCE	2.0			// mm1000, max distance of arc segment to circle
+#define BEZIER_TOLERANCE	2.0			// mm1000, max distance of segment to curve (G5)
+
 ////////////////////////////////////////////////////////
 //
 // Control
 
 #define SERIALBUFFERSIZE	128			// even size 
+#define BLOCKBUFFERSIZE		16			// parsed G0/G1 blocks ahead of the movement queue (2^n), see USE_BLOCKQUEUE
+
+#ifdef SERIAL_RX_BUFFER_SIZE
+#define SERIALRXBUFFERSIZE	SERIAL_RX_BUFFER_SIZE		// receive buffer of HardwareSerial, see m129 (streaming)
+#else
+#define SERIALRXBUFFERSIZE	64
+#endif
+
+// real-time commands (see USE_REALTIMECOMMAND): single chars, not part of a command line
+
+#define REALTIME_STATUS			0x05		// ENQ: print status "<Run|MPos:...|Q:..|Ov:..>"
+#define REALTIME_HOLD			0x0e		// pause movement (with dec ramp)
+#define REALTIME_RESUME			0x0f		// continue after hold
+#define REALTIME_KILL			0x18		// CAN: emergency stop, see "!!!"
+#define REALTIME_OVERRIDE100	0x1c		// speed override 100%
+#define REALTIME_OVERRIDEPLUS	0x1d		// speed override +10%
+#define REALTIME_OVERRIDEMINUS	0x1e		// speed override -10%
+#define REALTIME_OVERRIDEMAXP	190			// max speed override in % (SpeedOverrideMax)
+
+#define ACCCURVESIZE		4			// points of the acc/dec curve of an axis (eeprom), see CStepper::SetAccCurve
 
 #define TIMEOUTCALLIDEL		333			// time in ms after move completet to call Idle
 #define TIMEOUTCALLPOLL		500			// time in ms to call Poll() next if not idle => ASSERT( TIMEOUTCALLPOLL > TIMEOUTCALLIDEL)
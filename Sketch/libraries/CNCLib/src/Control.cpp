@@ -25,7 +25,11 @@
 #include "Lcd.h"
 
 #include "GCodeParser.h"
+#ifdef USE_BINARYPROTOCOL
+#include "GCodeBinaryParser.h"
+#endif
 #include "ConfigEeprom.h"
+#include "DecimalAsInt.h"
 
 ////////////////////////////////////////////////////////////
 
@@ -36,6 +40,16 @@ template<> CControl* CSingleton<CControl>::_instance = NULL;
 CControl::CControl()
 {
 	_bufferidx = 0;
+#ifdef USE_STREAMING
+	_streaming = false;
+#endif
+#ifdef USE_REALTIMECOMMAND
+	_rxLineStart = true;
+	_rxBinary = 0;
+#endif
+	_spindleOverride = CStepper::SpeedOverride100P;
+	_spindleTool = SpindleCW;
+	_spindleLevel = 0;
 }
 
 ////////////////////////////////////////////////////////////
@@ -45,6 +59,10 @@ void CControl::Init()
 	CStepper::GetInstance()->Init();
 	CStepper::GetInstance()->AddEvent(StaticStepperEvent, (uintptr_t) this, _oldStepperEvent);
 
+#ifdef USE_BINARYPROTOCOL
+	CGCodeBinaryParser::Init();
+#endif
+
 #ifdef _USE_LCD
 	
 	if (CLcd::GetInstance())
@@ -114,8 +132,41 @@ void CControl::InitFromEeprom()
 			CMotionControlBase::GetInstance()->SetConversionStepsPerEx();
 			CMotionControlBase::GetInstance()->SetConversionStepsPerEx(axis, stepsperMM1000);
 		}
+
+#ifdef USE_INPUTSHAPING
+		uint16_t inputShaperFrequency = CConfigEeprom::GetConfigU16(offsetof(CConfigEeprom::SCNCEeprom, axis[0].inputShaperFrequency) + ofs);
+		if (inputShaperFrequency != 0)
+		{
+			CStepper::GetInstance()->SetInputShaper(axis,
+				(CStepper::EInputShaper) CConfigEeprom::GetConfigU8(offsetof(CConfigEeprom::SCNCEeprom, axis[0].inputShaper) + ofs),
+				inputShaperFrequency / 10.0f,
+				CConfigEeprom::GetConfigU8(offsetof(CConfigEeprom::SCNCEeprom, axis[0].inputShaperDamping) + ofs) / 100.0f);
+		}
+#endif
+
+#ifdef USE_ACCCURVE
+		uint8_t accCurveSize = 0;
+		for (; accCurveSize < ACCCURVESIZE; accCurveSize++)
+		{
+			uint16_t speed = CConfigEeprom::GetConfigU16(offsetof(CConfigEeprom::SCNCEeprom, axis[0].accCurveSpeed[0]) + ofs + accCurveSize * sizeof(uint16_t));
+			if (speed == 0)
+				break;
+			_accCurve[axis][accCurveSize].input = speed;
+			_accCurve[axis][accCurveSize].output = CConfigEeprom::GetConfigU16(offsetof(CConfigEeprom::SCNCEeprom, axis[0].accCurveFactor[0]) + ofs + accCurveSize * sizeof(uint16_t)) / 1000.0f;
+		}
+		CStepper::GetInstance()->SetAccCurve(axis, _accCurve[axis], accCurveSize);
+#endif
 #endif
 	}
+
+#ifndef REDUCED_SIZE
+	// after the axis loop: StepsPerMm1000 is set
+	// less than 1/STEPFRACTION step => min value (not 0 => off)
+	mm1000_t junctionDeviation = CConfigEeprom::GetConfigU8(offsetof(CConfigEeprom::SCNCEeprom, junctionDeviation));
+	CStepper::GetInstance()->SetJunctionDeviation(junctionDeviation == 0 ? 0 : max((udist_t)1, (udist_t)CMotionControlBase::GetInstance()->ToMachine(X_AXIS, junctionDeviation * STEPFRACTION)));
+	mm1000_t curveTolerance = CConfigEeprom::GetConfigU8(offsetof(CConfigEeprom::SCNCEeprom, curveTolerance));
+	CStepper::GetInstance()->SetCurveTolerance(curveTolerance == 0 ? 0 : max((udist_t)1, (udist_t)CMotionControlBase::GetInstance()->ToMachine(X_AXIS, curveTolerance * STEPFRACTION)));
+#endif
 }
 
 ////////////////////////////////////////////////////////////
@@ -128,6 +179,35 @@ uint8_t CControl::ConvertSpindleSpeedToIO8(unsigned short maxspeed, unsigned sho
 
 ////////////////////////////////////////////////////////////
 
+void CControl::SetSpindleOverride(EnumAsByte(CStepper::ESpeedOverride) speed)
+{
+	// change is applied immediately (not queued), the spindle output fades to the new speed (see SPINDLESMOOTH)
+
+	CCriticalRegion crit;
+
+	_spindleOverride = speed;
+	if (_spindleLevel != 0)
+		IOControlWithOverride(_spindleTool, _spindleLevel);
+}
+
+////////////////////////////////////////////////////////////
+
+void CControl::IOControlWithOverride(uint8_t tool, unsigned short level)
+{
+	if (tool == SpindleCW || tool == SpindleCCW)
+	{
+		_spindleTool = tool;
+		_spindleLevel = level;
+
+		if (_spindleOverride != CStepper::SpeedOverride100P)
+			level = (unsigned short) RoundMulDivU32(level, _spindleOverride, CStepper::SpeedOverride100P);
+	}
+
+	IOControl(tool, level);
+}
+
+////////////////////////////////////////////////////////////
+
 void CControl::GoToReference()
 {
 	for (axis_t i = 0; i < NUM_AXIS; i++)
@@ -180,7 +260,13 @@ void CControl::Kill()
 void CControl::Resurrect()
 {
 	CStepper::GetInstance()->EmergencyStopResurrect();
+#ifdef USE_BLOCKQUEUE
+	CMotionControlBase::GetInstance()->ClearBlocks();
+#endif
 	CMotionControlBase::GetInstance()->SetPositionFromMachine();
+#ifdef USE_BINARYPROTOCOL
+	CGCodeBinaryParser::Init();							// the host restarts with sequence 0 (or sends BINARYCMD_SYNC)
+#endif
 
 #ifdef _USE_LCD
 	
@@ -255,6 +341,14 @@ bool CControl::ParseAndPrintResult(CParser *parser, Stream* output)
 			PrintError(output);
 			output->print(parser->GetError());
 			output->print(MESSAGE_CONTROL_RESULTS);
+#ifdef USE_BINARYPROTOCOL
+			if (IsBinaryFrame())
+			{
+				output->print('#');
+				output->print((uint8_t)_buffer[BINARYFRAME_IDX_SEQ]);
+			}
+			else
+#endif
 			output->print(_buffer);
 //			output->print(millis());
 		}
@@ -264,6 +358,9 @@ bool CControl::ParseAndPrintResult(CParser *parser, Stream* output)
 	{
 		// => not in "else" if "OK" should be sent after "Error:"
 		if (output) output->print(MESSAGE_OK);
+#ifdef USE_STREAMING
+		if (output && _streaming) PrintCredits(output);
+#endif
 		if (parser->GetOkMessage() != NULL)
 		{
 			if (output)
@@ -326,7 +423,11 @@ bool CControl::Command(char* buffer, Stream* output)
 	else if (output)
 	{
 		// send OK on empty line (command)
-		output->println(MESSAGE_OK_EMPTYLINE);
+		output->print(MESSAGE_OK_EMPTYLINE);
+#ifdef USE_STREAMING
+		if (_streaming) PrintCredits(output);
+#endif
+		output->println();
 	}
 	
 	return ret;
@@ -334,6 +435,166 @@ bool CControl::Command(char* buffer, Stream* output)
 
 ////////////////////////////////////////////////////////////
 
+#ifdef USE_BINARYPROTOCOL
+
+bool CControl::BinaryCommand(const uint8_t* frame, Stream* output)
+{
+	if (IsKilled())
+	{
+		if (output)
+		{
+			PrintError(output);
+			output->println(MESSAGE_CONTROL_KILLED);
+		}
+		return false;
+	}
+
+	char endOfCommand = 0;
+	_reader.Init(&endOfCommand);						// parser errors move the reader to the end
+
+	CGCodeBinaryParser binary(&_reader, output, frame);
+	return ParseAndPrintResult(&binary, output);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////
+
+#ifdef USE_STREAMING
+
+void CControl::PrintCredits(Stream* output)
+{
+	// the host may send further lines while the sum of the unanswered lines does not exceed "B"
+	// the line executed now is already removed from the serial receive buffer
+
+	int rxcount = StepperSerial.available();
+#ifdef USE_REALTIMECOMMAND
+	rxcount += _rxLookahead.Count();
+#endif
+	unsigned int freeMovements = CStepper::GetInstance()->FreeMovements();
+
+#ifdef USE_BLOCKQUEUE
+	freeMovements += CMotionControlBase::GetInstance()->GetFreeBlocks();
+#endif
+
+	output->print(F(" Q:"));
+	output->print(freeMovements);
+	output->print(F(" B:"));
+	output->print(rxcount < SERIALRXBUFFERSIZE ? SERIALRXBUFFERSIZE - rxcount : 0);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////
+
+#ifdef USE_REALTIMECOMMAND
+
+void CControl::PollRealtimeCommands()
+{
+	// move the serial input to the lookahead buffer and execute real-time commands immediately
+	// the host does not send more than the free receive buffer (see PrintCredits) => the lookahead buffer will not overflow
+
+	while (!_rxLookahead.IsFull() && StepperSerial.available() > 0)
+	{
+		char ch = StepperSerial.read();
+
+		if (!RealtimeCommand(ch))
+			_rxLookahead.Enqueue(ch);
+	}
+}
+
+////////////////////////////////////////////////////////////
+
+bool CControl::RealtimeCommand(char ch)
+{
+	// return true if ch is a real-time command (not added to the command buffer)
+
+#ifdef USE_BINARYPROTOCOL
+	if (_rxBinary != 0)
+	{
+		// bytes of a binary frame are never real-time commands
+
+		if (_rxBinary == 0xff)
+			_rxBinary = (uint8_t)ch > SERIALBUFFERSIZE - BINARYFRAME_OVERHEAD ? 0 : (uint8_t)ch + 2;		// sequence, payload, crc
+		else
+			_rxBinary--;
+
+		_rxLineStart = _rxBinary == 0;
+		return false;
+	}
+
+	if (_rxLineStart && (uint8_t)ch == BINARYFRAME_SYNC)
+	{
+		_rxBinary = 0xff;								// length follows
+		_rxLineStart = false;
+		return false;
+	}
+#endif
+
+	switch (ch)
+	{
+		case REALTIME_STATUS:	PrintRealtimeStatus(&StepperSerial); return true;
+		case REALTIME_HOLD:		Hold(); return true;
+		case REALTIME_RESUME:	Resume(); return true;
+		case REALTIME_KILL:		Kill(); return true;
+
+		case REALTIME_OVERRIDE100:
+		case REALTIME_OVERRIDEPLUS:
+		case REALTIME_OVERRIDEMINUS:
+		{
+			uint8_t speedInP = CStepper::SpeedOverrideToP(CStepper::GetInstance()->GetSpeedOverride());
+
+			if (ch == REALTIME_OVERRIDE100)												speedInP = 100;
+			else if (ch == REALTIME_OVERRIDEPLUS && speedInP <= REALTIME_OVERRIDEMAXP - 10)	speedInP += 10;
+			else if (ch == REALTIME_OVERRIDEMINUS && speedInP >= 20)						speedInP -= 10;
+
+			CStepper::GetInstance()->SetSpeedOverride(CStepper::PToSpeedOverride(speedInP));
+			return true;
+		}
+	}
+
+	_rxLineStart = IsEndOfCommandChar(ch);
+	return false;
+}
+
+////////////////////////////////////////////////////////////
+
+void CControl::PrintRealtimeStatus(Stream* output)
+{
+	// one line, e.g. "<Run|MPos:1.000:2.000:0.000|F:500|Q:12|Ov:100>" (F: mm/min of the fastest axis)
+
+	CStepper::SStatusSnapshot status;
+	CStepper::GetInstance()->GetStatusSnapshot(status);
+
+	output->print('<');
+	if (status._emergencyStop)			output->print(F("Kill"));
+	else if (status._pause)				output->print(F("Hold"));
+	else if (status._running)			output->print(F("Run"));
+	else								output->print(F("Idle"));
+
+	output->print(F("|MPos:"));
+	for (axis_t axis = 0; axis < NUM_AXIS; axis++)
+	{
+		if (axis != 0)
+			output->print(':');
+
+		char tmp[16];
+		output->print(CMm1000::ToString(CMotionControlBase::ToMm1000(axis, status._current[axis]), tmp, 3));
+	}
+
+	output->print(F("|F:"));
+	output->print(CMotionControlBase::ToMm1000(0, status._speed * 60l) / 1000);
+	output->print(F("|Q:"));
+	output->print(status._queued);
+	output->print(F("|Ov:"));
+	output->print(CStepper::SpeedOverrideToP(CStepper::GetInstance()->GetSpeedOverride()));
+	output->println('>');
+}
+
+#endif
+
+////////////////////////////////////////////////////////////
+
 bool CControl::IsEndOfCommandChar(char ch)
 {
 	//return ch == '\n' || ch == '\r' || ch == -1;
@@ -342,6 +603,64 @@ bool CControl::IsEndOfCommandChar(char ch)
 
 ////////////////////////////////////////////////////////////
 
+bool CControl::AddChar(char ch, Stream* output)
+{
+	// add char to the command buffer, execute the command if complete => return true
+
+	_buffer[_bufferidx] = ch;
+
+#ifdef USE_BINARYPROTOCOL
+	if ((uint8_t)_buffer[0] == BINARYFRAME_SYNC)
+	{
+		// binary frame: no end of command char, size from header
+
+		_bufferidx++;
+		if (_bufferidx > BINARYFRAME_IDX_LENGTH && (uint8_t)_buffer[BINARYFRAME_IDX_LENGTH] > sizeof(_buffer) - BINARYFRAME_OVERHEAD)
+		{
+			if (output)
+			{
+				PrintError(output); output->println(MESSAGE_CONTROL_FLUSHBUFFER);
+			}
+			_bufferidx = 0;
+		}
+		else if (CBinaryProtocol::FrameSize((const uint8_t*)_buffer, _bufferidx))
+		{
+			BinaryCommand((const uint8_t*)_buffer, output);
+			_bufferidx = 0;
+
+			_lasttime = millis();
+
+			return true;
+		}
+		return false;
+	}
+#endif
+
+	if (IsEndOfCommandChar(ch))
+	{
+		_buffer[_bufferidx] = 0;			// remove from buffer 
+		Command(_buffer, output);
+		_bufferidx = 0;
+
+		_lasttime = millis();
+
+		return true;
+	}
+
+	_bufferidx++;
+	if (_bufferidx >= sizeof(_buffer))
+	{
+		if (output)
+		{
+			PrintError(output); output->println(MESSAGE_CONTROL_FLUSHBUFFER);
+		}
+		_bufferidx = 0;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////
+
 void CControl::ReadAndExecuteCommand(Stream* stream, Stream* output, bool filestream)
 {
 	// call this methode if ch is available in stream
@@ -350,21 +669,14 @@ void CControl::ReadAndExecuteCommand(Stream* stream, Stream* output, bool filest
 	{
 		while (stream->available() > 0)
 		{
-			char ch = _buffer[_bufferidx] = stream->read();
-
-			if (IsEndOfCommandChar(ch))
-			{
-				_buffer[_bufferidx] = 0;			// remove from buffer 
-				Command(_buffer, output);
-				_bufferidx = 0;
-
-				_lasttime = millis();
-
+			if (AddChar(stream->read(), output))
 				return;
-			}
+		}
 
-			_bufferidx++;
-			if (_bufferidx >= sizeof(_buffer))
+		if (filestream)						// e.g. SD card => execute last line without "EndOfLine"
+		{
+#ifdef USE_BINARYPROTOCOL
+			if (IsBinaryFrame())
 			{
 				if (output)
 				{
@@ -372,17 +684,7 @@ void CControl::ReadAndExecuteCommand(Stream* stream, Stream* output, bool filest
 				}
 				_bufferidx = 0;
 			}
-/*
-			if (ch == '\x18')
-			{
-				StepperSerial.println(MESSAGE_CTRLX);
-				_bufferidx = 0;
-			}
-*/
-		}
-
-		if (filestream)						// e.g. SD card => execute last line without "EndOfLine"
-		{
+#endif
 			if (_bufferidx > 0)
 			{
 				_buffer[_bufferidx + 1] = 0;
@@ -398,11 +700,33 @@ void CControl::ReadAndExecuteCommand(Stream* stream, Stream* output, bool filest
 
 bool CControl::SerialReadAndExecuteCommand()
 {
+#ifdef USE_REALTIMECOMMAND
+
+	// real-time commands are removed while reading the serial input, see PollRealtimeCommands
+
+	PollRealtimeCommands();
+
+	if (!_rxLookahead.IsEmpty())
+	{
+		while (!_rxLookahead.IsEmpty())
+		{
+			char ch = _rxLookahead.Head();
+			_rxLookahead.Dequeue();
+			if (AddChar(ch, &StepperSerial))
+				break;
+		}
+		_lasttime = millis();
+	}
+
+#else
+
 	if (StepperSerial.available() > 0)
 	{
 		ReadAndExecuteCommand(&StepperSerial, &StepperSerial, false);			
 	}
 
+#endif
+
 	return _bufferidx > 0;		// command pending, buffer not empty
 }
 
@@ -423,7 +747,7 @@ void CControl::Run()
 	Init();
 	Initialized();
 
-#ifdef _MSC_VER
+#if defined(_MSC_VER) || defined(__linux__)
 	while (!CGCodeParserBase::_exit)
 #else
 	while (true)
@@ -452,6 +776,14 @@ void CControl::Run()
 
 void CControl::CheckIdlePoll(bool isidle)
 {
+#ifdef USE_REALTIMECOMMAND
+	PollRealtimeCommands();									// also if the parser waits for a free entry of the movement queue
+#endif
+
+#ifdef USE_BLOCKQUEUE
+	CMotionControlBase::GetInstance()->PollBlocks();		// parsed blocks to free entries of the movement queue
+#endif
+
 	unsigned long time = millis();
 
 	if (isidle && _lasttime + TIMEOUTCALLIDEL < time)
@@ -589,7 +921,7 @@ bool CControl::OnEvent(EnumAsByte(EStepperControlEvent) eventtype, uintptr_t add
 
 		case OnIoEvent:
 			
-			IOControl(((CStepper::SIoControl*) addinfo)->_tool, ((CStepper::SIoControl*) addinfo)->_level);
+			IOControlWithOverride(((CStepper::SIoControl*) addinfo)->_tool, ((CStepper::SIoControl*) addinfo)->_level);
 			break;
 	}
 	return true;
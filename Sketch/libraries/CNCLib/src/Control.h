@@ -25,6 +25,7 @@
 #include "Parser.h"
 #include "Lcd.h"
 #include "MenuBase.h"
+#include "BinaryProtocol.h"
 
 ////////////////////////////////////////////////////////
 
@@ -130,6 +131,9 @@ public:
 	void InitFromEeprom();
 	static uint8_t ConvertSpindleSpeedToIO8(unsigned short maxspeed, unsigned short level); // { return (uint8_t)MulDivU32(abs(level), 255, maxspeed); }
 
+	void SetSpindleOverride(EnumAsByte(CStepper::ESpeedOverride) speed);		// change speed of running spindle
+	EnumAsByte(CStepper::ESpeedOverride) GetSpindleOverride()	{ return _spindleOverride; }
+
 	//////////////////////////////////////////
 
 	void StartPrintFromSD()				{ _printFromSDFile = true; }
@@ -143,9 +147,22 @@ public:
 
 	//////////////////////////////////////////
 
+#ifdef USE_STREAMING
+	void SetStreaming(bool streaming)	{ _streaming = streaming; }	// see m129
+	bool IsStreaming()					{ return _streaming; }
+#endif
+
+	//////////////////////////////////////////
+
 	const char* GetBuffer()				{ return _buffer; }
 	uint8_t GetBufferCount()			{ return _bufferidx; }
+#ifdef USE_REALTIMECOMMAND
+	bool IsLookaheadEmpty()				{ return _rxLookahead.IsEmpty(); }	// serial input read, but not executed
+#endif
 	virtual bool IsEndOfCommandChar(char ch);					// override default End of command char, default \n
+#ifdef USE_REALTIMECOMMAND
+	virtual bool RealtimeCommand(char ch);						// execute real-time command (see REALTIME_xxx), return false if ch is not a real-time command
+#endif
 
 protected:
 
@@ -157,6 +174,9 @@ protected:
 
 	virtual bool Parse(CStreamReader* reader, Stream* output);	// specify Parser, default parser
 	virtual bool Command(char* xbuffer, Stream* output);		// execute Command (call parser)
+#ifdef USE_BINARYPROTOCOL
+	virtual bool BinaryCommand(const uint8_t* frame, Stream* output);	// execute binary frame (see BinaryProtocol.h)
+#endif
 	virtual void Idle(unsigned int idletime);					// called after TIMEOUTCALLIDEL in idle state
 	virtual void Poll();										// call in Idle and at least e.g. 100ms (not in interrupt), see CheckIdlePoll
 	virtual void ReadAndExecuteCommand();						// read and execute commands from other source e.g. SD.File
@@ -176,9 +196,16 @@ protected:
 private:
 
 	void ReadAndExecuteCommand(Stream* stream, Stream* output, bool filestream);	// read command until "IsEndOfCommandChar" and execute command (Serial or SD.File)
+	bool AddChar(char ch, Stream* output);						// add to command buffer, execute command if complete (return true)
 
 	void CheckIdlePoll(bool isidle);							// check idle time and call Idle every 100ms
 
+	void IOControlWithOverride(uint8_t tool, unsigned short level);	// apply spindle override
+
+#ifdef USE_BINARYPROTOCOL
+	bool IsBinaryFrame()										{ return _bufferidx > 0 && (uint8_t)_buffer[0] == BINARYFRAME_SYNC; }
+#endif
+
 
 	uint8_t			_bufferidx;									// read Buffer index , see SERIALBUFFERSIZE
 
@@ -190,9 +217,20 @@ private:
 
 	bool			_dummy;										// see gcode m01 & m02
 	bool			_printFromSDFile;
+#ifdef USE_STREAMING
+	bool			_streaming;									// "ok" with credits, see m129
+#endif
+
+	EnumAsByte(CStepper::ESpeedOverride) _spindleOverride;		// 128 => 100%
+	uint8_t			_spindleTool;								// last spindle command (SpindleCW/SpindleCCW)
+	unsigned short	_spindleLevel;								// last spindle speed (without override)
 
 	char			_buffer[SERIALBUFFERSIZE];					// serial input buffer
 
+#if defined(USE_ACCCURVE) && !defined(REDUCED_SIZE)
+	CStepper::CAccCurve::SLookupTable _accCurve[NUM_AXIS][ACCCURVESIZE];	// copy of eeprom, see InitFromEeprom
+#endif
+
 	static void HandleInterrupt()								{ GetInstance()->TimerInterrupt(); }
 
 	static bool StaticStepperEvent(CStepper*stepper, uintptr_t param, EnumAsByte(CStepper::EStepperEvent) eventtype, uintptr_t addinfo);
@@ -200,7 +238,19 @@ private:
 
 	CStreamReader		_reader;
 
+#ifdef USE_REALTIMECOMMAND
+	CRingBufferQueue<char, SERIALRXBUFFERSIZE> _rxLookahead;	// serial input without real-time commands
+	bool			_rxLineStart;								// next char is the first of a command
+	uint8_t			_rxBinary;									// remaining bytes of a binary frame (0xff: length expected)
+
+	void PollRealtimeCommands();								// read serial input, execute real-time commands
+	void PrintRealtimeStatus(Stream* output);
+#endif
+
 	void PrintError(Stream* output)								{ output->print(MESSAGE_ERROR); }
+#ifdef USE_STREAMING
+	void PrintCredits(Stream* output);							// streaming: free movement queue and serial receive buffer
+#endif
 
 public:
 
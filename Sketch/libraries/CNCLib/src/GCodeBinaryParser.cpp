@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <Arduino.h>
+#include <StepperLib.h>
+
+#include "Control.h"
+#include "MotionControlBase.h"
+
+#include "GCodeBinaryParser.h"
+
+////////////////////////////////////////////////////////////
+
+uint8_t CGCodeBinaryParser::_nextSequence = 0;
+
+////////////////////////////////////////////////////////////
+
+void CGCodeBinaryParser::Parse()
+{
+	if (!CBinaryProtocol::IsCRCValid(_frame))			{ Error(MESSAGE(MESSAGE_BINARY_CRCError)); return; }
+
+	uint8_t seq = _frame[BINARYFRAME_IDX_SEQ];
+	uint8_t length = _frame[BINARYFRAME_IDX_LENGTH] - 1;
+	const uint8_t* data = _frame + BINARYFRAME_IDX_DATA;
+
+	if (_frame[BINARYFRAME_IDX_CMD] == BINARYCMD_SYNC)
+	{
+		_nextSequence = seq + 1;
+		return;
+	}
+
+	// frame lost (or sent twice) => the host must resend from the expected sequence number
+
+	if (seq != _nextSequence)							{ Error(MESSAGE(MESSAGE_BINARY_SequenceError)); return; }
+	_nextSequence++;
+
+	switch (_frame[BINARYFRAME_IDX_CMD])
+	{
+		case BINARYCMD_MOVE:	MoveCommand(data, length); break;
+		default:				Error(MESSAGE(MESSAGE_BINARY_UnknownCommand)); break;
+	}
+
+	CheckError();
+}
+
+////////////////////////////////////////////////////////////
+
+void CGCodeBinaryParser::MoveCommand(const uint8_t* data, uint8_t length)
+{
+	// same as G0/G1 with relative (mm1000) coordinates
+
+	if (length < 2)										{ Error(MESSAGE(MESSAGE_BINARY_InvalidLength)); return; }
+
+	uint8_t flags = data[0];
+	uint8_t axes = data[1];
+	bool isG00 = (flags & BINARYMOVE_RAPID) != 0;
+	uint8_t deltasize = (flags & BINARYMOVE_DELTA32) ? 4 : 2;
+
+	if (axes >= (1 << NUM_AXIS))						{ Error(MESSAGE(MESSAGE_BINARY_InvalidAxis)); return; }
+
+	uint8_t idx = 2;
+	for (axis_t axis = 0; axis < NUM_AXIS; axis++)
+	{
+		if (axes & (1 << axis)) idx += deltasize;
+	}
+	if (flags & BINARYMOVE_FEED) idx += 4;
+
+	if (idx != length)									{ Error(MESSAGE(MESSAGE_BINARY_InvalidLength)); return; }
+
+	mm1000_t newpos[NUM_AXIS];
+	CMotionControlBase::GetInstance()->GetPositions(newpos);
+
+	idx = 2;
+	for (axis_t axis = 0; axis < NUM_AXIS; axis++)
+	{
+		if (axes & (1 << axis))
+		{
+			newpos[axis] += deltasize == 4 ? CBinaryProtocol::ReadInt32(data + idx) : CBinaryProtocol::ReadInt16(data + idx);
+			idx += deltasize;
+		}
+	}
+
+	if (flags & BINARYMOVE_FEED)
+	{
+		if (isG00)										{ Error(MESSAGE(MESSAGE_GCODE_FeedrateWithG0)); return; }
+		if (!_modalstate.FeedRatePerUnit)				{ ErrorNotImplemented(); return; }
+
+		feedrate_t feedrate = CBinaryProtocol::ReadInt32(data + idx);
+
+		if (feedrate < FEEDRATE_MIN_ALLOWED)	  feedrate = FEEDRATE_MIN_ALLOWED;
+		if (feedrate > _modalstate.G1MaxFeedRate) feedrate = _modalstate.G1MaxFeedRate;
+
+		SetG1FeedRate(feedrate);
+	}
+
+	if (axes)
+	{
+		MoveStart(!isG00);
+		CMotionControlBase::GetInstance()->QueueBlock(newpos, isG00 ? _modalstate.G0FeedRate : _modalstate.G1FeedRate);
+		ConstantVelocity();
+	}
+}
@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#pragma once
+
+////////////////////////////////////////////////////////
+
+#include "GCodeParserBase.h"
+#include "BinaryProtocol.h"
+
+////////////////////////////////////////////////////////
+//
+// Parser of one binary frame (see BinaryProtocol.h) 
+// shares the modal state (feedrate, cutmove, ...) with the gcode parser
+//
+class CGCodeBinaryParser : public CGCodeParserBase
+{
+private:
+
+	typedef CGCodeParserBase super;
+
+public:
+
+	CGCodeBinaryParser(CStreamReader* reader, Stream* output, const uint8_t* frame) : super(reader, output)		{ _frame = frame; };
+
+	static void Init()											{ _nextSequence = 0; }
+
+protected:
+
+	virtual void Parse() override;
+
+private:
+
+	const uint8_t*	_frame;
+
+	static uint8_t	_nextSequence;
+
+	void MoveCommand(const uint8_t* data, uint8_t length);
+};
+
+////////////////////////////////////////////////////////
@@ -240,6 +240,10 @@ mm1000_t CGCodeParser::GetParamValue(param_t paramNo, bool convertUnits)
 			case PARAMSTART_ACC:				return CStepper::GetInstance()->GetAcc(axis);
 			case PARAMSTART_DEC:				return CStepper::GetInstance()->GetDec(axis);
 			case PARAMSTART_JERK:				return CStepper::GetInstance()->GetJerkSpeed(axis);
+#ifndef REDUCED_SIZE
+			case PARAMSTART_JUNCTIONDEVIATION:	return GetParamAsFraction(CStepper::GetInstance()->GetJunctionDeviation(), X_AXIS);
+			case PARAMSTART_CURVETOLERANCE:		return GetParamAsFraction(CStepper::GetInstance()->GetCurveTolerance(), X_AXIS);
+#endif
 
 			case PARAMSTART_G54OFFSET + 0 * PARAMSTART_G54FF_OFFSET:
 			case PARAMSTART_G54OFFSET + 1 * PARAMSTART_G54FF_OFFSET:
@@ -295,6 +299,23 @@ void CGCodeParser::SetParamValue(param_t paramNo)
 				case PARAMSTART_ACC:				{ CStepper::GetInstance()->SetAcc(axis, (steprate_t)intvalue); break;	}
 				case PARAMSTART_DEC:				{ CStepper::GetInstance()->SetDec(axis, (steprate_t)intvalue); break;	}
 				case PARAMSTART_JERK:				{ CStepper::GetInstance()->SetJerkSpeed(axis, (steprate_t)intvalue); break; }
+#ifndef REDUCED_SIZE
+				case PARAMSTART_JUNCTIONDEVIATION:
+				{
+					// less than 1/STEPFRACTION step => error (not 0 => off)
+					udist_t deviation = GetParamAsMachineFraction(mm1000, X_AXIS);
+					if (mm1000 < 0 || (mm1000 != 0 && deviation == 0))	{ Error(MESSAGE_PARSER_ValueLessThanMin); return; }
+					CStepper::GetInstance()->SetJunctionDeviation(deviation);
+					break;
+				}
+				case PARAMSTART_CURVETOLERANCE:
+				{
+					udist_t tolerance = GetParamAsMachineFraction(mm1000, X_AXIS);
+					if (mm1000 < 0 || (mm1000 != 0 && tolerance == 0))	{ Error(MESSAGE_PARSER_ValueLessThanMin); return; }
+					CStepper::GetInstance()->SetCurveTolerance(tolerance);
+					break;
+				}
+#endif
 
 				case PARAMSTART_G54OFFSET + 0 * PARAMSTART_G54FF_OFFSET:
 				case PARAMSTART_G54OFFSET + 1 * PARAMSTART_G54FF_OFFSET:
@@ -382,6 +403,10 @@ static const char _maxPos[] PROGMEM = "_maxPos";
 static const char _acc[] PROGMEM = "_acc";
 static const char _dec[] PROGMEM = "_dec";
 static const char _jerk[] PROGMEM = "_jerk";
+#ifndef REDUCED_SIZE
+static const char _junctiondev[] PROGMEM = "_junctiondev";
+static const char _curvetol[] PROGMEM = "_curvetol";
+#endif
 static const char _fan[] PROGMEM = "_fan";
 static const char _g0feedrate[] PROGMEM = "_g0feedrate";
 static const char _xPos[] PROGMEM = "_x";
@@ -420,6 +445,10 @@ const CGCodeParser::SParamInfo CGCodeParser::_paramdef[] PROGMEM =
 	{ PARAMSTART_ACC,			_acc,		true,			CGCodeParser::SParamInfo::IsInt },
 	{ PARAMSTART_DEC,			_dec,		true,			CGCodeParser::SParamInfo::IsInt },
 	{ PARAMSTART_JERK,			_jerk,		true,			CGCodeParser::SParamInfo::IsInt },
+#ifndef REDUCED_SIZE
+	{ PARAMSTART_JUNCTIONDEVIATION,	_junctiondev,false,		CGCodeParser::SParamInfo::IsMm1000 },
+	{ PARAMSTART_CURVETOLERANCE,	_curvetol,	false,		CGCodeParser::SParamInfo::IsMm1000 },
+#endif
 	{ PARAMSTART_CONTROLLERFAN,	_fan,		false,			CGCodeParser::SParamInfo::IsInt },
 	{ PARAMSTART_RAPIDMOVEFEED,	_g0feedrate,false,			CGCodeParser::SParamInfo::IsMm1000 },
 
@@ -565,6 +594,7 @@ bool CGCodeParser::GCommand(uint8_t gcode)
 
 	switch (gcode)
 	{
+		case 5:		G05Command(); return true;
 		case 10:	G10Command(); return true;
 		case 38:	G38Command(); return true;
 		case 40:	G40Command(); return true;
@@ -609,7 +639,11 @@ bool CGCodeParser::MCommand(mcode_t mcode)
 		case 110: M110Command(); return true;
 		case 111: M111Command(); return true;
 		case 114: M114Command(); return true;
+#ifdef USE_STREAMING
+		case 129: M129Command(); return true;
+#endif
 		case 220: M220Command(); return true;
+		case 221: M221Command(); return true;
 #ifndef REDUCED_SIZE
 		case 300: M300Command(); return true;
 #endif
@@ -792,6 +826,111 @@ void CGCodeParser::G10Command()
 
 ////////////////////////////////////////////////////////////
 
+void CGCodeParser::GetG5PQ(SAxisMove& move, char ch, mm1000_t offset[2])
+{
+	if (ch == 'P')
+	{
+		if (move.bitfield.bit.P)	{ Error(MESSAGE_GCODE_PalreadySpecified); return; }
+		move.bitfield.bit.P = true;
+	}
+	else
+	{
+		if (move.bitfield.bit.Q)	{ Error(MESSAGE_GCODE_QalreadySpecified); return; }
+		move.bitfield.bit.Q = true;
+	}
+
+	_reader->GetNextChar();
+	axis_t axis = ch == 'P' ? super::_modalstate.Plane_axis_0 : super::_modalstate.Plane_axis_1;
+	offset[ch == 'P' ? 0 : 1] = ParseCoordinateAxis(axis);
+}
+
+////////////////////////////////////////////////////////////
+
+void CGCodeParser::G05Command()
+{
+	uint8_t subCode = GetSubCode();
+
+	switch (subCode)
+	{
+		case 255:	G050Command(); break;
+		case 1:		G051Command(); break;
+		default:	ErrorNotImplemented(); return;
+	}
+}
+
+////////////////////////////////////////////////////////////
+
+void CGCodeParser::G0505Command(bool isQuadratic)
+{
+	// G5 X Y I J P Q:	cubic, IJ: first control point relative to start, PQ: second control point relative to end
+	//					IJ may be omitted after G5 => first control point is the reflection of the last one
+	// G5.1 X Y I J:	quadratic, IJ: control point relative to start
+
+	super::_modalstate.LastCommand = isQuadratic ? (LastCommandCB) &CGCodeParser::G051Command : (LastCommandCB) &CGCodeParser::G050Command;
+
+	SAxisMove move(true);
+	mm1000_t offset[2] = { 0, 0 };
+	mm1000_t offsetEnd[2] = { 0, 0 };
+
+	for (char ch = _reader->SkipSpacesToUpper(); ch; ch = _reader->SkipSpacesToUpper())
+	{
+		axis_t axis;
+		if ((axis = CharToAxis(ch)) < NUM_AXIS)				GetAxis(axis, move, super::_modalstate.IsAbsolut ? AbsolutWithZeroShiftPosition : RelativPosition);
+		else if ((axis = CharToAxisOffset(ch)) < NUM_AXIS)	GetIJK(axis, move, offset);
+		else if ((ch == 'P' || ch == 'Q') && !isQuadratic)	GetG5PQ(move, ch, offsetEnd);
+		else if (ch == 'F')									GetFeedrate(move);
+		else break;
+
+		if (CheckError()) { return; }
+	}
+
+	axis_t axis0 = super::_modalstate.Plane_axis_0;
+	axis_t axis1 = super::_modalstate.Plane_axis_1;
+
+	mm1000_t start[2] = { CMotionControlBase::GetInstance()->GetPosition(axis0), CMotionControlBase::GetInstance()->GetPosition(axis1) };
+	mm1000_t end[2] = { move.newpos[axis0], move.newpos[axis1] };
+	mm1000_t control1[2];
+	mm1000_t control2[2];
+
+	uint8_t ij = move.GetIJK();
+	bool continueG5 = ij == 0 && !isQuadratic && super::_modalstate.G5Valid && _modalstate.G5End[0] == start[0] && _modalstate.G5End[1] == start[1];
+
+	if (isQuadratic)
+	{
+		if (ij == 0)														{ Error(MESSAGE(MESSAGE_GCODE_MissingIJorPQ)); return; }
+
+		// elevate to cubic: control = start + 2/3 (q - start), end + 2/3 (q - end)
+
+		for (uint8_t i = 0; i < 2; i++)
+		{
+			mm1000_t q = start[i] + offset[i];
+			control1[i] = start[i] + RoundMulDivI32(offset[i], 2, 3);
+			control2[i] = end[i] + RoundMulDivI32(q - end[i], 2, 3);
+		}
+	}
+	else
+	{
+		if (!move.bitfield.bit.P || !move.bitfield.bit.Q)					{ Error(MESSAGE(MESSAGE_GCODE_MissingIJorPQ)); return; }
+		if (!continueG5 && !(IsBitSet(ij, axis0) && IsBitSet(ij, axis1)))	{ Error(MESSAGE(MESSAGE_GCODE_MissingIJorPQ)); return; }
+
+		for (uint8_t i = 0; i < 2; i++)
+		{
+			control1[i] = continueG5 ? 2 * start[i] - _modalstate.G5Control2[i] : start[i] + offset[i];
+			control2[i] = end[i] + offsetEnd[i];
+		}
+	}
+
+	memcpy(_modalstate.G5Control2, control2, sizeof(control2));
+	memcpy(_modalstate.G5End, end, sizeof(end));
+
+	MoveStart(true);
+	super::_modalstate.G5Valid = !isQuadratic;
+	CMotionControlBase::GetInstance()->Bezier(move.newpos, control1, control2, axis0, axis1, super::_modalstate.G1FeedRate);
+	ConstantVelocity();
+}
+
+////////////////////////////////////////////////////////////
+
 void CGCodeParser::G38Command()
 {
 	uint8_t subCode = GetSubCode();
@@ -973,7 +1112,7 @@ void CGCodeParser::G68CommandDefault()
 	}
 
 	SAxisMove move(true);
-	mm1000_t r;
+	mm1000_t r = 0;
 	mm1000_t offset[NUM_AXISXYZ] = { 0, 0, 0 };
 	mm1000_t vect[NUM_AXISXYZ] = { 0, 0, 0 };
 
@@ -1457,18 +1596,90 @@ void CGCodeParser::M114Command()
 }
 
 
+////////////////////////////////////////////////////////////
+
+EnumAsByte(CStepper::ESpeedOverride) CGCodeParser::GetSpeedOverride()
+{
+	// value in %, limited to SpeedOverrideMin .. SpeedOverrideMax
+
+	uint8_t speedInP = GetUInt8();
+	uint8_t speedInPMax = CStepper::SpeedOverrideToP(CStepper::SpeedOverrideMax);
+
+	if (speedInP > speedInPMax)
+		speedInP = speedInPMax;
+
+	EnumAsByte(CStepper::ESpeedOverride) speed = CStepper::PToSpeedOverride(speedInP);
+	return speed < CStepper::SpeedOverrideMin ? CStepper::SpeedOverrideMin : speed;
+}
+
+////////////////////////////////////////////////////////////
+
+#ifdef USE_STREAMING
+
+void CGCodeParser::M129Command()
+{
+	// streaming mode: M129 [S0|S1] (default S1)
+	// "ok" is followed by the free movement queue entries and the free serial receive buffer, e.g. "ok Q:15 B:64"
+
+	uint8_t streaming = 1;
+
+	if (_reader->SkipSpacesToUpper() == 'S')
+	{
+		_reader->GetNextChar();
+		streaming = GetUInt8();
+	}
+
+	if (!ExpectEndOfCommand()) { return; }
+
+	CControl::GetInstance()->SetStreaming(streaming != 0);
+}
+
+#endif
+
 ////////////////////////////////////////////////////////////
 
 void CGCodeParser::M220Command()
 {
-	// set speed override
+	// set speed override: M220 [S feed] [R rapid]
+	// the running move changes speed with a ramp
+
+	bool found = false;
+
+	for (char ch = _reader->SkipSpacesToUpper(); ch == 'S' || ch == 'R'; ch = _reader->SkipSpacesToUpper())
+	{
+		_reader->GetNextChar();
+		EnumAsByte(CStepper::ESpeedOverride) speed = GetSpeedOverride();
+		if (IsError()) return;
+
+		if (ch == 'S')
+			CStepper::GetInstance()->SetSpeedOverride(speed);
+		else
+			CStepper::GetInstance()->SetRapidOverride(speed);
+
+		found = true;
+	}
+
+	if (!found)
+	{
+		Error(MESSAGE_GCODE_SExpected);
+		return;
+	}
+
+	if (!ExpectEndOfCommand()) { return; }
+}
+
+////////////////////////////////////////////////////////////
+
+void CGCodeParser::M221Command()
+{
+	// set spindle override: M221 S
 
 	if (_reader->SkipSpacesToUpper() == 'S')
 	{
 		_reader->GetNextChar();
-		uint8_t speedInP = GetUInt8();
+		EnumAsByte(CStepper::ESpeedOverride) speed = GetSpeedOverride();
 		if (IsError()) return;
-		CStepper::GetInstance()->SetSpeedOverride(CStepper::PToSpeedOverride(speedInP));
+		CControl::GetInstance()->SetSpindleOverride(speed);
 	}
 	else
 	{
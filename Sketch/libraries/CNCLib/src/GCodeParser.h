@@ -30,7 +30,7 @@ typedef unsigned short param_t;
 
 #define NUM_MAXPARAMNAMELENGTH 16
 
-#if defined(__SAM3X8E__) || defined(__SAMD21G18A__) || defined(_MSC_VER)
+#if defined(__SAM3X8E__) || defined(__SAMD21G18A__) || defined(_MSC_VER) || defined(__linux__)
 
 #define NUM_PARAMETER	16
 #define G54ARRAYSIZE	6
@@ -65,6 +65,8 @@ typedef unsigned short param_t;
 #define PARAMSTART_ACC				6091	// Acc (X Y Z A B C U V W)
 #define PARAMSTART_DEC				6111	// Dec (X Y Z A B C U V W)
 #define PARAMSTART_JERK				6131	// Jerk (X Y Z A B C U V W)
+#define PARAMSTART_JUNCTIONDEVIATION 6151	// Junction deviation in current units(e.g. mm) (0 => max jerk)
+#define PARAMSTART_CURVETOLERANCE	6152	// Curve tolerance in current units(e.g. mm) (0 if disabled)
 
 #define PARAMSTART_CONTROLLERFAN	6900	// Controllerfan if not idle (0 if disabled, 255 max)
 #define PARAMSTART_RAPIDMOVEFEED	6901	// RapidMove Feedrate
@@ -156,6 +158,9 @@ protected:
 		mm1000_t		G38ProbePos[NUM_AXIS];
 		mm1000_t		ToolHeigtCompensation;
 
+		mm1000_t		G5Control2[2];				// last G5: second control point and end (plane axis 0/1), G5 without IJ => reflect last control point (see G5Valid)
+		mm1000_t		G5End[2];
+
 		float			Parameter[NUM_PARAMETER];	// this is a expression, mm or inch
 
 		void Init()	
@@ -205,6 +210,8 @@ protected:
 	static mm1000_t GetParamAsPosition(mm1000_t posInMachine, axis_t axis)		{ return CMotionControlBase::GetInstance()->ToMm1000(axis, posInMachine); }
 	static mm1000_t GetParamAsMachine(mm1000_t posInmm1000, axis_t axis)		{ return CMotionControlBase::GetInstance()->ToMachine(axis, posInmm1000); }
 	static mm1000_t GetParamAsFeedrate(mm1000_t feedrate, axis_t axis)			{ return CMotionControlBase::GetInstance()->ToMachine(axis, feedrate / 60); }
+	static mm1000_t GetParamAsFraction(udist_t fractionInMachine, axis_t axis)	{ return (CMotionControlBase::GetInstance()->ToMm1000(axis, fractionInMachine) + STEPFRACTION / 2) / STEPFRACTION; }	// 1/STEPFRACTION steps
+	static udist_t GetParamAsMachineFraction(mm1000_t posInmm1000, axis_t axis)	{ return CMotionControlBase::GetInstance()->ToMachine(axis, posInmm1000 * STEPFRACTION); }
 
 	mm1000_t GetRelativePosition(mm1000_t pos, axis_t axis)				{ return pos - GetG92PosPreset(axis) - GetG54PosPreset(axis); }
 	mm1000_t GetRelativePosition(axis_t axis)							{ return GetRelativePosition(CMotionControlBase::GetInstance()->GetPosition(axis), axis); }
@@ -218,7 +225,12 @@ private:
 	void GetQ81(SAxisMove& move);
 	void GetL81(SAxisMove& move, uint8_t& l);
 	void GetAngleR(SAxisMove& move, mm1000_t& angle);		// get angle (with R Parameter)
+	void GetG5PQ(SAxisMove& move, char ch, mm1000_t offset[2]);
 
+	void G05Command();
+	void G050Command()							{ G0505Command(false); }		// cubic spline
+	void G051Command()							{ G0505Command(true); }		// quadratic spline
+	void G0505Command(bool isQuadratic);
 	void G10Command();
 	void G38Command();
 	void G40Command()							{ _modalstate.CutterRadiusCompensation = SModalState::CutterRadiusOff; }
@@ -254,7 +266,11 @@ private:
 	void M111Command();		// Set debug level
 	void M114Command();		// Report Position
 
-	void M220Command();		// Set Speed override
+	void M220Command();		// Set Speed override (feed and rapid)
+	void M221Command();		// Set Spindle override
+#ifdef USE_STREAMING
+	void M129Command();		// Streaming mode (ok with credits)
+#endif
 	void M300Command();		// Play Song
 
 	void G38CenterProbe(bool probevalue);
@@ -264,6 +280,8 @@ private:
 
 	void CommandEscape();
 
+	EnumAsByte(CStepper::ESpeedOverride) GetSpeedOverride();
+
 	void CNCLibCommandExtensions();
 	/////////////////
 	// OK Message
@@ -30,7 +30,7 @@
 
 ////////////////////////////////////////////////////////////
 
-#ifdef _MSC_VER
+#if defined(_MSC_VER) || defined(__linux__)
 
 bool CGCodeParserBase::_exit = false;
 
@@ -252,8 +252,12 @@ bool CGCodeParserBase::ParseLineNumber()
 
 void CGCodeParserBase::MoveStart(bool cutmove)
 { 
+	if (cutmove != _modalstate.CutMove)
+		FlushBlocks();						// event may switch an io (e.g. laser)
+
 	CControl::GetInstance()->CallOnEvent(CControl::OnStartCut, cutmove);
 	_modalstate.CutMove = cutmove;
+	_modalstate.G5Valid = false;
 }
 
 ////////////////////////////////////////////////////////////
@@ -270,6 +274,7 @@ void CGCodeParserBase::ConstantVelocity()
 
 void CGCodeParserBase::Wait(unsigned long ms)
 {
+	FlushBlocks();
 	CStepper::GetInstance()->Wait(ms/10);
 }
 
@@ -277,6 +282,7 @@ void CGCodeParserBase::Wait(unsigned long ms)
 
 void CGCodeParserBase::Sync()
 {
+	FlushBlocks();
 	CStepper::GetInstance()->WaitBusy();
 #ifdef _USE_LCD
 	CControl::GetInstance()->Delay(0);
@@ -319,7 +325,11 @@ void CGCodeParserBase::Parse()
 				{
 					Error(MESSAGE(MESSAGE_GCODE_CommandExpected));		return;
 				}
-				if (!GCommand(GetGCode()))
+				gcode_t gcode = GetGCode();
+				if (!IsBlockGCode(gcode))
+					FlushBlocks();
+
+				if (!GCommand(gcode))
 				{
 					Error(MESSAGE(MESSAGE_GCODE_UnsupportedGCommand));	return;
 				}
@@ -331,6 +341,7 @@ void CGCodeParserBase::Parse()
 				{
 					Error(MESSAGE(MESSAGE_GCODE_MCodeExpected));		return;
 				}
+				FlushBlocks();
 				if (!MCommand(GetMCode()))
 				{
 					Error(MESSAGE(MESSAGE_GCODE_UnspportedMCodeIgnored));	return;
@@ -339,6 +350,7 @@ void CGCodeParserBase::Parse()
 			}
 			case '$':
 			{
+				FlushBlocks();
 				_reader->GetNextChar();
 				if (CSingleton<CConfigEeprom>::GetInstance() == NULL || !CSingleton<CConfigEeprom>::GetInstance()->ParseConfig(this) )
 				{
@@ -350,15 +362,19 @@ void CGCodeParserBase::Parse()
 			}
 			case '?':
 			{
+				FlushBlocks();
 				_reader->GetNextChar();
 				_OkMessage = PrintInfo;
 				break;
 			}
 
 			default:
-#ifdef _MSC_VER
+#if defined(_MSC_VER) || defined(__linux__)
 				if (IsToken(F("X"), true, false)) { _exit = true; return; }
 #endif
+				if (CharToAxis(ch) >= NUM_AXIS || !IsBlockLastCommand())
+					FlushBlocks();
+
 				if (!Command(ch))
 				{
 					if (!LastCommand())
@@ -622,6 +638,34 @@ void CGCodeParserBase::GetG92Axis(axis_t axis, uint8_t& axes)
 
 ////////////////////////////////////////////////////////////
 
+bool CGCodeParserBase::IsBlockGCode(gcode_t gcode)
+{
+	// G0/G1 or modal state of the parser only => no other access to the stepper, parsed blocks must not be flushed
+
+	switch (gcode)
+	{
+		case 0:
+		case 1:
+		case 17:
+		case 18:
+		case 19:
+		case 20:
+		case 21:
+		case 90:
+		case 91:	return true;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////
+
+bool CGCodeParserBase::IsBlockLastCommand()
+{
+	return _modalstate.LastCommand == &CGCodeParserBase::G00Command || _modalstate.LastCommand == &CGCodeParserBase::G01Command;
+}
+
+////////////////////////////////////////////////////////////
+
 bool CGCodeParserBase::LastCommand()
 {
 	const char* old = _reader->GetBuffer();
@@ -675,7 +719,7 @@ void CGCodeParserBase::G0001Command(bool isG00)
 	if (move.axes)
 	{
 		MoveStart(!isG00);
-		CMotionControlBase::GetInstance()->MoveAbs(move.newpos, useG0Feed ? _modalstate.G0FeedRate : _modalstate.G1FeedRate);
+		CMotionControlBase::GetInstance()->QueueBlock(move.newpos, useG0Feed ? _modalstate.G0FeedRate : _modalstate.G1FeedRate);
 		ConstantVelocity();
 	}
 }
@@ -687,7 +731,7 @@ void CGCodeParserBase::G0203Command(bool isG02)
 	_modalstate.LastCommand = isG02 ? &CGCodeParserBase::G02Command : &CGCodeParserBase::G03Command;
 
 	SAxisMove move(true);
-	mm1000_t radius;
+	mm1000_t radius = 0;
 	mm1000_t offset[2] = { 0, 0 };
 
 	for (char ch = _reader->SkipSpacesToUpper(); ch; ch = _reader->SkipSpacesToUpper())
@@ -783,6 +827,7 @@ void CGCodeParserBase::G171819Command(axis_t axis0, axis_t axis1, axis_t axis2)
 	_modalstate.Plane_axis_0 = axis0;
 	_modalstate.Plane_axis_1 = axis1;
 	_modalstate.Plane_axis_2 = axis2;
+	_modalstate.G5Valid = false;
 }
 
 ////////////////////////////////////////////////////////////
@@ -941,6 +986,7 @@ void CGCodeParserBase::SpindleSpeedCommand()
 
 void CGCodeParserBase::CallIOControl(uint8_t io, unsigned short value)
 {
+	FlushBlocks();
 	CStepper::GetInstance()->IoControl(io, value);
 }
 
@@ -142,7 +142,7 @@ protected:
 		CGCodeParserBase::LastCommandCB LastCommand;
 
 		bool			ProbeOnValue;
-		bool			Dummy;
+		bool			G5Valid;				// last move is G5 (see CGCodeParser::G0505Command), any other move (MoveStart) or plane clears it
 
 		void Init()	
 		{
@@ -264,6 +264,7 @@ protected:
 
 	unsigned long GetDweel();
 
+	void GetIJK(axis_t axis, SAxisMove& move, mm1000_t offset[2]);
 	void GetRadius(SAxisMove& move, mm1000_t& radius);
 
 	void CallIOControl(uint8_t io, unsigned short value);
@@ -271,6 +272,10 @@ protected:
 
 	void MoveStart(bool cutmove);
 
+	static void FlushBlocks()					{ CMotionControlBase::GetInstance()->FlushBlocks(); }	// parsed G0/G1 blocks to the stepper, see USE_BLOCKQUEUE
+	static bool IsBlockGCode(gcode_t gcode);
+	bool IsBlockLastCommand();
+
 	void G31Command(bool probevalue);
 	bool ProbeCommand(SAxisMove& move, bool probevalue);
 
@@ -280,8 +285,6 @@ protected:
 
 private:
 
-	void GetIJK(axis_t axis, SAxisMove& move, mm1000_t offset[2]);
-
 	void GetG92Axis(axis_t axis, uint8_t& count);
 
 	static bool G31TestProbe(uintptr_t);
@@ -323,7 +326,7 @@ private:
 
 	/////////////////
 
-#ifdef _MSC_VER
+#if defined(_MSC_VER) || defined(__linux__)
 public:
 	static bool _exit;
 #endif
@@ -95,6 +95,13 @@
 #define MESSAGE_GCODE_SExpected						StepperMessage("3D","S expected")
 #define MESSAGE_GCODE_IJKVECTORIS0					StepperMessage("3E","Vector IJK is 0")
 #define MESSAGE_GCODE_SPECIFIED						StepperMessage("3F","IJK is specified")
+#define MESSAGE_GCODE_MissingIJorPQ					StepperMessage("40","missing IJ or PQ")
+
+#define MESSAGE_BINARY_CRCError						StepperMessage("41","binary: crc error")
+#define MESSAGE_BINARY_SequenceError				StepperMessage("42","binary: sequence error")
+#define MESSAGE_BINARY_UnknownCommand				StepperMessage("43","binary: unknown command")
+#define MESSAGE_BINARY_InvalidLength				StepperMessage("44","binary: invalid length")
+#define MESSAGE_BINARY_InvalidAxis					StepperMessage("45","binary: invalid axis")
 
 ////////////////////////////////////////////////////////
 
@@ -61,6 +61,9 @@ protected:
 
 	virtual void TransformFromMachinePosition(const udist_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]) override;
 	virtual bool TransformPosition(const mm1000_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]) override;
+#ifdef USE_ARCMOVE
+	virtual bool IsArcMoveAllowed(axis_t axis_0, axis_t axis_1) override	{ return !IsRotate() && _rotateEnabled2D == 0 && super::IsArcMoveAllowed(axis_0, axis_1); }
+#endif
 
 private:
 
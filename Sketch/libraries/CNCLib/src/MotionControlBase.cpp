@@ -44,6 +44,13 @@ template<> CMotionControlBase* CSingleton<CMotionControlBase>::_instance = NULL;
 
 void CMotionControlBase::GetPositions(mm1000_t current[NUM_AXIS])
 {
+#ifdef USE_BLOCKQUEUE
+	if (!_blocks.IsEmpty())
+	{
+		memcpy(current, _blocks.Tail()._to, sizeof(_current));		// position after the last parsed block
+		return;
+	}
+#endif
 	memcpy(current, _current, sizeof(_current));
 }
 
@@ -51,6 +58,10 @@ void CMotionControlBase::GetPositions(mm1000_t current[NUM_AXIS])
 
 mm1000_t CMotionControlBase::GetPosition(axis_t axis)
 {
+#ifdef USE_BLOCKQUEUE
+	if (!_blocks.IsEmpty())
+		return _blocks.Tail()._to[axis];
+#endif
 	return _current[axis];
 }
 
@@ -90,6 +101,11 @@ void CMotionControlBase::MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrat
 	// the ONLY methode to move!!!!!
 	// do not call Stepper direct
 
+#ifdef USE_BLOCKQUEUE
+	if (!_moveBlock)
+		FlushBlocks();
+#endif
+
 #ifdef _MSC_VER
 	CStepper::GetInstance()->MSCInfo = CControl::GetInstance()->GetBuffer();
 #endif
@@ -103,6 +119,7 @@ void CMotionControlBase::MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrat
 	{
 		ToMachine(to_proj, to_m);
 
+		CStepper::GetInstance()->SetRapidMove(feedrate < 0);		// G0 => rapid override
 		CStepper::GetInstance()->MoveAbs(to_m, GetFeedRate(to_proj, feedrate));
 
 		if (CStepper::GetInstance()->IsError())
@@ -116,6 +133,139 @@ void CMotionControlBase::MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrat
 	}
 }
 
+/////////////////////////////////////////////////////////
+
+#ifdef USE_BLOCKQUEUE
+
+void CMotionControlBase::QueueBlock(const mm1000_t to[NUM_AXIS], feedrate_t feedrate)
+{
+	// G0/G1: the parser can continue while the movement queue is full
+	// range is checked here => the error is reported for the line of the block
+
+	if (_blocks.IsEmpty() && CStepper::GetInstance()->CanQueueMovement())
+	{
+		MoveAbs(to, feedrate);
+		return;
+	}
+
+	mm1000_t	to_proj[NUM_AXIS];
+	udist_t		to_m[NUM_AXIS];
+
+	memcpy(to_proj, to, sizeof(_current));
+
+	if (!TransformPosition(to, to_proj))
+		return;
+
+	ToMachine(to_proj, to_m);
+
+	if (!CStepper::GetInstance()->IsInLimit(to_m))
+	{
+		Error(MESSAGE(MESSAGE_STEPPER_RangeLimit));
+		return;
+	}
+
+	if (_blocks.IsFull())
+		MoveBlock();							// wait for the movement queue
+
+	SBlock& block = _blocks.NextTail();
+	memcpy(block._to, to, sizeof(block._to));
+	block._feedrate = feedrate;
+	_blocks.Enqueue();
+}
+
+/////////////////////////////////////////////////////////
+
+void CMotionControlBase::MoveBlock()
+{
+	if (CStepper::GetInstance()->IsEmergencyStop())
+	{
+		_blocks.Clear();
+		return;
+	}
+
+	_moveBlock = true;
+	MoveAbs(_blocks.Head()._to, _blocks.Head()._feedrate);
+	_moveBlock = false;
+
+	if (CStepper::GetInstance()->IsError())
+		_blocks.Clear();						// position is set from machine (see MoveAbs), following blocks are invalid
+	else
+		_blocks.Dequeue();
+}
+
+/////////////////////////////////////////////////////////
+
+void CMotionControlBase::PollBlocks()
+{
+	if (_moveBlock)
+		return;									// called while MoveBlock waits (e.g. a split movement), head block is not dequeued yet
+
+	while (!_blocks.IsEmpty() && CStepper::GetInstance()->CanQueueMovement())
+	{
+		MoveBlock();
+	}
+}
+
+/////////////////////////////////////////////////////////
+
+void CMotionControlBase::FlushBlocks()
+{
+	while (!_blocks.IsEmpty())
+	{
+		MoveBlock();
+	}
+}
+
+#endif
+
+/////////////////////////////////////////////////////////
+
+#ifdef USE_ARCMOVE
+
+bool CMotionControlBase::IsArcMoveAllowed(axis_t axis_0, axis_t axis_1)
+{
+	// circle in logical coordinates must be a circle in machine steps
+
+	return _ToMachine(axis_0, 1000000) == _ToMachine(axis_1, 1000000);
+}
+
+/////////////////////////////////////////////////////////
+
+bool CMotionControlBase::ArcMove(const mm1000_t to[NUM_AXIS], mm1000_t center_axis0, mm1000_t center_axis1, axis_t  axis_0, axis_t axis_1, bool isclockwise, feedrate_t feedrate)
+{
+	// queue arc as one movement, false => not possible, nothing queued
+
+	if (!IsArcMoveAllowed(axis_0, axis_1))
+		return false;
+
+	mm1000_t	to_proj[NUM_AXIS];
+	udist_t		to_m[NUM_AXIS];
+
+	memcpy(to_proj, to, sizeof(_current));
+
+	if (!TransformPosition(to, to_proj))
+		return false;
+
+	ToMachine(to_proj, to_m);
+
+	CStepper::GetInstance()->SetRapidMove(false);
+	if (!CStepper::GetInstance()->ArcAbs(to_m, axis_0, axis_1, ToMachine(axis_0, center_axis0), ToMachine(axis_1, center_axis1), isclockwise, FeedRateToStepRate(axis_0, feedrate)))
+		return false;
+
+	if (CStepper::GetInstance()->IsError())
+	{
+		SetPositionFromMachine();
+	}
+	else
+	{
+		memcpy(_current, to, sizeof(_current));
+	}
+
+	return true;
+}
+
+#endif
+
 /////////////////////////////////////////////////////////
 // based on:
 //	motion_control.c - high level interface for issuing motion commands
@@ -123,32 +273,36 @@ void CMotionControlBase::MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrat
 
 // Arc with axis_0 and axis_1
 // all other linear
-// calculate Segments with f = k * x + d (x... radius, f ... segments)
+// segments from max chord error (ARC_CHORDTOLERANCE): e = r*(1-cos(theta/2)) => theta = 2*acos(1-e/r)
+// rotation of the radius vector in fixed point (mm1000_t * 2^30), exact position (float) every ARCCORRECTION segments
 
-#define SEGMENTS_K	4.0
+#define ARC_MAXSEGMENTANGLE	( 20.0 * M_PI / 180.0)		// max 20grad for small r
 
-#define SEGMENTS_D	18.0		// 20 Grad 
-//#define SEGMENTS_D	20.0		// 18 Grad
-//#define SEGMENTS_D	22.0		// 16.3
-//#define SEGMENTS_D	24.0		// 15
-//#define SEGMENTS_D	36.0		// 10
+#define ARCCORRECTION	16							// segments
 
-// Use: Small angle approximation from http://en.wikipedia.org/wiki/Small-angle_approximation
-/*
-Figure 3 shows the relative errors of the small angle approximations.The angles at which the relative error exceeds 1 % are as follows :
-tan O near O at about 0.176 radians(10Grad).
-sin O near O at about 0.244 radians(14Grad).
-cos O near 1 - O2 / 2 at about 0.664 radians(38Grad).
+#define ARC_FIXPOINT_ONE	(1ul << 30)
 
-=> To be save => not more than 10Grad for Arc_Correction
-*/
+static mm1000_t MulFix30(mm1000_t v, unsigned long q)
+{
+	// v * q / 2^30 without 64bit (q <= 2^30): split v and q in 15 bit parts
 
-#define ARCCORRECTION	( 10.0 * M_PI / 180.0)		// every 10grad
+	unsigned long a = v < 0 ? -v : v;
+	unsigned long ah = a >> 15;
+	unsigned long al = a & 0x7fff;
+	unsigned long qh = q >> 15;
+	unsigned long ql = q & 0x7fff;
+
+	unsigned long r = ah*qh + ((ah*ql + al*qh + ((al*ql) >> 15) + 0x4000) >> 15);
+
+	return v < 0 ? -(mm1000_t)r : (mm1000_t)r;
+}
 
 void CMotionControlBase::Arc(const mm1000_t to[NUM_AXIS], mm1000_t offset0, mm1000_t offset1, axis_t  axis_0, axis_t axis_1, bool isclockwise, feedrate_t feedrate)
 {
 	// start from current position!
 
+	FlushBlocks();
+
 	mm1000_t current[NUM_AXIS];
 	GetPositions(current);
 
@@ -170,13 +324,13 @@ void CMotionControlBase::Arc(const mm1000_t to[NUM_AXIS], mm1000_t offset0, mm10
 
 	float radius = hypot((float)offset0, (float)offset1);
 
-	float r_axis0 = (float) -offset0;  // Radius vector from center to current location
-	float r_axis1 = (float) -offset1;
+	mm1000_t r_axis0 = -offset0;  // Radius vector from center to current location
+	mm1000_t r_axis1 = -offset1;
 	mm1000_t rt_axis0 = to[axis_0] - center_axis0;
 	mm1000_t rt_axis1 = to[axis_1] - center_axis1;
 
 	// CCW angle between position and target from circle center. Only one atan2() trig computation required.
-	float angular_travel = atan2(r_axis0*rt_axis1 - r_axis1*rt_axis0, r_axis0*rt_axis0 + r_axis1*rt_axis1);
+	float angular_travel = atan2((float)r_axis0*rt_axis1 - (float)r_axis1*rt_axis0, (float)r_axis0*rt_axis0 + (float)r_axis1*rt_axis1);
 	if (angular_travel == 0.0 || angular_travel == -0.0)
 	{
 		// 360Grad
@@ -201,60 +355,87 @@ void CMotionControlBase::Arc(const mm1000_t to[NUM_AXIS], mm1000_t offset0, mm10
 		return;
 	}
 
-	// difference to Grbl => use dynamic calculation of segements => suitable for small r
-	//
-	// segments for full circle => (CONST_K * r * M_PI * b + CONST_D)		(r in mm, b ...2?)
+#ifdef USE_ARCMOVE
+	if (ArcMove(to, center_axis0, center_axis1, axis_0, axis_1, isclockwise, feedrate))
+	{
+		return;
+	}
+#endif
 
-	unsigned short segments = (unsigned short) abs(floor((CMm1000::ConvertTo((const mm1000_t) (2 * SEGMENTS_K*M_PI))*radius + SEGMENTS_D) * angular_travel / (2.0*M_PI)));
+	float theta_max = float(ARC_MAXSEGMENTANGLE);
+	if (radius > ARC_CHORDTOLERANCE)
+	{
+		float theta = float(2.0 * acos(1.0 - ARC_CHORDTOLERANCE / radius));
+		if (theta < theta_max)
+			theta_max = theta;
+	}
+
+	unsigned short segments = (unsigned short) ceil(fabs(angular_travel) / theta_max);
 
 #if defined(_MSC_VER)
-	double segments_full = CMm1000::ConvertTo((const mm1000_t)(2 * SEGMENTS_K*M_PI))*radius + SEGMENTS_D;
-	segments_full;
-	Trace("Gx command with\tr=%f\tfull_segments=%f\tangular=%f\tangularG=%f\tsegments=%i\n", radius, segments_full, angular_travel, angular_travel/M_PI*180, segments);
+	Trace("Gx command with\tr=%f\ttheta_max=%f\tangular=%f\tangularG=%f\tsegments=%i\n", radius, theta_max, angular_travel, angular_travel/M_PI*180, segments);
+#endif
+
+#ifndef REDUCED_SIZE
+	CStepper::GetInstance()->SetArcRadius(ToMachine(axis_0, (mm1000_t)radius));		// junction speed of segments
 #endif
 
 	if (segments > 1)
 	{
 		float theta_per_segment = angular_travel / segments;
+		bool ccw = theta_per_segment > 0;
+
+		// Vector rotation matrix values (fixed point)
+		unsigned long cos_T = (unsigned long) (cos(theta_per_segment) * ARC_FIXPOINT_ONE);
+		unsigned long sin_T = (unsigned long) (fabs(sin(theta_per_segment)) * ARC_FIXPOINT_ONE);
 
-		signed char arc_correction = (signed char)(ARCCORRECTION / theta_per_segment);
-		if (arc_correction < 0) arc_correction = -arc_correction;
+		// radius vector with fraction (shift) to avoid accumulating rounding errors
 
-		// Vector rotation matrix values
-		float cos_T = float(1.0 - 0.5*theta_per_segment*theta_per_segment);
-		float sin_T = theta_per_segment;
+		uint8_t shift = 0;
+		while ((((unsigned long)radius) >> (29 - shift)) == 0 && shift < 16)
+			shift++;
 
-		float sin_Ti;
-		float cos_Ti;
-		float r_axisi;
+		mm1000_t r_axis0f = r_axis0 << shift;
+		mm1000_t r_axis1f = r_axis1 << shift;
+		mm1000_t r_axisi;
 		unsigned short i;
 		uint8_t count = 0;
 
 		for (i = 1; i < segments; i++)
 		{
-			if (count < arc_correction)
+			if (count < ARCCORRECTION)
 			{
 				// Apply vector rotation matrix 
-				r_axisi = r_axis0*sin_T + r_axis1*cos_T;
-				r_axis0 = r_axis0*cos_T - r_axis1*sin_T;
-				r_axis1 = r_axisi;
+				mm1000_t sin_0 = MulFix30(r_axis0f, sin_T);
+				mm1000_t sin_1 = MulFix30(r_axis1f, sin_T);
+				if (!ccw)
+				{
+					sin_0 = -sin_0;
+					sin_1 = -sin_1;
+				}
+				r_axisi = sin_0 + MulFix30(r_axis1f, cos_T);
+				r_axis0f = MulFix30(r_axis0f, cos_T) - sin_1;
+				r_axis1f = r_axisi;
 				count++;
 			}
 			else
 			{
-				// Arc correction to radius vector. Computed only every N_ARC_CORRECTION increments.
+				// Arc correction to radius vector. Computed only every ARCCORRECTION increments.
 				// Compute exact location by applying transformation matrix from initial radius vector(=-offset).
-				cos_Ti = cos(i*theta_per_segment);
-				sin_Ti = sin(i*theta_per_segment);
-				r_axis0 = -offset0 * cos_Ti + offset1 * sin_Ti;
-				r_axis1 = -offset0 * sin_Ti - offset1 * cos_Ti;
+				float cos_Ti = cos(i*theta_per_segment);
+				float sin_Ti = sin(i*theta_per_segment);
+				r_axis0f = (mm1000_t)lround((-offset0 * cos_Ti + offset1 * sin_Ti) * (1l << shift));
+				r_axis1f = (mm1000_t)lround((-offset0 * sin_Ti - offset1 * cos_Ti) * (1l << shift));
 				count = 0;
 			}
 
+			r_axis0 = (r_axis0f + ((1l << shift) >> 1)) >> shift;
+			r_axis1 = (r_axis1f + ((1l << shift) >> 1)) >> shift;
+
 			// Update arc_target location
 
-			current[axis_0] = (mm1000_t)(center_axis0 + r_axis0);
-			current[axis_1] = (mm1000_t)(center_axis1 + r_axis1);
+			current[axis_0] = center_axis0 + r_axis0;
+			current[axis_1] = center_axis1 + r_axis1;
 
 			for (axis_t x = 0; x < NUM_AXIS; x++)
 			{
@@ -268,6 +449,76 @@ void CMotionControlBase::Arc(const mm1000_t to[NUM_AXIS], mm1000_t offset0, mm10
 		}
 	}
 
+	// Ensure last segment arrives at target location.
+	MoveAbs(to, feedrate);
+
+#ifndef REDUCED_SIZE
+	CStepper::GetInstance()->SetArcRadius(0);
+#endif
+}
+
+/////////////////////////////////////////////////////////
+// cubic Bezier with axis_0 and axis_1
+// all other linear (with t)
+// flatten: distance of the segment (t..t+dt) to the curve <= max|B''|*dt^2/8
+// B'' is linear in t => max is at the start or end of the segment
+// segments are calculated one by one when queued (MoveAbs waits for a free queue entry)
+
+void CMotionControlBase::Bezier(const mm1000_t to[NUM_AXIS], const mm1000_t control1[2], const mm1000_t control2[2], axis_t  axis_0, axis_t axis_1, feedrate_t feedrate)
+{
+	// start from current position!
+
+	FlushBlocks();
+
+	mm1000_t from[NUM_AXIS];
+	mm1000_t current[NUM_AXIS];
+	GetPositions(from);
+
+	// B''(t) = (1-t)*acc0 + t*acc1
+
+	float acc0_0 = 6.0f * ((float)from[axis_0] - 2.0f * control1[0] + control2[0]);
+	float acc0_1 = 6.0f * ((float)from[axis_1] - 2.0f * control1[1] + control2[1]);
+	float acc1_0 = 6.0f * ((float)control1[0] - 2.0f * control2[0] + to[axis_0]);
+	float acc1_1 = 6.0f * ((float)control1[1] - 2.0f * control2[1] + to[axis_1]);
+
+	float acc_t = hypot(acc0_0, acc0_1);
+	float t = 0.0;
+
+	while (true)
+	{
+		float dt = acc_t > 0.0 ? sqrt(8.0f * BEZIER_TOLERANCE / acc_t) : 1.0f;
+		if (t + dt < 1.0)
+		{
+			float acc_tdt = hypot(acc0_0 + (acc1_0 - acc0_0) * (t + dt), acc0_1 + (acc1_1 - acc0_1) * (t + dt));
+			if (acc_tdt > acc_t)
+				dt = sqrt(8.0f * BEZIER_TOLERANCE / acc_tdt);
+		}
+
+		t += dt;
+		if (t >= 1.0)
+			break;
+
+		acc_t = hypot(acc0_0 + (acc1_0 - acc0_0) * t, acc0_1 + (acc1_1 - acc0_1) * t);
+
+		float mt = 1.0f - t;
+		float b0 = mt * mt * mt;
+		float b1 = 3.0f * mt * mt * t;
+		float b2 = 3.0f * mt * t * t;
+		float b3 = t * t * t;
+
+		for (axis_t x = 0; x < NUM_AXIS; x++)
+		{
+			if (x == axis_0)
+				current[x] = (mm1000_t)lround(b0 * from[x] + b1 * control1[0] + b2 * control2[0] + b3 * to[x]);
+			else if (x == axis_1)
+				current[x] = (mm1000_t)lround(b0 * from[x] + b1 * control1[1] + b2 * control2[1] + b3 * to[x]);
+			else
+				current[x] = from[x] + (mm1000_t)lround((to[x] - from[x]) * t);
+		}
+
+		MoveAbs(current, feedrate);
+	}
+
 	// Ensure last segment arrives at target location.
 	MoveAbs(to, feedrate);
 }
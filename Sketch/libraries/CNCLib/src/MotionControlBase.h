@@ -81,8 +81,28 @@ protected:
 	virtual void TransformFromMachinePosition(const udist_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]);
 	virtual bool TransformPosition(const mm1000_t src[NUM_AXIS], mm1000_t dest[NUM_AXIS]);
 
+#ifdef USE_ARCMOVE
+	virtual bool IsArcMoveAllowed(axis_t axis_0, axis_t axis_1);			// arc can be done by the stepper (no transformation)
+	bool ArcMove(const mm1000_t to[NUM_AXIS], mm1000_t center_axis0, mm1000_t center_axis1, axis_t  axis_0, axis_t axis_1, bool isclockwise, feedrate_t feedrate);
+#endif
+
 	mm1000_t	_current[NUM_AXIS];
 
+#ifdef USE_BLOCKQUEUE
+
+	struct SBlock
+	{
+		mm1000_t	_to[NUM_AXIS];			// logical-pos, parsed and converted (inch, G92, ...)
+		feedrate_t	_feedrate;				// <0 => G0
+	};
+
+	CRingBufferQueue<SBlock, BLOCKBUFFERSIZE> _blocks;
+	bool		_moveBlock = false;			// MoveAbs called with the head of _blocks
+
+	void MoveBlock();
+
+#endif
+
 	void Error(error_t error)			{ _error = error; }
 	void Error()						{ Error(MESSAGE_UNKNOWNERROR); }
 
@@ -114,8 +134,21 @@ public:
 	// all positions are logical-pos
 
 	void Arc(const mm1000_t to[NUM_AXIS], mm1000_t offset0, mm1000_t offset1, axis_t  axis_0, axis_t axis_1, bool isclockwise, feedrate_t feedrate);
+	void Bezier(const mm1000_t to[NUM_AXIS], const mm1000_t control1[2], const mm1000_t control2[2], axis_t  axis_0, axis_t axis_1, feedrate_t feedrate);	// cubic, control points of axis_0/axis_1
 	virtual void MoveAbs(const mm1000_t to[NUM_AXIS], feedrate_t feedrate);
 
+#ifdef USE_BLOCKQUEUE
+	void QueueBlock(const mm1000_t to[NUM_AXIS], feedrate_t feedrate);	// same as MoveAbs, but do not wait if the movement queue is full
+	void PollBlocks();													// pass queued blocks to the stepper while the movement queue is not full, call in idle
+	void FlushBlocks();													// pass all queued blocks to the stepper (wait), call before any other access to the stepper
+	void ClearBlocks()										{ _blocks.Clear(); }
+	uint8_t GetFreeBlocks() const							{ return _blocks.FreeCount(); }
+	bool IsBlockQueueEmpty() const							{ return _blocks.IsEmpty(); }
+#else
+	void QueueBlock(const mm1000_t to[NUM_AXIS], feedrate_t feedrate)		{ MoveAbs(to, feedrate); }
+	void FlushBlocks()										{ }
+#endif
+
 	void GetPositions(mm1000_t current[NUM_AXIS]);
 	mm1000_t GetPosition(axis_t axis);
 
@@ -103,6 +103,9 @@ bool CGCode3DParser::MCommand(mcode_t mcode)
 		case 29: M29Command(); return true;
 		case 30: M30Command(); return true;
 		case 115: _OkMessage = PrintVersion; return true;
+#ifdef USE_ADVANCE
+		case 900: M900Command(); return true;
+#endif
 	}
 
 	return false;
@@ -384,6 +387,41 @@ void CGCode3DParser::M30Command()
 
 ////////////////////////////////////////////////////////////
 
+#ifdef USE_ADVANCE
+
+void CGCode3DParser::M900Command()
+{
+	// pressure advance of extruder: M900 [K lead in sec]
+	// the extruder leads by K*speed of extruder (see CStepper::SetAdvance), no K => print current value
+
+	if (_reader->SkipSpacesToUpper() == 'K')
+	{
+		_reader->GetNextChar();
+		expr_t k = GetDouble();
+		if (IsError()) return;
+
+		if (k < 0)
+		{
+			Error(MESSAGE_PARSER3D_ADVANCE_K_RANGE);
+			return;
+		}
+		if (!ExpectEndOfCommand()) { return; }
+
+		CStepper::GetInstance()->SetAdvance(CharToAxis('E'), k);
+	}
+	else
+	{
+		if (!ExpectEndOfCommand()) { return; }
+
+		StepperSerial.print(MESSAGE_PARSER3D_ADVANCE_K);
+		StepperSerial.println(CStepper::GetInstance()->GetAdvance());
+	}
+}
+
+#endif
+
+////////////////////////////////////////////////////////////
+
 bool CGCode3DParser::CheckSD()
 {
 	if (GetExecutingFile())
@@ -102,6 +102,9 @@ private:
 	void M28Command();		// Start write to SD file
 	void M29Command();		// Stop write to SD file
 	void M30Command();		// Delete file on SD
+#ifdef USE_ADVANCE
+	void M900Command();		// Pressure advance of extruder
+#endif
 
 	bool GetPathName(char*buffer);
 	bool GetFileName(char*&buffer, uint8_t& pathlength);
@@ -44,6 +44,8 @@
 #define MESSAGE_PARSER3D_CANNOT_DELETE_FILE F("cannot delete file")
 #define MESSAGE_PARSER3D_FILE_NOT_EXIST F("file not exists")
 #define MESSAGE_PARSER3D_ILLEGAL_FILENAME F("Illegal Filename")
+#define MESSAGE_PARSER3D_ADVANCE_K F("Advance K=")
+#define MESSAGE_PARSER3D_ADVANCE_K_RANGE F("K must be >= 0")
 
 ////////////////////////////////////////////////////////
 
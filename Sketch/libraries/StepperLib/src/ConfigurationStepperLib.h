@@ -59,6 +59,21 @@ typedef const __FlashStringHelper * error_t;
 #define IDLETIMER1VALUE		TIMER1VALUE(31)			// Idle timer value (stepper timer not moving), must fit into 16 bit
 #define TIMEOUTSETIDLE		1000					// set level after 1000ms
 
+//#define USE_RAMPTABLE								// calc acc/dec timer with a precomputed ramp table (multiply/shift) instead of a division per step
+//#define USE_SCURVE								// jerk limited S-curve ramp, see CStepper::SetMaxJerk (needs USE_RAMPTABLE)
+//#define USE_SPSC_STEPBUFFER						// lock free step buffer (CRingBufferQueueSPSC), no CCriticalRegion in Enqueue/Dequeue
+//#define USE_ARCMOVE								// circular move (G2/G3) as one movement, see CStepper::ArcAbs
+//#define USE_INPUTSHAPING							// acc/dec ramp shaped (ZV/ZVD/MZV) to suppress resonance, see CStepper::SetInputShaper (needs USE_SCURVE)
+//#define USE_ACCCURVE								// acc/dec of axis depend on the speed (torque curve), see CStepper::SetAccCurve
+//#define USE_ADVANCE								// pressure (linear) advance of the extruder axis, see CStepper::SetAdvance
+//#define USE_BACKLASHBLEND							// backlash steps interleaved with the first steps of the movement (no stop), else a backlash movement is queued
+//#define USE_PLANNER2PASS							// plan all movements of the queue (backward and forward pass), see CStepper::SetPlanner2Pass
+//#define USE_BLOCKQUEUE							// queue of parsed G0/G1 blocks ahead of the movement queue, see CMotionControlBase::QueueBlock
+//#define USE_STREAMING							// "ok" with credits (free movements and serial receive buffer) to keep several lines in flight, see m129
+//#define USE_BINARYPROTOCOL						// framed binary G0/G1 commands as alternative to text lines, see BinaryProtocol.h
+//#define USE_REALTIMECOMMAND						// single char real-time commands (hold, resume, status, override) removed from the serial input, see CControl::RealtimeCommand
+//#define USE_STATUSSNAPSHOT						// position/speed of the ISR without critical region (seqlock), see CStepper::GetStatusSnapshot
+
 #define WAITTIMER1VALUE		TIMER1VALUE(100)		// Idle timer value for "no step" movement
 
 #define TIMER1VALUEMAXSPEED	TIMER1VALUE(STEPRATE_MAX)
@@ -66,6 +81,10 @@ typedef const __FlashStringHelper * error_t;
 ////////////////////////////////////////////////////////
 
 #define SYNC_STEPBUFFERCOUNT		8		// allow only x element in step buffer when io or wait starts
+#define STEPBUFFERMAXREPEAT			7		// max repeat (run length) of an identical step in one step buffer element, 0 => no repeat
+
+#define STEPSMOOTHING_MAXLEVEL		0		// adaptive multi axis step smoothing: up to 2^x ISR calls per step of the leading axis, 0 => off
+#define STEPSMOOTHING_MAXRATE		(MAXINTERRUPTSPEED/2)	// max ISR rate with smoothing
 
 ////////////////////////////////////////////////////////
 
@@ -140,6 +159,43 @@ typedef unsigned long long uint64_t;
 
 ////////////////////////////////////////////////////////
 
+#elif defined (__linux__)
+
+// host simulation with virtual time (see HAL_Linux.h), same buffer size as Mega/SAM
+
+#undef use16bit
+#define use32bit
+
+#define NUM_AXIS			5
+
+#define STEPBUFFERSIZE		128		// size 2^x but not 256
+#define MOVEMENTBUFFERSIZE	64
+
+#undef REFERENCESTABLETIME
+#define REFERENCESTABLETIME	0
+
+#define STEPPERPROFILE				// call ProfileBegin/ProfileEnd in ISR (see Linux/StepperBenchmark)
+
+#define USE_RAMPTABLE				// division free acc/dec ramp
+#define USE_SCURVE					// S-curve ramp if jerk is set
+#define USE_SPSC_STEPBUFFER			// lock free step buffer
+#define USE_ARCMOVE					// native arc move
+#define USE_INPUTSHAPING			// input shaping if set for axis
+#define USE_ACCCURVE				// speed dependent acc/dec if set for axis
+#define USE_ADVANCE					// extruder advance if set
+#define USE_BACKLASHBLEND			// backlash without stop
+#define USE_PLANNER2PASS			// time optimal planner
+#define USE_BLOCKQUEUE				// parser runs ahead of the movement queue
+#define USE_STREAMING				// "ok" with credits (m129)
+#define USE_BINARYPROTOCOL			// binary frames (relative moves)
+#define USE_REALTIMECOMMAND			// hold/resume/status while the parser waits
+#define USE_STATUSSNAPSHOT			// lock free status
+
+#undef STEPSMOOTHING_MAXLEVEL
+#define STEPSMOOTHING_MAXLEVEL	3
+
+////////////////////////////////////////////////////////
+
 #else
 ToDo;
 #endif
@@ -162,6 +218,10 @@ typedef unsigned short steprate_t;		// tpye for speed (Hz), Steps/sec
 #define mudiv	udiv
 #define mudiv_t	udiv_t
 
+typedef unsigned short rampfactor_t;	// base ramp table entry (see USE_RAMPTABLE)
+typedef unsigned long rampscale_t;		// timer scaled with rampfactor
+#define RAMPFACTORBITS		16
+
 ////////////////////////////////////////////////////////
 
 #elif defined(use32bit)
@@ -178,6 +238,18 @@ typedef unsigned long steprate_t;		// tpye for speed (Hz), Steps/sec
 #define mudiv	ldiv
 #define mudiv_t	ldiv_t
 
+typedef unsigned long rampfactor_t;		// base ramp table entry (see USE_RAMPTABLE)
+typedef uint64_t rampscale_t;			// timer scaled with rampfactor
+#define RAMPFACTORBITS		31
+
+#endif
+
+#if defined(USE_SCURVE) && !defined(USE_RAMPTABLE)
+#error "USE_SCURVE needs USE_RAMPTABLE"
+#endif
+
+#if defined(USE_INPUTSHAPING) && !defined(USE_SCURVE)
+#error "USE_INPUTSHAPING needs USE_SCURVE"
 #endif
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -189,6 +261,14 @@ typedef unsigned long steprate_t;		// tpye for speed (Hz), Steps/sec
 #define stepperstatic 
 #define stepperstatic_avr 
 
+#elif defined(__linux__)
+
+#define stepperstatic_avr 
+#define stepperstatic static
+#define stepperstatic_
+#define EnumAsByte(a) uint8_t
+#define debugvirtula virtual				// the host simulation must overwrite OnWait (advance the virtual time)
+
 #else
 
 #if defined(__AVR_ARCH__)
@@ -238,6 +238,29 @@ private:
 	static char* _eepromFileName;
 	static uint32_t _eepromBuffer[2048];
 
+#elif defined(__linux__)
+
+	static void SetEepromFilename(const char* filename) { _eepromFileName = filename; }
+
+	// virtual time (ns), see Arduino.h
+
+	static void RunVirtualTimer(uint64_t until);				// call all timer events until virtual time "until"
+	static bool RunNextTimer1();								// advance virtual time to the next timer1 event and call it, false if timer1 is stopped
+
+	static uint64_t GetTimer1Due()								{ return _timer1Due; }
+	static inline uint64_t TimerToVirtualTime(timer_t timer, long frequence) ALWAYSINLINE;
+
+private:
+
+	static const char* _eepromFileName;
+	static uint32_t _eepromBuffer[2048];
+
+	static uint64_t _timer0Due;
+	static uint64_t _timer0Period;
+	static uint64_t _timer1Due;
+
+	static void CallTimerEvent(HALEvent evt);
+
 #else
 
 #endif
@@ -256,11 +279,22 @@ public:
 	inline ~CCriticalRegion() ALWAYSINLINE { CHAL::SetSREG(_sreg); }
 };
 
+//////////////////////////////////////////
+// no reordering of memory access by the compiler (e.g. seqlock), single core => no memory fence
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define HALCompilerBarrier()	_ReadWriteBarrier()
+#else
+#define HALCompilerBarrier()	__asm__ __volatile__("" ::: "memory")
+#endif
+
 //////////////////////////////////////////
 
 #include "HAL_AVR.h"
 #include "HAL_Sam3x8e.h"
 #include "HAL_SamD21g18a.h"
 #include "HAL_Msvc.h"
+#include "HAL_Linux.h"
 
 //////////////////////////////////////////
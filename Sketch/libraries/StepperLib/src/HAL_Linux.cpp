@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////
+/*
+  This file is part of CNCLib - A library for stepper motors.
+
+  Copyright (c) 2013-2018 Herbert Aitenbichler
+
+  CNCLib is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  CNCLib is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  http://www.gnu.org/licenses/
+*/
+////////////////////////////////////////////////////////
+
+#if defined(__linux__)
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Arduino.h>
+#include <ctype.h>
+
+#include "HAL.h"
+#include "UtilitiesStepperLib.h"
+
+////////////////////////////////////////////////////////
+
+uint32_t CHAL::_eepromBuffer[2048] = { 0 };
+const char* CHAL::_eepromFileName = NULL;
+
+uint64_t CHAL::_timer0Due = VIRTUALTIMER_STOPPED;
+uint64_t CHAL::_timer0Period = 0;
+uint64_t CHAL::_timer1Due = VIRTUALTIMER_STOPPED;
+
+////////////////////////////////////////////////////////
+
+bool CHAL::HaveEeprom()
+{
+	return true;
+}
+
+////////////////////////////////////////////////////////
+
+void CHAL::InitEeprom()
+{
+	if (_eepromFileName)
+	{
+		FILE* f = fopen(_eepromFileName, "rb");
+
+		if (f)
+		{
+			if (fread(_eepromBuffer, 1, sizeof(_eepromBuffer), f) == 0)
+			{
+				// empty file => keep buffer
+			}
+			fclose(f);
+		}
+	}
+}
+
+void CHAL::FlushEeprom()
+{
+	if (_eepromFileName)
+	{
+		FILE* f = fopen(_eepromFileName, "wb");
+		if (f)
+		{
+			fwrite(_eepromBuffer, sizeof(_eepromBuffer), 1, f);
+			fclose(f);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+// simulate the ISR: interrupts are disabled while executing the event (like AVR)
+
+void CHAL::CallTimerEvent(HALEvent evt)
+{
+	irqflags_t sreg = GetSREG();
+	DisableInterrupts();
+	evt();
+	SetSREG(sreg);
+}
+
+////////////////////////////////////////////////////////
+
+void CHAL::RunVirtualTimer(uint64_t until)
+{
+	while (true)
+	{
+		uint64_t due = min(_timer0Due, _timer1Due);
+		if (due > until)
+			break;
+
+		if (due > GetVirtualTime())
+			SetVirtualTime(due);
+
+		if (_timer1Due == due)
+		{
+			// one shot => event must restart timer
+			_timer1Due = VIRTUALTIMER_STOPPED;
+			CallTimerEvent(_TimerEvent1);
+		}
+		else
+		{
+			_timer0Due += _timer0Period;
+			CallTimerEvent(_TimerEvent0);
+		}
+	}
+
+	if (until > GetVirtualTime())
+		SetVirtualTime(until);
+}
+
+////////////////////////////////////////////////////////
+
+bool CHAL::RunNextTimer1()
+{
+	if (_timer1Due == VIRTUALTIMER_STOPPED)
+		return false;
+
+	RunVirtualTimer(_timer1Due);
+	return true;
+}
+
+////////////////////////////////////////////////////////
+
+#endif		// __linux__
@@ -21,7 +21,7 @@
 
 //////////////////////////////////////////
 
-template<class TInput, class TOutput>
+template<class TInput, class TOutput, bool ProgMem = true>		// ProgMem = false: table in RAM (e.g. copied from eeprom)
 class CLinearLookup
 {
 public:
@@ -36,6 +36,8 @@ public:
 	TInput GetInput(index_t i) const
 	{
 #if defined(__AVR_ARCH__)
+		if (!ProgMem)
+			return _pTable[i].input;
 
     if (TInput(1)/2!=0)
       return (TInput) pgm_read_float(&_pTable[i].input);
@@ -52,6 +54,9 @@ public:
 	TOutput GetOutput(index_t i) const
 	{
 #if defined(__AVR_ARCH__)
+		if (!ProgMem)
+			return _pTable[i].output;
+
     if (TOutput(1)/2!=0)
   		return (TOutput) pgm_read_float(&_pTable[i].output);
 		if (sizeof(TOutput) == 4)
@@ -210,3 +210,154 @@ public:
 		return (idx >= count) ? idx - count : (maxsize)-(count - idx);
 	}
 };
+
+//////////////////////////////////////////
+// lock free single producer (Enqueue) / single consumer (Dequeue) queue, e.g. main/ISR
+// no CCriticalRegion: the producer only writes _tail, the consumer only writes _head
+// same H2T/T2H iteration as CRingBufferQueue but no InsertTail/RemoveTail (modify both ends)
+
+#if defined(__GNUC__)
+#define RINGBUFFER_LOAD(a)		__atomic_load_n(&(a), __ATOMIC_ACQUIRE)
+#define RINGBUFFER_STORE(a,v)	__atomic_store_n(&(a), (v), __ATOMIC_RELEASE)
+#else
+#define RINGBUFFER_LOAD(a)		(a)				// msvc: volatile has acquire/release semantic
+#define RINGBUFFER_STORE(a,v)	((a) = (v))
+#endif
+
+template <class T, const uint8_t maxsize>		// maxsize must be 2^n and <= 128
+class CRingBufferQueueSPSC
+{
+public:
+
+	CRingBufferQueueSPSC()
+	{
+		static_assert((maxsize & (maxsize - 1)) == 0 && maxsize <= 128, "maxsize must be 2^n and <= 128");
+		Clear();
+	}
+
+	// consumer
+
+	void Dequeue()
+	{
+		RINGBUFFER_STORE(_head, (uint8_t)(_head + 1));
+	}
+
+	// producer
+
+	void Enqueue()
+	{
+		RINGBUFFER_STORE(_tail, (uint8_t)(_tail + 1));
+	}
+
+	void Enqueue(T value)
+	{
+		Buffer[GetNextTailPos()] = value;
+		Enqueue();
+	}
+
+	void EnqueueCount(uint8_t cnt)
+	{
+		RINGBUFFER_STORE(_tail, (uint8_t)(_tail + cnt));
+	}
+
+	// producer and consumer
+
+	bool IsEmpty() const
+	{
+		return Count() == 0;
+	}
+
+	bool IsFull() const
+	{
+		return Count() == maxsize;
+	}
+
+	uint8_t Count() const
+	{
+		return (uint8_t)(RINGBUFFER_LOAD(_tail) - RINGBUFFER_LOAD(_head));		// _head/_tail are not limited to maxsize (overrun at 256)
+	}
+
+	uint8_t FreeCount() const
+	{
+		return maxsize - Count();
+	}
+
+	// next functions no check if empty or full
+
+	T& Head()                       { return Buffer[GetHeadPos()]; }
+	T& Tail()                       { return Buffer[GetTailPos()]; }
+	T& NextTail()                   { return Buffer[GetNextTailPos()]; }
+	T& NextTail(uint8_t ofs)		{ return Buffer[NextIndex(GetNextTailPos(), ofs)]; }
+
+	T* SaveTail()                   { return IsEmpty() ? 0 : &Tail(); }
+	T* SaveHead()                   { return IsEmpty() ? 0 : &Head(); }
+
+	T* GetNext(uint8_t idx)
+	{
+		idx = NextIndex(idx);
+		return idx != GetNextTailPos() && IsInQueue(idx) ? &Buffer[idx] : NULL;
+	}
+	T* GetPrev(uint8_t idx)
+	{
+		if (idx == GetHeadPos()) return NULL;
+		idx = PrevIndex(idx);
+		return IsInQueue(idx) ? &Buffer[idx] : NULL;
+	}
+	uint8_t GetHeadPos() const		{ return RINGBUFFER_LOAD(_head) % maxsize; }
+	uint8_t GetNextTailPos() const	{ return RINGBUFFER_LOAD(_tail) % maxsize; }
+	uint8_t GetTailPos() const		{ return PrevIndex(GetNextTailPos()); }
+
+	bool IsInQueue(uint8_t idx) const
+	{
+		return ((uint8_t)(idx - GetHeadPos())) % maxsize < Count() || IsFull();
+	}
+
+	// iteration from head to tail (H2T)
+	uint8_t H2TInit() const					{ return  IsEmpty() ? 255 : GetHeadPos(); }
+	bool H2TTest(uint8_t idx) const			{ return  idx != 255; }
+	uint8_t H2TInc(uint8_t idx) const		{ idx = NextIndex(idx); return idx == GetNextTailPos() ? 255 : idx; }
+
+	// iteration from tail to head (T2H)
+	uint8_t T2HInit() const					{ return  IsEmpty() ? 255 : GetTailPos(); }
+	bool T2HTest(uint8_t idx) const			{ return  idx != 255; }
+	uint8_t T2HInc(uint8_t idx) const		{ return idx == GetHeadPos() ? 255 : PrevIndex(idx); }
+
+	void Clear()							// producer and consumer must not run (e.g. in CCriticalRegion)
+	{
+		_head = 0;
+		_tail = 0;
+	}
+
+private:
+
+	volatile uint8_t	_head;      // count of dequeued elements (modified by consumer)
+	volatile uint8_t	_tail;		// count of enqueued elements (modified by producer)
+
+public:
+
+	T Buffer[maxsize];
+
+	////////////////////////////////////////////////////////
+
+public:
+
+	uint8_t NextIndex(uint8_t idx) const
+	{
+		return (uint8_t)((idx + 1)) % (maxsize);
+	}
+
+	uint8_t NextIndex(uint8_t idx, uint8_t count) const
+	{
+		return (uint8_t)((idx + count)) % (maxsize);
+	}
+
+	uint8_t PrevIndex(uint8_t idx) const
+	{
+		return idx == 0 ? (maxsize - 1) : (idx - 1);
+	}
+
+	uint8_t PrevIndex(uint8_t idx, uint8_t count) const
+	{
+		return (idx >= count) ? idx - count : (maxsize)-(count - idx);
+	}
+};
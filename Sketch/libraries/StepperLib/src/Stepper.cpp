@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <math.h>
 
 #include <Arduino.h>
 #include <ctype.h>
@@ -66,8 +67,18 @@ void CStepper::InitMemVar()
 
 	_pod._limitCheck = true;
 	_pod._idleLevel = LevelOff;
+#ifdef USE_PLANNER2PASS
+	_pod._planner2Pass = true;
+#endif
 
 	_pod._speedoverride = SpeedOverride100P;
+	_pod._rapidoverride = SpeedOverride100P;
+#ifndef REDUCED_SIZE
+	_movementstate._speedOverride = SpeedOverride100P << 8;
+#endif
+#ifdef USE_ADVANCE
+	_movementstate._advance = 0;
+#endif
 
 //	SetUsual(28000);	=> reduce size => hard coded
 	SetDefaultMaxSpeed(28000, 350, 380);
@@ -75,6 +86,10 @@ void CStepper::InitMemVar()
 
 	for (i = 0; i<MOVEMENTBUFFERSIZE; i++) _movements._queue.Buffer[i]._state= SMovement::StateDone;
 
+#ifndef REDUCED_SIZE
+	_movements._merge._idx = 255;
+#endif
+
 #ifdef _MSC_VER
 	MSCInfo = "";
 #endif
@@ -111,6 +126,93 @@ void CStepper::SetUsual(steprate_t vMax)
 
 ////////////////////////////////////////////////////////
 
+#ifdef USE_INPUTSHAPING
+
+void CStepper::SetInputShaper(axis_t axis, EnumAsByte(EInputShaper) shaper, float frequency, float damping)
+{
+	// impulses with K = exp(-damping*PI/sqrt(1-damping^2)) and damped period Td = 1/(frequency*sqrt(1-damping^2))
+	// ZV:  1, K        at 0, Td/2
+	// ZVD: 1, 2K, K^2  at 0, Td/2, Td
+	// MZV: 1-1/sqrt(2), (sqrt(2)-1)*K, (1-1/sqrt(2))*K^2 at 0, 3/8Td, 3/4Td with K = exp(-0.75*damping*PI/sqrt(1-damping^2))
+
+	WaitBusy();			// queued movements use the shaper (see SMovement::InitMove)
+
+	SInputShaper& inputShaper = _pod._inputShaper[axis];
+	memset(&inputShaper, 0, sizeof(inputShaper));
+
+	if (frequency <= 0.0f || damping < 0.0f || damping >= 1.0f)
+		return;
+
+	float dampedFactor = sqrt(1.0f - damping * damping);
+	float td = TIMER1FREQUENCE / (frequency * dampedFactor);
+	float k = exp(-damping * float(M_PI) / dampedFactor);
+	float a[3];
+	float t[3] = { 0.0f, td / 2.0f, td };
+
+	switch (shaper)
+	{
+		default:
+		case InputShaperNone:	return;
+		case InputShaperZV:		inputShaper._count = 2; a[0] = 1.0f; a[1] = k; break;
+		case InputShaperZVD:	inputShaper._count = 3; a[0] = 1.0f; a[1] = 2.0f * k; a[2] = k * k; break;
+		case InputShaperMZV:
+		{
+			k = exp(-0.75f * damping * float(M_PI) / dampedFactor);
+			inputShaper._count = 3;
+			a[0] = 1.0f - float(M_SQRT1_2); a[1] = (float(M_SQRT2) - 1.0f) * k; a[2] = a[0] * k * k;
+			t[1] = td * 0.375f; t[2] = td * 0.75f;
+			break;
+		}
+	}
+
+	float sum = 0.0f;
+	for (uint8_t i = 0; i < inputShaper._count; i++)
+		sum += a[i];
+
+	float mean = 0.0f;
+	unsigned short rest = 0x8000;
+	for (uint8_t i = 0; i < inputShaper._count; i++)
+	{
+		inputShaper._a[i] = i + 1 == inputShaper._count ? rest : (unsigned short)(a[i] / sum * 0x8000 + 0.5f);
+		inputShaper._t[i] = (unsigned long)(t[i] + 0.5f);
+		rest -= inputShaper._a[i];
+		mean += a[i] / sum * t[i];
+	}
+
+	inputShaper._tMean = (unsigned long)(mean + 0.5f);
+	inputShaper._shaper = shaper;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_ACCCURVE
+
+float CStepper::GetAccCurveFactor(axis_t axis, steprate_t speed) const
+{
+	// linear between the points of the table, constant outside
+
+	CAccCurve accCurve(_pod._accCurve[axis], _pod._accCurveSize[axis]);
+	float factor = accCurve.Lookup(speed > 0xffff ? 0xffff : (uint16_t)speed);
+	return factor < 0.01f ? 0.01f : factor;
+}
+
+////////////////////////////////////////////////////////
+
+timer_t CStepper::GetAccCurveTimer(axis_t axis, timer_t timerAccDec, steprate_t speed) const
+{
+	if (_pod._accCurveSize[axis] == 0)
+		return timerAccDec;
+
+	// a = v0^2 => timer scaled by 1/sqrt(factor)
+	return (timer_t)min(float(TIMER1MAX), timerAccDec / sqrt(GetAccCurveFactor(axis, speed)));
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
 void CStepper::Init()
 {
 	InitMemVar();
@@ -186,6 +288,15 @@ void CStepper::QueueMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NU
 
 	steps *= stepmult;
 
+#ifndef REDUCED_SIZE
+	if (stepmult == 1 && MergeMove(dist, directionUp, directionmask, direction, timerMax))
+		return;
+#endif
+
+#ifdef USE_BACKLASHBLEND
+	axisArray_t backlashAxes = 0;
+#endif
+
 	if (IsSetBacklash())
 	{
 		if ((_pod._lastdirection&directionmask) != direction)
@@ -201,10 +312,23 @@ void CStepper::QueueMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NU
 					backlashdist[i] = _pod._backlash[i];
 					if (backlashdist[i] > backlashsteps)
 						backlashsteps = backlashdist[i];
+#ifdef USE_BACKLASHBLEND
+					backlashAxes += mask;
+#endif
 				}
 				mask *= 2;
 			}
 
+#ifdef USE_BACKLASHBLEND
+			// take up backlash with the movement (see SMovementState::Backlash), no stop, if it fits into the movement:
+			// one backlash step each timerbacklash/timerMax steps (planned speed, the speed override is held while pending)
+			// and the split step (timerMax/2) not faster than the max speed of the axes - else a backlash move (stop)
+			if (backlashAxes && timerMax / 2 >= GetBacklashTimerMin(backlashAxes) &&
+				(unsigned long)backlashsteps * (_pod._timerbacklash / timerMax + 1) <= steps)
+				backlashsteps = 0;
+			else
+				backlashAxes = 0;
+#endif
 			if (backlashsteps)
 			{
 				// need backlash
@@ -230,10 +354,121 @@ void CStepper::QueueMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NU
 	WaitUntilCanQueue();
 
 	_movements._queue.NextTail().InitMove(this, GetPrevMovement(_movements._queue.GetNextTailPos()), steps, dist, directionUp, timerMax);
+#ifdef USE_BACKLASHBLEND
+	_movements._queue.NextTail().SetBacklash(backlashAxes);
+#endif
 
 	EnqueuAndStartTimer(true);
+
+#ifndef REDUCED_SIZE
+#ifdef USE_BACKLASHBLEND
+	if (stepmult == 1 && backlashAxes == 0)
+#else
+	if (stepmult == 1)
+#endif
+	{
+		// next move may be merged into this one
+		_movements._merge._idx = _movements._queue.GetTailPos();
+		_movements._merge._directionmask = directionmask;
+		_movements._merge._direction = direction;
+		_movements._merge._timerMax = timerMax;
+		_movements._merge._lead = 0;
+		for (axis_t i = 1; i < NUM_AXIS; i++)
+		{
+			if (dist[i] > dist[_movements._merge._lead])
+				_movements._merge._lead = i;
+		}
+		for (axis_t i = 0; i < NUM_AXIS; i++)
+		{
+			_movements._merge._slopeMin[i] = 0.0f;
+			_movements._merge._slopeMax[i] = 1.0f;
+		}
+		AddMergePoint(dist);
+		memcpy(_movements._merge._dist, dist, sizeof(_movements._merge._dist));
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+#ifndef REDUCED_SIZE
+
+bool CStepper::MergeMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NUM_AXIS], axisArray_t directionmask, axisArray_t direction, timer_t timerMax)
+{
+	// add move to the (not started) tail of the queue if the moves are collinear
+	// all junction points of the merged moves must be within the tolerance of the new (merged) line (see AddMergePoint)
+
+	if (_pod._mergeTolerance == 0 || _movements._merge._idx == 255 ||
+		_movements._merge._directionmask != directionmask || _movements._merge._direction != direction || _movements._merge._timerMax != timerMax)
+		return false;
+
+	mdist_t d[NUM_AXIS];
+	axis_t lead = _movements._merge._lead;
+	axis_t i;
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		udist_t sum = (udist_t)_movements._merge._dist[i] + dist[i];
+		if (sum > 0xffff)
+			return false;				// only short moves (mdist_t of 16 bit)
+
+		d[i] = (mdist_t)sum;
+	}
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		if (d[i] > d[lead])
+			return false;
+
+		float slope = float(d[i]) / float(d[lead]);
+		if (slope < _movements._merge._slopeMin[i] || slope > _movements._merge._slopeMax[i])
+			return false;
+	}
+
+	// calc the movement outside the critical region, copy of tail: not all members are set by InitMove
+
+	SMovement mv = _movements._queue.Tail();
+	mv.InitMove(this, GetPrevMovement(_movements._merge._idx), d[lead], d, directionUp, timerMax);
+
+	{
+		CCriticalRegion crit;
+
+		// the ISR must not start the tail while modifying it
+		if (_movements._queue.Count() < 2 || _movements._queue.GetTailPos() != _movements._merge._idx || !_movements._queue.Tail().IsReadyForMove())
+			return false;
+
+		_movements._queue.Tail() = mv;
+	}
+
+	AddMergePoint(_movements._merge._dist);
+	memcpy(_movements._merge._dist, d, sizeof(_movements._merge._dist));
+
+	OptimizeMovementQueue(false);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////
+
+void CStepper::AddMergePoint(const mdist_t point[NUM_AXIS])
+{
+	// junction point p: line (from start) with slope s[i] = dist[i]/dist[lead] has a deviation of |p[i] - s[i]*p[lead]| <= tolerance (+0.5 rounding of steps)
+	// => range of s[i] for each junction point, the intersection of all ranges is checked in MergeMove
+
+	float lead = float(point[_movements._merge._lead]);
+	float tolerance = _pod._mergeTolerance + 0.5f;
+
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+	{
+		float slopeMin = (float(point[i]) - tolerance) / lead;
+		float slopeMax = (float(point[i]) + tolerance) / lead;
+		if (slopeMin > _movements._merge._slopeMin[i]) _movements._merge._slopeMin[i] = slopeMin;
+		if (slopeMax < _movements._merge._slopeMax[i]) _movements._merge._slopeMax[i] = slopeMax;
+	}
 }
 
+#endif
+
 ////////////////////////////////////////////////////////
 
 void CStepper::QueueWait(const mdist_t dist, timer_t timerMax, bool checkWaitConditional)
@@ -273,6 +508,10 @@ void CStepper::EnqueuAndStartTimer(bool waitfinish)
 {
 	_movements._queue.Enqueue();
 
+#ifndef REDUCED_SIZE
+	_movements._merge._idx = 255;		// do not merge into wait, io or backlash
+#endif
+
 	OptimizeMovementQueue(false);
 
 	if (_pod._timerRunning)
@@ -327,6 +566,14 @@ void CStepper::SMovement::InitMove(CStepper*pStepper, SMovement* mvPrev, mdist_t
 	_pod._move._timerMax = timerMax;
 
 	_backlash = false;
+#ifdef USE_BACKLASHBLEND
+	_backlashAxes = 0;
+#endif
+	_optimized = false;
+	_rapid = pStepper->_pod._rapidMove;
+#ifdef USE_ARCMOVE
+	_arc._radius = 0;
+#endif
 
 	_steps = steps;
 	memcpy(_distance_, dist, sizeof(_distance_));
@@ -337,11 +584,20 @@ void CStepper::SMovement::InitMove(CStepper*pStepper, SMovement* mvPrev, mdist_t
 
 	// calculate relative speed for axis => limit speed for axis
 
+	_pod._move._timerOverrideMin = pStepper->_pod._timerMaxDefault;
+#ifndef REDUCED_SIZE
+	_pod._move._radius = pStepper->_pod._arcRadius;
+#endif
+
 	for (i = 0; i < NUM_AXIS; i++)
 	{
 		mdist_t d = dist[i];
 		if (d)
 		{
+			timer_t axisTimerMin = (timer_t)MulDivU32(pStepper->_pod._timerMax[i], d, _steps);
+			if (axisTimerMin > _pod._move._timerOverrideMin)
+				_pod._move._timerOverrideMin = axisTimerMin;
+
 			unsigned long axistimer = MulDivU32(_pod._move._timerMax, _steps, d);
 			if (axistimer < (unsigned long)pStepper->_pod._timerMax[i])
 			{
@@ -356,24 +612,106 @@ void CStepper::SMovement::InitMove(CStepper*pStepper, SMovement* mvPrev, mdist_t
 	_pod._move._timerAcc = 0;
 	_pod._move._timerDec = 0;
 
+#ifdef USE_ACCCURVE
+	// acc/dec of the planner at the max speed of the movement with the max speed override (limited by the max speed of the axis, see GetMaxSpeedOverride)
+	// the override may change while the movement is queued or executed, the ramp phases use the speed of the phase (see GetAccCurveTimer)
+	steprate_t speedMax = (steprate_t)MulDivU32(pStepper->TimerToSpeed(_pod._move._timerMax), SpeedOverrideMax, SpeedOverride100P);
+	if (_pod._move._timerOverrideMin != 0)
+		speedMax = min(speedMax, pStepper->TimerToSpeed(_pod._move._timerOverrideMin));
+#endif
+
 	for (i = 0; i < NUM_AXIS; i++)
 	{
 		mdist_t d = dist[i];
 		if (d)
 		{
-			timer_t accdec = (timer_t) MulDivU32(pStepper->_pod._timerAcc[i], d, _steps);
+			timer_t timerAcc = pStepper->_pod._timerAcc[i];
+			timer_t timerDec = pStepper->_pod._timerDec[i];
+#ifdef USE_ACCCURVE
+			steprate_t axisSpeed = (steprate_t)MulDivU32(speedMax, d, _steps);
+			timerAcc = pStepper->GetAccCurveTimer(i, timerAcc, axisSpeed);
+			timerDec = pStepper->GetAccCurveTimer(i, timerDec, axisSpeed);
+#endif
+			timer_t accdec = (timer_t) MulDivU32(timerAcc, d, _steps);
 			if (accdec > _pod._move._timerAcc)
 				_pod._move._timerAcc = accdec;
 
-			accdec = (timer_t) MulDivU32(pStepper->_pod._timerDec[i], d, _steps);
+			accdec = (timer_t) MulDivU32(timerDec, d, _steps);
 			if (accdec > _pod._move._timerDec)
 				_pod._move._timerDec = accdec;
 		}
 	}
 
+#ifdef USE_SCURVE
+	// and jerk (0 => no limit)
+
+	_pod._move._jerk = 0;
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		mdist_t d = dist[i];
+		if (d && pStepper->_pod._maxJerk[i])
+		{
+			unsigned long jerk = (unsigned long)(float(pStepper->_pod._maxJerk[i]) * _steps / d);
+			if (_pod._move._jerk == 0 || jerk < _pod._move._jerk)
+				_pod._move._jerk = jerk;
+		}
+	}
+#endif
+
+#ifdef USE_INPUTSHAPING
+	// input shaping: longest shaper (lowest frequency) of all moving axis
+
+	_pod._move._inputShaper = NULL;
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		const SInputShaper* shaper = &pStepper->_pod._inputShaper[i];
+		if (dist[i] && shaper->_count && (_pod._move._inputShaper == NULL || shaper->_t[shaper->_count - 1] > _pod._move._inputShaper->_t[_pod._move._inputShaper->_count - 1]))
+			_pod._move._inputShaper = shaper;
+	}
+#endif
+
+#ifdef USE_ADVANCE
+	// pressure advance: extruding (up) movements only
+
+	_pod._move._advanceSteps = 0;
+	_pod._move._advanceScale = 0;
+
+	i = pStepper->_pod._advanceAxis;
+	if (pStepper->_pod._advanceK > 0.0f && dist[i] != 0 && directionUp[i])
+	{
+		_pod._move._advanceSteps = dist[i];
+		_pod._move._advanceScale = (unsigned long)(pStepper->_pod._advanceK * TIMER1FREQUENCE * dist[i] / steps);
+	}
+#endif
+
 	// calculate StepMultiplier and adjust distance
 
 	uint8_t maxMultiplier = CStepper::GetStepMultiplier(_pod._move._timerMax);
+
+	// adaptive multi axis step smoothing: more ISR calls per step (slow moves only) => minor axis step at a finer time grid
+
+	_smoothLevel = 0;
+
+#if STEPSMOOTHING_MAXLEVEL > 0
+	if (maxMultiplier <= 1)
+	{
+		bool multiAxis = false;
+		for (i = 0; i < NUM_AXIS; i++)
+		{
+			if (dist[i] != 0 && dist[i] != _steps)
+				multiAxis = true;
+		}
+
+		while (multiAxis && _smoothLevel < STEPSMOOTHING_MAXLEVEL &&
+			(_pod._move._timerMax >> (_smoothLevel + 1)) >= TIMER1VALUE(STEPSMOOTHING_MAXRATE) &&
+			_steps <= (MAXSTEPSPERMOVE >> (_smoothLevel + 1)))
+		{
+			_smoothLevel++;
+		}
+	}
+#endif
 	_lastStepDirCount = 0;
 	_dirCount = 0;
 
@@ -476,7 +814,7 @@ void CStepper::SMovement::InitMove(CStepper*pStepper, SMovement* mvPrev, mdist_t
 	}
 	else
 	{
-		_pod._move._timerEndPossible = _pStepper->GetTimer(_steps, GetUpTimerAcc());
+		_pod._move._timerEndPossible = GetTimer(_steps, GetUpTimerAcc());
 	}
 
 	_pod._move._ramp.RampUp(this, _pod._move._timerRun, (timer_t)-1);
@@ -492,10 +830,31 @@ void CStepper::SMovement::InitStop(SMovement* mvPrev, timer_t timer, timer_t dec
 {
 	// must be a copy off current (executing) move
 	*this = *mvPrev;
+	_optimized = false;
+#ifdef USE_BACKLASHBLEND
+	_backlashAxes = 0;								// rest of backlash is done by mvPrev
+#endif
 
 	mvPrev->_steps = _pStepper->_movementstate._n;		// stop now
 
+#ifdef USE_ARCMOVE
+	if (IsArc())
+	{
+		// continue on arc from current position
+		_arc._x = _pStepper->_movementstate._arcX;
+		_arc._y = _pStepper->_movementstate._arcY;
+		_arc._f = _pStepper->_movementstate._arcF;
+		_arc._snapEnd = false;
+	}
+#endif
+
 	_pod._move._timerDec = dectimer;
+#ifdef USE_SCURVE
+	_pod._move._jerk = 0;			// stop with linear ramp
+#endif
+#ifdef USE_INPUTSHAPING
+	_pod._move._inputShaper = NULL;
+#endif
 
 	mdist_t downstpes = CStepper::GetDecSteps(timer, dectimer);
 
@@ -516,6 +875,148 @@ void CStepper::SMovement::InitStop(SMovement* mvPrev, timer_t timer, timer_t dec
 
 ////////////////////////////////////////////////////////
 
+#ifdef USE_ARCMOVE
+
+void CStepper::SMovement::InitArc(CStepper*pStepper, SMovement* mvPrev, mdist_t steps, const mdist_t dist[NUM_AXIS], const bool directionUp[NUM_AXIS], timer_t timerMax, const SArc& arc)
+{
+	// dist of axis0 and axis1 must be steps => acc/dec and enable of axis, the steps are calculated by ArcStep
+
+	InitMove(pStepper, mvPrev, steps, dist, directionUp, timerMax);
+
+	_arc = arc;
+	_smoothLevel = 0;
+}
+
+////////////////////////////////////////////////////////
+
+mdist_t CStepper::SMovement::GetJunctionDistance(axis_t axis, bool end)
+{
+	if (IsArc())
+	{
+		if (axis == _arc._axis0) return _arc._tangent[end][0];
+		if (axis == _arc._axis1) return _arc._tangent[end][1];
+	}
+	return GetDistance(axis);
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovement::GetJunctionDirectionUp(axis_t axis, bool end)
+{
+	if (IsArc())
+	{
+		if (axis == _arc._axis0) return _arc._tangentUp[end][0];
+		if (axis == _arc._axis1) return _arc._tangentUp[end][1];
+	}
+	return GetDirectionUp(axis);
+}
+
+////////////////////////////////////////////////////////
+
+inline void CStepper::SMovement::SArc::Next(sdist_t& x, sdist_t& y, long& f, bool clockwise, int8_t& dx, int8_t& dy)
+{
+	// midpoint circle: step the axis with the larger part of the tangent
+	// and the other axis if the error (f = x^2+y^2-r^2) gets smaller
+
+	sdist_t tx = clockwise ? y : -y;
+	sdist_t ty = clockwise ? -x : x;
+
+	if (labs(tx) >= labs(ty))
+	{
+		dx = tx > 0 ? 1 : -1;
+		f += 2 * x * dx + 1;
+		x += dx;
+
+		int8_t sy = ty > 0 ? 1 : (ty < 0 ? -1 : (y > 0 ? -1 : 1));
+		long f2 = f + 2 * y * sy + 1;
+		dy = 0;
+		if (labs(f2) < labs(f))
+		{
+			f = f2;
+			y += sy;
+			dy = sy;
+		}
+	}
+	else
+	{
+		dy = ty > 0 ? 1 : -1;
+		f += 2 * y * dy + 1;
+		y += dy;
+
+		int8_t sx = tx > 0 ? 1 : (tx < 0 ? -1 : (x > 0 ? -1 : 1));
+		long f2 = f + 2 * x * sx + 1;
+		dx = 0;
+		if (labs(f2) < labs(f))
+		{
+			f = f2;
+			x += sx;
+			dx = sx;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////
+
+static bool IsArcNearest(long f, sdist_t minor)
+{
+	// no step of the minor axis reduces |f| => path is the nearest point to the circle
+	return labs(f) < labs(f + 2 * minor + 1) && labs(f) < labs(f - 2 * minor + 1);
+}
+
+mdist_t CStepper::SMovement::CalcArcSteps(const SArc& arc, mdist_t minSteps, mdist_t maxSteps)
+{
+	// same path as in the ISR: steps until end is reached (the last step may "snap" to the end)
+	// while |minor| >= |major| the major axis steps each step and the path is the nearest point to the circle
+	// => skip to the region boundary (or near the end) and calc the position there (closed form), only steps near the boundary and the end are calculated one by one
+
+	const sdist_t margin = 4;
+	sdist_t p[2] = { arc._x, arc._y };
+	const sdist_t pEnd[2] = { arc._xEnd, arc._yEnd };
+	long f = arc._f;
+	int64_t r2 = (int64_t)arc._radius * arc._radius;
+	sdist_t boundary = (sdist_t)(arc._radius * M_SQRT1_2) - margin;
+	int8_t dx, dy;
+
+	for (mdist_t n = 1; n < maxSteps; n++)
+	{
+		uint8_t major = labs(p[1]) >= labs(p[0]) ? 0 : 1;
+		uint8_t minor = 1 - major;
+		sdist_t t = (arc._clockwise == (major == 0)) ? p[minor] : -p[minor];	// tangent of major axis
+		sdist_t dir = t > 0 ? 1 : -1;
+
+		sdist_t to = dir * boundary;
+		if ((pEnd[minor] > 0) == (p[minor] > 0) && labs(pEnd[major]) <= labs(pEnd[minor]) && (pEnd[major] - p[major]) * dir > 0 && (to - (pEnd[major] - dir * margin)) * dir > 0)
+			to = pEnd[major] - dir * margin;	// end ahead in this region
+
+		sdist_t skip = (to - p[major]) * dir;
+		if (skip > 0 && (udist_t)skip + n < maxSteps && IsArcNearest(f, p[minor]))
+		{
+			int64_t m2 = r2 - (int64_t)to * to;
+			int64_t o = (int64_t)sqrt((double)m2);
+			while (o > 0 && llabs((o - 1) * (o - 1) - m2) < llabs(o * o - m2))	o--;
+			while (llabs((o + 1) * (o + 1) - m2) < llabs(o * o - m2))			o++;
+
+			p[major] = to;
+			p[minor] = p[minor] < 0 ? (sdist_t)-o : (sdist_t)o;
+			f = (long)(o * o - m2);
+			n += (mdist_t)skip;
+		}
+
+		SArc::Next(p[0], p[1], f, arc._clockwise, dx, dy);
+
+		if (n >= minSteps && labs(p[0] - arc._xEnd) <= 1 && labs(p[1] - arc._yEnd) <= 1)
+		{
+			return (p[0] == arc._xEnd && p[1] == arc._yEnd) ? n : n + 1;
+		}
+	}
+
+	return 0;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
 void CStepper::SMovement::InitWait(CStepper*pStepper, mdist_t steps, timer_t timer, bool checkWaitConditional)
 {
 	//this is no POD because of methode's => *this = SMovement();		
@@ -576,6 +1077,44 @@ uint8_t CStepper::SMovement::GetMaxStepMultiplier()
 
 ////////////////////////////////////////////////////////
 
+#ifdef USE_ACCCURVE
+
+timer_t CStepper::SMovement::GetAccCurveTimer(timer_t timerAccDec, bool acc, timer_t timer0, timer_t timer1)
+{
+	// acc/dec of the torque curve at the mid speed of a ramp phase (timer >= timerAccDec => standstill), with the current speed override (if > 100%)
+	// not less than the acc/dec of the movement (see InitMove) => the junction speeds of the planner are reached
+
+#ifdef USE_INPUTSHAPING
+	if (IsInputShaping())
+		return timerAccDec;			// shaped ramp: acc/dec of the movement
+#endif
+
+	CStepper* pStepper = _pStepper;
+	unsigned long speed = ((timer0 >= timerAccDec ? 0 : pStepper->TimerToSpeed(timer0)) + (timer1 >= timerAccDec ? 0 : pStepper->TimerToSpeed(timer1))) / 2;
+	uint8_t speedOverride = _rapid ? pStepper->_pod._rapidoverride : pStepper->_pod._speedoverride;
+	if (speedOverride > SpeedOverride100P)
+		speed = MulDivU32(speed, speedOverride, SpeedOverride100P);
+
+	timer_t timer = 0;
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+	{
+		mdist_t d = _distance_[i];
+		if (d)
+		{
+			timer_t axisTimer = pStepper->GetAccCurveTimer(i, acc ? pStepper->_pod._timerAcc[i] : pStepper->_pod._timerDec[i], (steprate_t)MulDivU32(speed, d, _steps));
+			timer_t accdec = (timer_t)MulDivU32(axisTimer, d, _steps);
+			if (accdec > timer)
+				timer = accdec;
+		}
+	}
+
+	return min(timer, timerAccDec);
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
 void CStepper::SMovement::SRamp::RampUp(SMovement* pMovement, timer_t timerRun, timer_t timerJunction)
 {
 	_timerRun = timerRun;
@@ -583,6 +1122,9 @@ void CStepper::SMovement::SRamp::RampUp(SMovement* pMovement, timer_t timerRun,
 
 	if (timerJunction >= timerAccDec) // check from v0=0
 	{
+#ifdef USE_ACCCURVE
+		timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, true, timerJunction, _timerRun);
+#endif
 		_timerStart = max(timerAccDec, _timerRun);
 		_nUpOffset = 0;
 		_upSteps = GetAccSteps(_timerRun, timerAccDec);
@@ -593,6 +1135,9 @@ void CStepper::SMovement::SRamp::RampUp(SMovement* pMovement, timer_t timerRun,
 		_timerStart = timerJunction;
 		if (_timerStart >= _timerRun)		// acc while start
 		{
+#ifdef USE_ACCCURVE
+			timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, true, _timerStart, _timerRun);
+#endif
 			_nUpOffset = GetAccSteps(_timerStart, timerAccDec);
 			_upSteps = GetAccSteps(_timerRun, timerAccDec) - _nUpOffset;
 		}
@@ -600,10 +1145,21 @@ void CStepper::SMovement::SRamp::RampUp(SMovement* pMovement, timer_t timerRun,
 		{
 			_upSteps = CStepper::GetAccSteps(_timerRun, timerAccDec);
 			timerAccDec = pMovement->GetUpTimerDec();
+#ifdef USE_ACCCURVE
+			timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, false, _timerStart, _timerRun);
+#endif
 			_nUpOffset = GetDecSteps(_timerStart, timerAccDec);
 			_upSteps = _nUpOffset - GetDecSteps(_timerRun, timerAccDec);
 		}
 	}
+#ifdef USE_ACCCURVE
+	_upTimerAccDec = timerAccDec;
+#endif
+
+#ifdef USE_SCURVE
+	_upRampSteps = _upSteps;
+	_upSteps = pMovement->GetSCurveSteps(_upRampSteps, _timerStart, _timerRun);
+#endif
 }
 
 ////////////////////////////////////////////////////////
@@ -614,7 +1170,10 @@ void CStepper::SMovement::SRamp::RampDown(SMovement* pMovement, timer_t timerJun
 	timer_t timerAccDec = pMovement->GetDownTimerDec();
 	if (timerJunction >= timerAccDec)
 	{
-		_timerStop = max(timerAccDec, _timerRun);	// to v=0
+		_timerStop = max(timerAccDec, _timerRun);	// to v=0 (the last step is at the timer of the movement)
+#ifdef USE_ACCCURVE
+		timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, false, _timerRun, timerJunction);
+#endif
 		_downSteps = CStepper::GetDecSteps(_timerRun, timerAccDec);
 		_downStartAt = steps - _downSteps;
 		_nDownOffset = 0;
@@ -625,6 +1184,9 @@ void CStepper::SMovement::SRamp::RampDown(SMovement* pMovement, timer_t timerJun
 
 		if (_timerStop >= _timerRun)							// dec while stop
 		{
+#ifdef USE_ACCCURVE
+			timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, false, _timerRun, _timerStop);
+#endif
 			// shift down phase with _nDownOffset steps
 			_nDownOffset = CStepper::GetDecSteps(_timerStop, timerAccDec);
 			_downSteps = CStepper::GetDecSteps(_timerRun, timerAccDec);
@@ -633,12 +1195,24 @@ void CStepper::SMovement::SRamp::RampDown(SMovement* pMovement, timer_t timerJun
 		else
 		{
 			timerAccDec = pMovement->GetDownTimerAcc();
+#ifdef USE_ACCCURVE
+			timerAccDec = pMovement->GetAccCurveTimer(timerAccDec, true, _timerRun, _timerStop);
+#endif
 			_nDownOffset = CStepper::GetAccSteps(_timerStop, timerAccDec);
 			//_downStartAt = _steps - 2 - (_nDownOffset - CStepper::GetAccSteps(_timerRun,timerAccDec));
 			_downStartAt = steps - (_nDownOffset - CStepper::GetAccSteps(_timerRun, timerAccDec));
 		}
 		_downSteps = steps - _downStartAt;
 	}
+#ifdef USE_ACCCURVE
+	_downTimerAccDec = timerAccDec;
+#endif
+
+#ifdef USE_SCURVE
+	_downRampSteps = _downSteps;
+	_downSteps = pMovement->GetSCurveSteps(_downRampSteps, _timerRun, _timerStop);
+	_downStartAt = steps - _downSteps;
+#endif
 }
 
 ////////////////////////////////////////////////////////
@@ -646,6 +1220,21 @@ void CStepper::SMovement::SRamp::RampDown(SMovement* pMovement, timer_t timerJun
 void CStepper::SMovement::SRamp::RampRun(SMovement* pMovement)
 {
 	mdist_t steps = pMovement->_steps;
+#ifdef USE_SCURVE
+	mdist_t upRampSteps = _upRampSteps;
+	mdist_t downRampSteps = _downRampSteps;
+#endif
+#ifdef USE_INPUTSHAPING
+	if (pMovement->IsInputShaping())
+	{
+		// the shaped ramp has a constant part (duration of shaper) => do not cut proportional
+		if (_upSteps > steps || steps - _upSteps < _downSteps)
+			CutInputShaping(pMovement, upRampSteps, downRampSteps);
+
+		SCurve(pMovement, upRampSteps, downRampSteps);
+		return;
+	}
+#endif
 
 	if (_upSteps > steps || steps - _upSteps < _downSteps)
 	{
@@ -664,8 +1253,13 @@ void CStepper::SMovement::SRamp::RampRun(SMovement* pMovement)
 		}
 		else
 		{
+#ifdef USE_ACCCURVE
+			timer_t upTimer = _upTimerAccDec;
+			timer_t downTimer = _downTimerAccDec;
+#else
 			timer_t upTimer = pMovement->GetUpTimer(_timerStart > _timerRun);
 			timer_t downTimer = pMovement->GetUpTimer(_timerStop < _timerRun);
+#endif
 
 			unsigned long sqUp = (unsigned long)(upTimer)* (unsigned long)(upTimer);
 			unsigned long sqDown = (unsigned long)(downTimer)* (unsigned long)(downTimer);
@@ -684,6 +1278,14 @@ void CStepper::SMovement::SRamp::RampRun(SMovement* pMovement)
 			// return false;	=> do not return in case of error, assume "valid" values!
 		}
 
+#ifdef USE_SCURVE
+		// keep the stretch of the S-curve
+		if (_upSteps)
+			_upRampSteps = (mdist_t) MulDivU32(_upRampSteps, _upSteps - subUp, _upSteps);
+		if (_downSteps)
+			_downRampSteps = (mdist_t) MulDivU32(_downRampSteps, _downSteps - (toMany - subUp), _downSteps);
+#endif
+
 		_upSteps -= subUp;
 		_downSteps -= toMany - subUp;
 
@@ -695,8 +1297,199 @@ void CStepper::SMovement::SRamp::RampRun(SMovement* pMovement)
 
 		_downStartAt = steps - _downSteps;
 	}
+
+#ifdef USE_SCURVE
+	if (pMovement->IsSCurve())
+		SCurve(pMovement, upRampSteps, downRampSteps);
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_SCURVE
+
+// S-curve in time: v(t) = v0 + (v1-v0) * smoothstep(t/T) with smoothstep(x) = 3x^2 - 2x^3
+// steps = (v0+v1)/2 * T (as linear ramp)
+// max acc  = 1.5 * |v1-v0| / T	=> T >= 1.5 * Tlinear
+// max jerk = 6 * |v1-v0| / T^2	=> T >= sqrt(6 * |v1-v0| / jerk)
+//
+// input shaping: linear ramp (acc, time Ta) convolved with the impulses (a[i], t[i]) of the shaper
+// v(t) = v0 + (v1-v0) * sum(a[i] * clamp((t-t[i])/Ta)), T = Ta + t[last], max acc = acc
+
+float CStepper::SMovement::GetSCurveRampSteps(float v0, float v1, float acc)
+{
+#ifdef USE_INPUTSHAPING
+	if (IsInputShaping())
+	{
+		// steps = v0*T + (v1-v0) * (T - Ta/2 - sum(a[i]*t[i]))
+		const SInputShaper* shaper = _pod._move._inputShaper;
+		float rampTime = fabs(v1 - v0) / acc;
+		float time = rampTime + float(shaper->_t[shaper->_count - 1]) / TIMER1FREQUENCE;
+		return v0 * time + (v1 - v0) * (time - rampTime / 2.0f - float(shaper->_tMean) / TIMER1FREQUENCE);
+	}
+#else
+	(void)acc;
+#endif
+	return (v0 + v1) / 2.0f * sqrt(6.0f * fabs(v1 - v0) / _pod._move._jerk);
+}
+
+////////////////////////////////////////////////////////
+
+mdist_t CStepper::SMovement::GetSCurveSteps(mdist_t rampSteps, timer_t timer0, timer_t timer1)
+{
+	if (!IsSCurve() || rampSteps == 0)
+		return rampSteps;
+
+	float v0 = _pStepper->TimerToSpeed(timer0);
+	float v1 = _pStepper->TimerToSpeed(timer1);
+#ifdef USE_INPUTSHAPING
+	if (IsInputShaping())
+	{
+		// ramp table starts with v=0 (first step is timerAccDec) => convolve ramp from/to standstill
+		if (timer0 >= GetUpTimerAcc())		v0 = 0.0f;
+		if (timer1 >= GetDownTimerDec())	v1 = 0.0f;
+	}
+#endif
+
+	float steps = GetSCurveRampSteps(v0, v1, fabs(v1 * v1 - v0 * v0) / 2.0f / rampSteps);
+	float minSteps = rampSteps * 1.5f;
+#ifdef USE_INPUTSHAPING
+	if (IsInputShaping())
+		minSteps = rampSteps;
+#endif
+	if (steps < minSteps)
+		steps = minSteps;
+
+	return steps >= MAXACCDECSTEPS ? MAXACCDECSTEPS : (mdist_t) steps;
+}
+
+////////////////////////////////////////////////////////
+
+timer_t CStepper::SMovement::GetTimerSCurve(mdist_t steps, timer_t timerv0, timer_t timerAccDec)
+{
+	// acc limited: linear ramp with steps/1.5 (input shaping: steps)
+	mdist_t accSteps = steps * 2 / 3;
+	float acc = 0.0f;
+#ifdef USE_INPUTSHAPING
+	if (IsInputShaping())
+	{
+		accSteps = steps;
+		acc = (float)_pStepper->GetAccelerationFromTimer(timerAccDec);
+	}
+#endif
+	timer_t timer = timerv0 == (timer_t)-1 ? _pStepper->GetTimer(accSteps, timerAccDec) : _pStepper->GetTimerAccelerating(accSteps, timerv0, timerAccDec);
+
+	float v0 = timerv0 == (timer_t)-1 ? 0.0f : _pStepper->TimerToSpeed(timerv0);
+	float v1 = _pStepper->TimerToSpeed(timer);
+
+	if (v1 <= v0 || GetSCurveRampSteps(v0, v1, acc) <= steps)
+		return timer;
+
+	// jerk limited: (v0+v1)/2 * sqrt(6 * (v1-v0) / jerk) = steps
+	float vmin = v0;
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		float v = (vmin + v1) / 2.0f;
+		if (GetSCurveRampSteps(v0, v, acc) <= steps)
+			vmin = v;
+		else
+			v1 = v;
+	}
+
+	return max(timer, _pStepper->SpeedToTimer((steprate_t)vmin));
+}
+
+////////////////////////////////////////////////////////
+
+void CStepper::SMovement::SRamp::SCurve(SMovement* pMovement, mdist_t upRampSteps, mdist_t downRampSteps)
+{
+	// calc T and k of up and down phase, the linear ramp may be cut (RampRun)
+	// v^2 is linear to the ramp steps
+
+	float vStart = pMovement->_pStepper->TimerToSpeed(_timerStart);
+	float vRun   = pMovement->_pStepper->TimerToSpeed(_timerRun);
+	float vStop  = pMovement->_pStepper->TimerToSpeed(_timerStop);
+
+	// input shaping: the center of the ramp is shifted by sum(a[i]*t[i]) - t[last]/2 (0 for symmetric shaper)
+	float shift = 0.0f;
+#ifdef USE_INPUTSHAPING
+	if (pMovement->IsInputShaping())
+	{
+		const SInputShaper* shaper = pMovement->_pod._move._inputShaper;
+		shift = (float(shaper->_t[shaper->_count - 1]) / 2.0f - float(shaper->_tMean)) / TIMER1FREQUENCE;
+
+		// see GetSCurveSteps, from/to standstill
+		if (_timerStart >= pMovement->GetUpTimerAcc())		vStart = 0.0f;
+		if (_timerStop >= pMovement->GetDownTimerDec())		vStop = 0.0f;
+	}
+#endif
+
+	float v0 = vStart;
+	float v1 = upRampSteps == 0 ? vRun : sqrt(vStart*vStart + (vRun*vRun - vStart*vStart) * _upRampSteps / upRampSteps);
+
+	_upTime = (unsigned long)(max(0.0f, 2.0f * (_upSteps - (v1 - v0) * shift) / (v0 + v1)) * TIMER1FREQUENCE);
+	_upK = (unsigned short)min(0xffff, 2.0f * v0 / (v0 + v1) * 0x8000);
+#ifdef USE_INPUTSHAPING
+	_upV0 = (steprate_t)v0;
+	_upV1 = (steprate_t)v1;
+#endif
+
+	v1 = vStop;
+	v0 = downRampSteps == 0 ? vRun : sqrt(vStop*vStop + (vRun*vRun - vStop*vStop) * _downRampSteps / downRampSteps);
+
+	_downTime = (unsigned long)(max(0.0f, 2.0f * (_downSteps - (v1 - v0) * shift) / (v0 + v1)) * TIMER1FREQUENCE);
+	_downK = (unsigned short)min(0xffff, 2.0f * v0 / (v0 + v1) * 0x8000);
+#ifdef USE_INPUTSHAPING
+	_downV0 = (steprate_t)v0;
+	_downV1 = (steprate_t)v1;
+#endif
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_INPUTSHAPING
+
+void CStepper::SMovement::SRamp::CutInputShaping(SMovement* pMovement, mdist_t upRampSteps, mdist_t downRampSteps)
+{
+	// we cant reach vmax for this movement: max v with steps(up) + steps(down) <= steps
+
+	CStepper* pStepper = pMovement->_pStepper;
+	mdist_t steps = pMovement->_steps;
+
+	float vStart = _timerStart >= pMovement->GetUpTimerAcc() ? 0.0f : pStepper->TimerToSpeed(_timerStart);
+	float vStop  = _timerStop >= pMovement->GetDownTimerDec() ? 0.0f : pStepper->TimerToSpeed(_timerStop);
+	float vRun   = pStepper->TimerToSpeed(_timerRun);
+
+	float accUp   = (float)pStepper->GetAccelerationFromTimer(pMovement->GetUpTimerAcc());
+	float accDown = (float)pStepper->GetAccelerationFromTimer(pMovement->GetDownTimerDec());
+
+	float vmin = max(vStart, vStop);
+	float vmax = vRun;
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		float v = (vmin + vmax) / 2.0f;
+		if (pMovement->GetSCurveRampSteps(vStart, v, accUp) + pMovement->GetSCurveRampSteps(v, vStop, accDown) <= steps)
+			vmin = v;
+		else
+			vmax = v;
+	}
+
+	float upSteps = vmin > vStart ? pMovement->GetSCurveRampSteps(vStart, vmin, accUp) : 0.0f;
+	_upSteps = upSteps >= steps ? steps : (mdist_t)upSteps;
+	_downSteps = steps - _upSteps;
+	_downStartAt = _upSteps;
+
+	// linear ramp steps => v of SCurve (v^2 is linear to the ramp steps)
+	float vRun2 = vRun * vRun;
+	float vmin2 = vmin * vmin;
+	_upRampSteps = vRun2 > vStart * vStart ? (mdist_t)(upRampSteps * (vmin2 - vStart * vStart) / (vRun2 - vStart * vStart) + 0.5f) : 0;
+	_downRampSteps = vRun2 > vStop * vStop ? (mdist_t)(downRampSteps * (vmin2 - vStop * vStop) / (vRun2 - vStop * vStop) + 0.5f) : 0;
 }
 
+#endif
+
 ////////////////////////////////////////////////////////
 
 bool CStepper::SMovement::Ramp(SMovement*mvNext)
@@ -712,10 +1505,20 @@ bool CStepper::SMovement::Ramp(SMovement*mvNext)
 		tmpramp.RampDown(this,mvNext ? mvNext->_pod._move._timerJunctionToPrev : GetDownTimerDec());
 		tmpramp.RampRun(this);
 
+#ifdef USE_ACCCURVE
+		bool sameUpAcc = tmpramp._upTimerAccDec == _pod._move._ramp._upTimerAccDec;	// acc of a started ramp is given by n and timer
+#else
+		const bool sameUpAcc = true;
+#endif
+
 		CCriticalRegion crit;
 
 		if (IsReadyForMove() ||
-			(IsUpMove()  && _pStepper->_movementstate._n <  tmpramp._upSteps) ||		// in acc
+#ifdef USE_SCURVE
+			(IsUpMove()  && sameUpAcc && _pStepper->_movementstate._n <  tmpramp._upSteps && (!IsSCurve() || tmpramp.IsSameUp(_pod._move._ramp))) ||	// in acc, S-curve: only dec/run may change
+#else
+			(IsUpMove()  && sameUpAcc && _pStepper->_movementstate._n <  tmpramp._upSteps) ||		// in acc
+#endif
 		    (IsRunMove() && _pStepper->_movementstate._n <  tmpramp._downStartAt))		// in run
 		{
 			_pod._move._ramp = tmpramp;
@@ -732,8 +1535,12 @@ void CStepper::SMovement::AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvN
 {
 	if (!IsActiveMove()) return;						// Move became inactive by ISR or "WaitState"/"IoControl"
 
+	bool startOptimized = _optimized;
+
 	if (mvPrev == NULL || IsRunOrDownMove())			// no prev or processing (can be if the ISR has switchted to the next move)
 	{
+		startOptimized = true;
+
 		// first "now" executing move
 		if (IsRunOrUpMove())
 		{
@@ -745,7 +1552,7 @@ void CStepper::SMovement::AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvN
 			else
 			{
 				// just continue accelerate to the end of the move
-				_pod._move._timerEndPossible = _pStepper->GetTimerAccelerating(_steps, _pod._move._ramp._timerStart, GetUpTimerAcc());
+				_pod._move._timerEndPossible = GetTimerEndPossible(_pod._move._ramp._timerStart, GetUpTimerAcc());
 			}
 		}
 		else
@@ -753,7 +1560,7 @@ void CStepper::SMovement::AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvN
 	}
 	else
 	{
-		_pod._move._timerEndPossible = _pStepper->GetTimerAccelerating(_steps, mvPrev->IsActiveMove() ? (mvPrev->IsProcessingMove() ? mvPrev->_pod._move._ramp._timerStop : mvPrev->_pod._move._timerEndPossible) : -1, GetUpTimerAcc());
+		_pod._move._timerEndPossible = GetTimerEndPossible(mvPrev->IsActiveMove() ? (mvPrev->IsProcessingMove() ? mvPrev->_pod._move._ramp._timerStop : mvPrev->_pod._move._timerEndPossible) : -1, GetUpTimerAcc());
 
 		if (_pod._move._timerEndPossible > _pod._move._timerMax)
 		{
@@ -768,7 +1575,12 @@ void CStepper::SMovement::AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvN
 		assert(mvNext->IsActiveMove());
 #endif
 		// next element available, calculate junction speed
-		mvNext->_pod._move._timerJunctionToPrev = max(mvNext->_pod._move._timerMaxJunction, max(_pod._move._timerEndPossible, mvNext->_pod._move._timerJunctionToPrev));
+		timer_t junction = max(mvNext->_pod._move._timerMaxJunction, _pod._move._timerEndPossible);
+
+		// junction not limited by T2H (break at end) => new moves at the tail can not change it any more
+		mvNext->_optimized = startOptimized && junction >= mvNext->_pod._move._timerJunctionToPrev;
+
+		mvNext->_pod._move._timerJunctionToPrev = max(junction, mvNext->_pod._move._timerJunctionToPrev);
 		_pod._move._timerEndPossible = mvNext->_pod._move._timerJunctionToPrev;
 	}
 	
@@ -776,7 +1588,17 @@ void CStepper::SMovement::AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvN
 	{
 		// modify of ramp failed => do not modify _pod._move._timerEndPossible
 		_pod._move._timerEndPossible = _pod._move._ramp._timerStop;
-		if (mvNext != NULL) mvNext->_pod._move._timerJunctionToPrev = _pod._move._ramp._timerStop;
+		if (mvNext != NULL)
+		{
+#ifdef USE_PLANNER2PASS
+			// 2-pass: stop timer >= dec timer => v=0 (next starts with acc timer)
+			if (_pStepper->_pod._planner2Pass && _pod._move._ramp._timerStop >= GetDownTimerDec())
+				mvNext->_pod._move._timerJunctionToPrev = (timer_t)-1;
+			else
+#endif
+			mvNext->_pod._move._timerJunctionToPrev = _pod._move._ramp._timerStop;
+			mvNext->_optimized = false;
+		}
 	}
 }
 
@@ -791,13 +1613,13 @@ bool CStepper::SMovement::AdjustJunktionSpeedT2H(SMovement*mvPrev, SMovement*mvN
 	if (mvNext == NULL)
 	{
 		// last element in queue, v(end) = 0, we have to stop
-		_pStepper->_movements._timerStartPossible = _pStepper->GetTimer(_steps, GetDownTimerDec());
+		_pStepper->_movements._timerStartPossible = GetTimer(_steps, GetDownTimerDec());
 	}
 	else
 	{
 		// calculate new speed at start of move
 		// assume _timerStartPossible (of next move) at end
-		_pStepper->_movements._timerStartPossible = _pStepper->GetTimerAccelerating(_steps, _pStepper->_movements._timerStartPossible, GetDownTimerDec());
+		_pStepper->_movements._timerStartPossible = GetTimerAccelerating(_steps, _pStepper->_movements._timerStartPossible, GetDownTimerDec());
 	}
 
 	if (mvPrev != NULL)
@@ -819,6 +1641,70 @@ bool CStepper::SMovement::AdjustJunktionSpeedT2H(SMovement*mvPrev, SMovement*mvN
 	return false;
 }
 
+////////////////////////////////////////////////////////
+
+timer_t CStepper::SMovement::GetTimerEndPossible(timer_t timerv0, timer_t timerAccDec)
+{
+#ifdef USE_PLANNER2PASS
+	if (_pStepper->_pod._planner2Pass)
+		return GetTimerPlanned(timerv0, timerAccDec);
+#endif
+	return GetTimerAccelerating(_steps, timerv0, timerAccDec);
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_PLANNER2PASS
+
+timer_t CStepper::SMovement::GetTimerPlanned(timer_t timerv0, timer_t timerAccDec)
+{
+	// fastest speed after _steps accelerating from timerv0 (-1 => v0=0): v^2 = v0^2 + 2*a*s
+	// calculated with the steps of the ramp (GetAccSteps) => the ramp of the move (Ramp) can reach the speed
+	// GetTimerAccelerating applies the correction factor to v0^2, too => the speed decreases with each move of the chain
+
+#ifdef USE_SCURVE
+	if (IsSCurve())
+		return GetTimerAccelerating(_steps, timerv0, timerAccDec);
+#endif
+
+	unsigned long n = _steps;
+	if (timerv0 < timerAccDec)
+		n += CStepper::GetAccSteps(timerv0, timerAccDec);
+
+	if (n > MAXACCDECSTEPS)
+		n = MAXACCDECSTEPS;
+
+	// GetAccSteps: n = timerAccDec^2 * 93/85 / (2 * t*(t-1)) => t
+	float sqT = float(timerAccDec) * float(timerAccDec) * 93.0f / 85.0f / (2.0f * float(n));
+	float t = (1.0f + sqrt(1.0f + 4.0f * sqT)) / 2.0f;
+
+	timer_t timer = t < TIMER1VALUEMAXSPEED ? TIMER1VALUEMAXSPEED : (timer_t)t;
+	while (timer < timerAccDec && CStepper::GetAccSteps(timer, timerAccDec) > n)
+		timer++;
+
+	return timer;
+}
+
+////////////////////////////////////////////////////////
+// backward pass: max speed at start of move to be able to stop at the end of the queue
+// return timer at start (junction to prev)
+
+timer_t CStepper::SMovement::PlanJunktionSpeedT2H(SMovement*mvPrev, timer_t timerEnd)
+{
+	timer_t timerStart = GetTimerPlanned(timerEnd, GetDownTimerDec());
+
+	if (mvPrev != NULL && mvPrev->IsActiveMove())
+	{
+		_pod._move._timerRun = _pod._move._timerMax;
+		_pod._move._timerJunctionToPrev = max(_pod._move._timerMaxJunction, timerStart);
+		return _pod._move._timerJunctionToPrev;
+	}
+
+	return timerStart;
+}
+
+#endif
+
 ////////////////////////////////////////////////////////
 // calculate the max junction between two movements- consider jerk - speed is maxspeed - only calculated once (at setup time of movement)
 
@@ -845,13 +1731,25 @@ void CStepper::SMovement::CalcMaxJunktionSpeed(SMovement*mvPrev)
 
 	for (mainaxis = 0; mainaxis < NUM_AXIS; mainaxis++)
 	{
-		if (s1 == mvPrev->GetDistance(mainaxis) && s2 == GetDistance(mainaxis) && mvPrev->GetDirectionUp(mainaxis) == GetDirectionUp(mainaxis))
+		if (s1 == mvPrev->GetJunctionDistance(mainaxis, true) && s2 == GetJunctionDistance(mainaxis, false) && mvPrev->GetJunctionDirectionUp(mainaxis, true) == GetJunctionDirectionUp(mainaxis, false))
 		{
 			_pod._move._timerMaxJunction = (long(mvPrev->_pod._move._timerMax) + long(_pod._move._timerMax)) / 2;
 			break;
 		}
 	}
 
+#ifndef REDUCED_SIZE
+	if (_pStepper->_pod._junctionDeviation != 0)
+	{
+		// junction deviation model instead of max jerk of axis (curves: centripetal acceleration)
+		if (!CalcCurveJunctionTimer(mvPrev, timerMaxJunctionAcc, timerMaxJunction))
+			timerMaxJunction = CalcJunctionDeviationTimer(mvPrev, timerMaxJunctionAcc);
+
+		_pod._move._timerMaxJunction = timerMaxJunction;
+		return;
+	}
+#endif
+
 	timer_t timerMaxJunction_ = _pod._move._timerMaxJunction;
 	/*
 		printf("H: s1=%i s2=%i\n", (int)s1, (int)s2);
@@ -871,8 +1769,8 @@ void CStepper::SMovement::CalcMaxJunktionSpeed(SMovement*mvPrev)
 	{
 		if (i != mainaxis)
 		{
-			mdist_t d1 = mvPrev->GetDistance(i);
-			mdist_t d2 = GetDistance(i);
+			mdist_t d1 = mvPrev->GetJunctionDistance(i, true);
+			mdist_t d2 = GetJunctionDistance(i, false);
 
 			steprate_t v1 = _pStepper->TimerToSpeed(mvPrev->_pod._move._timerMax);
 			steprate_t v2 = _pStepper->TimerToSpeed(_pod._move._timerMax);
@@ -883,7 +1781,7 @@ void CStepper::SMovement::CalcMaxJunktionSpeed(SMovement*mvPrev)
 
 			long vdiff;
 
-			if (v1 == 0 || v2 == 0 || mvPrev->GetDirectionUp(i) == GetDirectionUp(i))
+			if (v1 == 0 || v2 == 0 || mvPrev->GetJunctionDirectionUp(i, true) == GetJunctionDirectionUp(i, false))
 			{
 				// same direction (v1 and v2 not 0)
 				vdiff = v1 > v2 ? v1 - v2 : v2 - v1;
@@ -916,10 +1814,138 @@ void CStepper::SMovement::CalcMaxJunktionSpeed(SMovement*mvPrev)
 			}
 		}
 	}
+
+#ifndef REDUCED_SIZE
+	// curve: speed is limited by centripetal acceleration and not by jerk
+	if (CalcCurveJunctionTimer(mvPrev, timerMaxJunctionAcc, timerMaxJunction))
+	{
+		_pod._move._timerMaxJunction = timerMaxJunction;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+#ifndef REDUCED_SIZE
+
+#define CURVEMAXANGLECOS	0.7071f		// max 45grad between segments of a curve
+
+float CStepper::SMovement::GetJunctionCos(SMovement*mvPrev, float& len1, float& len2)
+{
+	// cos of angle between the direction of mvPrev (at end) and this (at start): 1 => same direction, -1 => reverse
+	// len: length of the direction vectors (0 => no direction)
+
+	float dot = 0.0;
+	len1 = 0.0;
+	len2 = 0.0;
+
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+	{
+		float d1 = mvPrev->GetJunctionDistance(i, true);
+		float d2 = GetJunctionDistance(i, false);
+		if (mvPrev->GetJunctionDirectionUp(i, true) != GetJunctionDirectionUp(i, false))
+			d2 = -d2;
+
+		dot += d1 * d2;
+		len1 += d1 * d1;
+		len2 += d2 * d2;
+	}
+
+	if (len1 == 0.0 || len2 == 0.0)
+		return 1.0;
+
+	len1 = sqrt(len1);
+	len2 = sqrt(len2);
+
+	return dot / (len1 * len2);
+}
+
+////////////////////////////////////////////////////////
+
+timer_t CStepper::SMovement::GetJunctionTimer(SMovement*mvPrev, float v, timer_t timerMaxJunctionAcc)
+{
+	// v is the speed on the path, timer is for the steps of this move
+	// not faster than both moves, not slower than start/stop speed
+
+	timer_t timerMax = min(mvPrev->_pod._move._timerMax, _pod._move._timerMax);
+
+	if (v >= _pStepper->TimerToSpeed(timerMax))
+		return timerMax;
+
+	return min(_pStepper->SpeedToTimer(v < 1.0 ? 1 : (steprate_t)v), timerMaxJunctionAcc);
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovement::CalcCurveJunctionTimer(SMovement*mvPrev, timer_t timerMaxJunctionAcc, timer_t& timer)
+{
+	// junction is part of a curve if
+	// a) both moves are segments of the same arc (radius from CStepper::SetArcRadius)
+	// b) or the segments are a polyline of a circle with r = chord / (2*sin(angle/2)) and the deviation (sagitta) is within the tolerance
+	// max speed on the curve: v = sqrt(a*r)
+
+	if (_pStepper->_pod._curveTolerance == 0)
+		return false;
+
+	float len1, len2;
+	float cosAngle = GetJunctionCos(mvPrev, len1, len2);
+
+	if (len1 == 0.0 || len2 == 0.0 || cosAngle < CURVEMAXANGLECOS)
+		return false;								// corner
+
+	float radius;
+
+	if (_pod._move._radius != 0 && _pod._move._radius == mvPrev->_pod._move._radius)
+	{
+		radius = (float)_pod._move._radius;
+	}
+	else
+	{
+		float sinHalf = sqrt((1.0f - cosAngle) / 2.0f);
+		if (sinHalf < 1e-4)
+			return false;							// (almost) collinear => jerk calculation is fine
+
+		radius = min(len1, len2) / (2.0f * sinHalf);
+		if (radius * (1.0f - sqrt(1.0f - sinHalf * sinHalf)) * STEPFRACTION > _pStepper->_pod._curveTolerance)
+			return false;							// long segments => corner
+	}
+
+	timer_t timerAcc = max(GetUpTimerAcc(), mvPrev->GetDownTimerDec());
+	float v = sqrt((float)_pStepper->GetAccelerationFromTimer(timerAcc) * radius) * _steps / len2;
+
+	timer = GetJunctionTimer(mvPrev, v, timerMaxJunctionAcc);
+
+	return true;
 }
 
 ////////////////////////////////////////////////////////
 
+timer_t CStepper::SMovement::CalcJunctionDeviationTimer(SMovement*mvPrev, timer_t timerMaxJunctionAcc)
+{
+	// junction deviation: the corner is a circle touching both moves with max distance "deviation" to the corner
+	// v^2 = a * r with r = deviation * sin(theta/2) / (1 - sin(theta/2))  (theta: angle between -prev and this, 180grad => same direction)
+
+	float len1, len2;
+	float cosAngle = GetJunctionCos(mvPrev, len1, len2);
+
+	if (len1 == 0.0 || len2 == 0.0)
+		return _pod._move._timerMaxJunction;
+
+	float sinHalf = sqrt((1.0f + cosAngle) / 2.0f);
+	if (sinHalf > 0.9999)
+		return GetJunctionTimer(mvPrev, 1e9, timerMaxJunctionAcc);	// collinear
+
+	timer_t timerAcc = max(GetUpTimerAcc(), mvPrev->GetDownTimerDec());
+	float radius = _pStepper->_pod._junctionDeviation * (1.0f / STEPFRACTION) * sinHalf / (1.0f - sinHalf);
+	float v = sqrt((float)_pStepper->GetAccelerationFromTimer(timerAcc) * radius) * _steps / len2;
+
+	return GetJunctionTimer(mvPrev, v, timerMaxJunctionAcc);
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
 CStepper::SMovement* CStepper::GetNextMovement(uint8_t idx)
 {
 	// get next movment which can be optimized (no IOControl)
@@ -959,17 +1985,36 @@ CStepper::SMovement* CStepper::GetPrevMovement(uint8_t idx)
 
 void CStepper::OptimizeMovementQueue(bool /* force */)
 {
+	_movements._optimizeCount = 0;
+
 	if (_movements._queue.IsEmpty() || _movements._queue.Count() < 2)
 		return;
 
+#ifdef USE_PLANNER2PASS
+	if (_pod._planner2Pass)
+	{
+		PlanMovementQueue();
+		return;
+	}
+#endif
+
 	uint8_t idx;
 	uint8_t idxnochange = _movements._queue.H2TInit();
 
 	////////////////////////////////////
 	// calculate junction (max) speed!
+	// stop at the watermark: moves from head to the first "_optimized" move are fully optimized
 
 	for (idx = _movements._queue.T2HInit(); _movements._queue.T2HTest(idx); idx = _movements._queue.T2HInc(idx))
 	{
+		if (_movements._queue.Buffer[idx]._optimized)
+		{
+			idxnochange = idx;
+			break;
+		}
+
+		_movements._optimizeCount++;
+
 		if (_movements._queue.Buffer[idx].AdjustJunktionSpeedT2H(GetPrevMovement(idx), GetNextMovement(idx)))
 		{
 			idxnochange = idx;
@@ -983,10 +2028,54 @@ void CStepper::OptimizeMovementQueue(bool /* force */)
 
 	for (idx = idxnochange; _movements._queue.H2TTest(idx); idx = _movements._queue.H2TInc(idx))
 	{
+		_movements._optimizeCount++;
+		_movements._queue.Buffer[idx].AdjustJunktionSpeedH2T(GetPrevMovement(idx), GetNextMovement(idx));
+	}
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_PLANNER2PASS
+
+void CStepper::PlanMovementQueue()
+{
+	// time optimal planner: all movements of the queue (after the last wait)
+	// backward pass: max junction speed to stop at the end of the queue (dec of the move)
+	// forward pass: junction speed limited by acc from the executing move, calculate ramp
+	// no "nothing changed" break => the planned speed does not depend on the history of the queue
+	// stop at the watermark (see AdjustJunktionSpeedH2T): new moves at the tail only allow a faster stop, the start speed of an "_optimized" move is limited by acc from head
+
+	uint8_t idx;
+	uint8_t idxFirst = _movements._queue.H2TInit();
+	timer_t timerEnd = (timer_t)-1;						// v=0 at the end of the queue
+
+	for (idx = _movements._queue.T2HInit(); _movements._queue.T2HTest(idx); idx = _movements._queue.T2HInc(idx))
+	{
+		SMovement& mv = _movements._queue.Buffer[idx];
+
+		if (mv.IsSkipForOptimizing())
+			continue;
+
+		if (!mv.IsActiveMove() || mv._optimized)
+		{
+			// wait (previous moves stop here) or watermark: already planned
+			idxFirst = idx;
+			break;
+		}
+
+		_movements._optimizeCount++;
+		timerEnd = mv.PlanJunktionSpeedT2H(GetPrevMovement(idx), timerEnd);
+	}
+
+	for (idx = idxFirst; _movements._queue.H2TTest(idx); idx = _movements._queue.H2TInc(idx))
+	{
+		_movements._optimizeCount++;
 		_movements._queue.Buffer[idx].AdjustJunktionSpeedH2T(GetPrevMovement(idx), GetNextMovement(idx));
 	}
 }
 
+#endif
+
 ////////////////////////////////////////////////////////
 
 void CStepper::OnIdle(unsigned long idletime)
@@ -1213,25 +2302,98 @@ mdist_t CStepper::GetSteps(timer_t timer1, timer_t timer2, timer_t timerstart, t
 
 ////////////////////////////////////////////////////////
 
-void CStepper::StopMove(steprate_t v0Dec)
-{
-	if (_movements._queue.Count() > 0)
-	{
-		SMovement& mv = _movements._queue.Head();
+#ifdef USE_RAMPTABLE
 
-		if (mv.IsActiveWait())
-		{
-			CCriticalRegion critical;
-			_movementstate._n = mv._steps;
-		}
-		else
-		{
-			timer_t dectimer = v0Dec!=0 ? SpeedToTimer(v0Dec) : mv.GetDownTimerDec();
+// base ramp table (from v=0): factor(n) = timer(n)/timer(0) of the integer ramp calculation Cn = Cn-1 * (4n-1)/(4n+1)
+// n < 32 : one entry for each step
+// n >= 32: 16 entries for each power of 2 (n = (16..31) << e), interpolated with shift => no division
+// the table is generated by the compiler (constexpr)
 
-			{
-				CCriticalRegion critical;
+#define RAMPTABLELINEAR		32
+#define RAMPTABLEOCTAVE		16
 
-				// do nothing if move is about to finish
+constexpr uint8_t RampTableBitLength(uint32_t n)							{ return n == 0 ? 0 : 1 + RampTableBitLength(n >> 1); }
+constexpr uint16_t RampTableOctaves()										{ return RampTableBitLength(MAXACCDECSTEPS) - 5; }
+#define RAMPTABLESIZE		(RAMPTABLELINEAR + RampTableOctaves()*RAMPTABLEOCTAVE + 1)
+
+constexpr uint32_t RampTableN(uint16_t idx)									{ return idx < RAMPTABLELINEAR ? idx : uint32_t(idx - (idx / RAMPTABLEOCTAVE - 1) * RAMPTABLEOCTAVE) << (idx / RAMPTABLEOCTAVE - 1); }
+constexpr double RampTableProduct(uint32_t n)								{ return n == 0 ? 1.0 : RampTableProduct(n - 1) * (4.0 * n - 1.0) / (4.0 * n + 1.0); }
+constexpr double RampTableSqrt(double x, double r, uint8_t iterations)		{ return iterations == 0 ? r : RampTableSqrt(x, (r + x / r) / 2.0, iterations - 1); }
+constexpr double RampTableValue(uint32_t n)									{ return n < RAMPTABLELINEAR ? RampTableProduct(n) : RampTableProduct(RAMPTABLELINEAR) * RampTableSqrt((RAMPTABLELINEAR + 0.5) / (n + 0.5), 1.0, 32); }	// error of sqrt approximation < 2e-5
+constexpr rampfactor_t RampTableFactor(uint16_t idx)						{ return RampTableValue(RampTableN(idx)) * (1ull << RAMPFACTORBITS) >= (rampfactor_t)-1 ? (rampfactor_t)-1 : (rampfactor_t)(RampTableValue(RampTableN(idx)) * (1ull << RAMPFACTORBITS) + 0.5); }
+
+template<uint16_t... idx> struct SRampTable
+{
+	static const rampfactor_t _factor[sizeof...(idx)];
+};
+
+template<uint16_t... idx> const rampfactor_t SRampTable<idx...>::_factor[sizeof...(idx)] PROGMEM = { RampTableFactor(idx)... };
+
+template<uint16_t count, uint16_t... idx> struct SRampTableBuilder : SRampTableBuilder<count - 1, count - 1, idx...> {};
+template<uint16_t... idx> struct SRampTableBuilder<0, idx...> { typedef SRampTable<idx...> Table; };
+
+typedef SRampTableBuilder<RAMPTABLESIZE>::Table CRampTable;
+
+////////////////////////////////////////////////////////
+
+static inline rampfactor_t ReadRampTable(uint16_t idx)
+{
+#if defined(use16bit)
+	return pgm_read_word(&CRampTable::_factor[idx]);
+#else
+	return pgm_read_dword(&CRampTable::_factor[idx]);
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+rampfactor_t CStepper::GetRampFactor(mdist_t n)
+{
+	if (n < RAMPTABLELINEAR)
+		return ReadRampTable(n);
+
+	uint8_t e = 0;
+	mdist_t m = n;
+	while (m >= RAMPTABLELINEAR)
+	{
+		m >>= 1;
+		e++;
+	}
+
+	uint16_t idx = e * RAMPTABLEOCTAVE + m;
+	if (idx >= RAMPTABLESIZE - 1)
+		return ReadRampTable(RAMPTABLESIZE - 1);
+
+	rampfactor_t f0 = ReadRampTable(idx);
+	rampfactor_t f1 = ReadRampTable(idx + 1);
+	mdist_t frac = n & ((((mdist_t)1) << e) - 1);
+
+	return f0 - (rampfactor_t)(((rampscale_t)(f0 - f1) * frac) >> e);
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+void CStepper::StopMove(steprate_t v0Dec)
+{
+	if (_movements._queue.Count() > 0)
+	{
+		SMovement& mv = _movements._queue.Head();
+
+		if (mv.IsActiveWait())
+		{
+			CCriticalRegion critical;
+			_movementstate._n = mv._steps;
+		}
+		else
+		{
+			timer_t dectimer = v0Dec!=0 ? SpeedToTimer(v0Dec) : mv.GetDownTimerDec();
+
+			{
+				CCriticalRegion critical;
+
+				// do nothing if move is about to finish
 				if (mv.IsDownMove())
 					return;
 
@@ -1245,6 +2407,9 @@ void CStepper::StopMove(steprate_t v0Dec)
 				_movements._queue.NextTail().InitStop(&mv, _movementstate._timer,dectimer);
 
 				_movements._queue.Enqueue();
+#ifndef REDUCED_SIZE
+				_movements._merge._idx = 255;
+#endif
 			}
 
 			WaitBusy();
@@ -1262,9 +2427,16 @@ void CStepper::AbortMove()
 	SubTotalSteps();
 
 	_steps.Clear();
+	_pod._stepRepeat = 0;
 	_movements._queue.Clear();
+#ifndef REDUCED_SIZE
+	_movements._merge._idx = 255;
+#endif
 
 	memcpy(_pod._calculatedpos, _pod._current, sizeof(_pod._calculatedpos));
+#ifdef USE_ADVANCE
+	_movementstate._advance = 0;
+#endif
 
 	GoIdle();
 }
@@ -1298,7 +2470,7 @@ void CStepper::PauseMove()
 
 				for (axis_t x = 0; canInsertAfter && x < NUM_AXIS;x++)
 				{
-					mdist_t d = mv.GetDistance(x);
+					mdist_t d = mv.GetJunctionDistance(x, true);
 					steprate_t v = speedStop;
 
 					if (d != s) v = steprate_t(RoundMulDivUInt(v, d, s));
@@ -1375,7 +2547,7 @@ uint8_t CStepper::GetStepMultiplier(timer_t timermax)
 
 ////////////////////////////////////////////////////////
 
-inline void CStepper::StepOut()
+inline bool CStepper::StepOut()
 {
 	// called in interrupt => must be "fast"
 	// "Out" the Step to the stepper 
@@ -1383,11 +2555,29 @@ inline void CStepper::StepOut()
 	// calculate all axes and set PINS parallel - DRV 8225 requires 1.9us * 2 per step => sequential is to slow 
 
 	DirCount_t dir_count;
+	bool dequeue = true;
 
 	{
 		const SStepBuffer* stepbuffer = &_steps.Head();
 		StartTimer(stepbuffer->Timer - TIMEROVERHEAD);
 		dir_count = stepbuffer->DirStepCount;
+
+#ifdef USE_STATUSSNAPSHOT
+		_pod._snapshotSeq++;									// odd: readers must copy again
+		HALCompilerBarrier();
+		_pod._snapshotTimer = stepbuffer->Timer;
+		_pod._snapshotDirCount = dir_count;
+#endif
+
+		if (_pod._stepRepeat < stepbuffer->Repeat)
+		{
+			_pod._stepRepeat++;
+			dequeue = false;
+		}
+		else
+		{
+			_pod._stepRepeat = 0;
+		}
 	}
 
 #ifdef _MSC_VER
@@ -1440,9 +2630,17 @@ inline void CStepper::StepOut()
 			break;
 	}
 
+#ifdef USE_STATUSSNAPSHOT
+	HALCompilerBarrier();
+	_pod._snapshotSeq++;
+#endif
+
 	Step(axescount,directionUp^_pod._invertdirection);
 
-	_steps.Dequeue();
+	if (dequeue)
+		_steps.Dequeue();
+
+	return dequeue;
 }
 
 ////////////////////////////////////////////////////////
@@ -1500,8 +2698,17 @@ void CStepper::FillStepBuffer()
 	// calculate next steps until buffer is full or nothing to do!
 	while (!_movements._queue.IsEmpty())
 	{
+#ifdef STEPPERPROFILE
+		uint8_t stepcount = _steps.Count();
+		ProfileBegin(ProfileCalcNextSteps);
+		bool calculated = _movements._queue.Head().CalcNextSteps(true);
+		ProfileEnd(ProfileCalcNextSteps, _steps.Count() - stepcount);
+		if (!calculated)
+			break;
+#else
 		if (!_movements._queue.Head().CalcNextSteps(true))		// buffer full => wait (and leave ISR)
 			break;
+#endif
 
 		if (_movements._queue.Head().IsFinished())
 		{
@@ -1598,7 +2805,13 @@ void CStepper::StepRequest(bool isr)
 		return;
 	}
 
-	StepOut();
+#ifdef STEPPERPROFILE
+	ProfileBegin(ProfileStepOut);
+	bool dequeued = StepOut();
+	ProfileEnd(ProfileStepOut, 1);
+#else
+	bool dequeued = StepOut();
+#endif
 
 	if ((_pod._checkReference && IsAnyReference()))
 	{
@@ -1607,102 +2820,613 @@ void CStepper::StepRequest(bool isr)
 		return;
 	}
 
-	// calculate next step 
+	// calculate next step (not if buffer element is repeated => buffer not changed)
+
+	if (dequeued)
+		StartBackground();
+}
+
+////////////////////////////////////////////////////////
+
+#if defined (stepperstatic_)
+
+CStepper::SMovementState CStepper::_movementstate;
+CStepper::SStepBufferQueue CStepper::_steps;
+CStepper::SMovements CStepper::_movements;
+CStepper* CStepper::SMovement::_pStepper;
+
+#endif
+
+////////////////////////////////////////////////////////
+
+void CStepper::SMovementState::Init(SMovement* pMovement)
+{
+	mdist_t steps = pMovement->_steps;
+
+	if (pMovement->_state == SMovement::StateReadyMove)
+	{
+		_count = pMovement->GetMaxStepMultiplier();
+		_timer = pMovement->_pod._move._ramp._timerStart;
+#ifdef USE_ADVANCE
+		_advanceRemaining = pMovement->_pod._move._advanceSteps;
+#endif
+	}
+	else
+	{
+		_count = 1;
+		_timer = pMovement->_pod._wait._timer;
+#ifdef USE_ADVANCE
+		_advanceRemaining = 0;
+#endif
+	}
+	
+	steps = ((steps << pMovement->_smoothLevel) / _count) >> 1;
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+		_add[i] = steps;
+	_n = 0;
+	_subStep = 0;
+	_rest = 0;
+	StartRamp();
+#ifdef USE_ARCMOVE
+	if (pMovement->_state == SMovement::StateReadyMove && pMovement->IsArc())
+	{
+		_arcX = pMovement->_arc._x;
+		_arcY = pMovement->_arc._y;
+		_arcF = pMovement->_arc._f;
+		_arcMajor = 0;			// calc _arcScale with first step
+	}
+#endif
+#ifndef REDUCED_SIZE
+	_sumTimer = 0;
+	_maxOverrideUntil = 0;
+#endif
+#ifdef USE_BACKLASHBLEND
+	_backlashN = 0;
+	_backlashSteps = 0;
+	_backlashTime = 0;
+	_backlashTimerMin = pMovement->_pStepper->GetBacklashTimerMin(pMovement->_backlashAxes);
+	if (pMovement->_state == SMovement::StateReadyMove)
+	{
+		for (axis_t i = 0; i < NUM_AXIS; i++)
+		{
+			if ((pMovement->_backlashAxes & (1 << i)) && pMovement->_pStepper->_pod._backlash[i] > _backlashSteps)
+				_backlashSteps = pMovement->_pStepper->_pod._backlash[i];
+		}
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_RAMPTABLE
+
+timer_t CStepper::SMovementState::GetRampTimer(mdist_t n) const
+{
+	// timer = scale * factor(n) => mul and shift only
+
+	rampfactor_t factor = GetRampFactor(n);
+
+#if defined(use16bit)
+	unsigned long timer = (_rampScale >> 16) * factor + (((_rampScale & 0xffff) * factor) >> 16);	// no overrun
+#else
+	rampscale_t timer = (_rampScale * factor) >> RAMPFACTORBITS;
+#endif
+
+	return timer >= TIMER1MAX ? TIMER1MAX : (timer_t) timer;
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_SCURVE
+
+mdist_t CStepper::SMovementState::SCurve(mdist_t n, mdist_t steps, mdist_t rampSteps, unsigned long time, unsigned short k)
+{
+	// map step n (0..steps) of the S-curve to step of the linear ramp (0..rampSteps)
+	// x = t/T, v = v0 + (v1-v0) * smoothstep(x)
+	// linear ramp: v^2 ~ n => n = rampSteps * (v^2 - v0^2) / (v1^2 - v0^2) = rampSteps * u * (k + (1-k)*u) with u = smoothstep(x)
+	// (1/T) is calculated once for each acc/dec phase => no division
+
+	if (steps == rampSteps)
+		return n;		// linear
+	if (n >= steps || _sCurveTime >= time)
+		return rampSteps;
+
+	if (_sCurveInvTime == 0)
+		_sCurveInvTime = (((rampscale_t)1) << 30) / time;
+
+	unsigned long x = (unsigned long)((_sCurveTime * _sCurveInvTime) >> 15);	// 1.0 = 1<<15
+
+	unsigned long x2 = (x * x) >> 15;
+	unsigned long u = (x2 * (3 * 0x8000ul - 2 * x)) >> 15;				// 3x^2 - 2x^3
+	long w = ((long)u * ((long)k + (((0x8000l - (long)k) * (long)u) >> 15))) >> 15;
+
+	return (mdist_t)((((rampscale_t)rampSteps) * (unsigned long)w) >> 15);
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+static inline unsigned long MulU15(unsigned long v, unsigned long u)
+{
+	// (v*u) >> 15 with u < 0x10000 => no overrun of 32bit (for v*u < 2^47)
+	return (v >> 15) * u + (((v & 0x7fff) * u) >> 15);
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_INPUTSHAPING
+
+void CStepper::SMovementState::StartInputShaping(SMovement* pMovement, bool up)
+{
+	// once for each acc/dec phase => no division for each step
+
+	const SMovement::SRamp& ramp = pMovement->_pod._move._ramp;
+	const SInputShaper* shaper = pMovement->_pod._move._inputShaper;
+
+	unsigned long time = up ? ramp._upTime : ramp._downTime;
+	unsigned long tLast = shaper->_t[shaper->_count - 1];
+
+	_shapingRampTime = time > tLast ? time - tLast : 1;
+	_sCurveInvTime = (((rampscale_t)1) << 30) / _shapingRampTime;
+	_shapingStopAcc = up ? 0 : (unsigned long)(float(ramp._downV0) * TIMER1FREQUENCE / _shapingRampTime * shaper->_a[shaper->_count - 1] / 0x8000);
+}
+
+////////////////////////////////////////////////////////
+
+unsigned long CStepper::SMovementState::GetInputShapingSpeed(SMovement* pMovement, bool up, unsigned long t) const
+{
+	// v = v0 + (v1-v0) * sum(a[i] * clamp((t-t[i])/Ta)), (1/Ta) is calculated once for each acc/dec phase (StartInputShaping)
+	// return v*16 (steps/sec) => rounding error of timer and v are small compared to the sum of steps of the phase
+
+	const SMovement::SRamp& ramp = pMovement->_pod._move._ramp;
+	const SInputShaper* shaper = pMovement->_pod._move._inputShaper;
+
+	unsigned long u = 0;
+	for (uint8_t i = 0; i < shaper->_count && t > shaper->_t[i]; i++)
+	{
+		unsigned long dt = t - shaper->_t[i];
+		unsigned long x = dt >= _shapingRampTime ? 0x8000 : (unsigned long)((dt * _sCurveInvTime) >> 15);	// 1.0 = 1<<15
+		u += (x * shaper->_a[i]) >> 15;
+	}
+
+	steprate_t v0 = up ? ramp._upV0 : ramp._downV0;
+	steprate_t v1 = up ? ramp._upV1 : ramp._downV1;
+	unsigned long v016 = ((unsigned long)v0) * 16;
+	return v1 >= v0 ? v016 + MulU15(((unsigned long)(v1 - v0)) * 16, u) : v016 - MulU15(((unsigned long)(v0 - v1)) * 16, u);
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovementState::CalcTimerInputShaping(SMovement* pMovement, uint8_t cnt)
+{
+	// linear ramp convolved with the impulses of the shaper (see GetSCurveRampSteps)
+	// timer = 1/v with v in the middle of the step, the speed may be below the start of the ramp table
+	// estimate the middle with the last timer and correct it once (else acc and dec are not symmetric)
+	// return true at the end of the phase (T)
+
+	const SMovement::SRamp& ramp = pMovement->_pod._move._ramp;
+	bool up = pMovement->_state < SMovement::StateRun;
+
+	unsigned long time = up ? ramp._upTime : ramp._downTime;
+	unsigned long t = _sCurveTime + ((unsigned long)_timer) * cnt / 2;
+
+	if (t >= time)
+	{
+		// v1 of up phase may be below vRun (see CutInputShaping)
+		timer_t timerUp = ramp._upV1 == 0 ? ramp._timerRun : (timer_t)min((unsigned long)TIMER1MAX, TIMER1FREQUENCE / ramp._upV1);
+		_timer = up ? max(ramp._timerRun, timerUp) : ramp._timerStop;
+		return true;
+	}
+
+	if (_sCurveInvTime == 0)
+		StartInputShaping(pMovement, up);
+
+	unsigned long v16;
+	unsigned long timer;
+
+	const SInputShaper* shaper = pMovement->_pod._move._inputShaper;
+	unsigned long tLast = shaper->_t[shaper->_count - 1];
+	unsigned long tTail = tLast - shaper->_t[shaper->_count - 2];
+
+	if (!up && ramp._downV1 == 0 && t + tTail >= time && time > tLast)
+	{
+		// stop: only the last impulse is left, v = a[last]*acc*(T-t) => position based (v^2 = 2*a[last]*acc*s)
+		// the time based ramp may end with a speed jump (the sum of the rounding errors of the phase is some steps)
+		// (16v)^2 = 256*acc*(2*s) with s in half steps
+
+		unsigned long remaining2 = 2ul * (pMovement->_steps - _n);
+		unsigned long accRemaining = remaining2 > cnt ? _shapingStopAcc * (remaining2 - cnt) : 0;
+		v16 = accRemaining < 0x1000000ul ? _ulsqrt(accRemaining << 8) : _ulsqrt(accRemaining) << 4;
+		timer = v16 == 0 ? TIMER1MAX : (TIMER1FREQUENCE * 16 + v16 / 2) / v16;
+		_timer = timer >= TIMER1MAX ? TIMER1MAX : (timer_t)timer;
+		return false;
+	}
+
+	v16 = GetInputShapingSpeed(pMovement, up, t);
+	timer = v16 == 0 ? TIMER1MAX : (TIMER1FREQUENCE * 16 + v16 / 2) / v16;
+	if (timer > TIMER1MAX) timer = TIMER1MAX;
+
+	v16 = GetInputShapingSpeed(pMovement, up, _sCurveTime + timer * cnt / 2);
+	timer = (timer + (v16 == 0 ? TIMER1MAX : (TIMER1FREQUENCE * 16 + v16 / 2) / v16)) / 2;
+
+	_timer = timer >= TIMER1MAX ? TIMER1MAX : (timer_t)timer;
+
+	return false;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovementState::CalcTimerAcc(timer_t maxtimer, mdist_t n, uint8_t cnt)
+{
+	// use base ramp table: Cn = Cx * factor(n) / factor(x)
+	// scale (Cx / factor(x)) is calculated once (first step of acc/dec) => one division per ramp
+
+	if (maxtimer < _timer)
+	{
+		if (_rampScale == 0)
+			_rampScale = (((rampscale_t)_timer) << RAMPFACTORBITS) / GetRampFactor(n >= cnt ? n - cnt : 0);
+
+		_timer = GetRampTimer(n);
+		if (maxtimer >= _timer)
+		{
+			_timer = maxtimer;
+			return true;
+		}
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovementState::CalcTimerDec(timer_t mintimer, mdist_t n, uint8_t cnt)
+{
+	// see CalcTimerAcc, n is decreasing
+
+	if (mintimer > _timer)
+	{
+		if (n <= 1)
+		{
+			_timer = mintimer;
+			return true;
+		}
+		if (_rampScale == 0)
+			_rampScale = (((rampscale_t)_timer) << RAMPFACTORBITS) / GetRampFactor(n + cnt);
+
+		_timer = GetRampTimer(n);
+		if (mintimer <= _timer)
+		{
+			_timer = mintimer;
+			return true;
+		}
+	}
+	return false;
+}
+
+#else
+
+bool CStepper::SMovementState::CalcTimerAcc(timer_t maxtimer, mdist_t n, uint8_t cnt)
+{
+	// use for float: Cn = Cn-1 - 2*Cn-1 / (4*N + 1)
+	// use for INTEGER:
+	// In = ((2*In-1)+Rn-1) / (4*N + 1)		=> quot
+	// Rn = ((2*In-1)+Rn-1) % (4*N + 1)		=> remainer of division
+	// Cn = Cn-1 - In
+
+	if (maxtimer < _timer)
+	{
+		mudiv_t udivremainer = mudiv(_timer*(2 * cnt) + _rest, n * 4 + 2 - cnt);
+		_rest = udivremainer.rem;
+		_timer = _timer - udivremainer.quot;
+		if (maxtimer >= _timer)
+		{
+			_timer = maxtimer;
+			return true;
+		}
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovementState::CalcTimerDec(timer_t mintimer, mdist_t n, uint8_t cnt)
+{
+	// use for float: Cn = Cn-1 + 2*Cn-1 / (4*N - 1)
+	// use for INTEGER:
+	// In = ((2*In-1)+Rn-1) / (4*N - 1)		=> quot
+	// Rn = ((2*In-1)+Rn-1) % (4*N - 1)		=> remainer of division
+	// Cn = Cn-1 - In
+
+	if (mintimer > _timer)
+	{
+		if (n <= 1)
+		{
+			_timer = mintimer;
+			return true;
+		}
+		mudiv_t udivremainer = mudiv(_timer*(2 * cnt) + _rest, n * 4 - 1 - cnt);
+		_rest = udivremainer.rem;
+		_timer = _timer + udivremainer.quot;
+		if (mintimer <= _timer)
+		{
+			_timer = mintimer;
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_ADVANCE
+
+void CStepper::SMovementState::Advance(SMovement* pMovement, DirCount_t& dirCount)
+{
+	// pressure advance: the extruder leads by k*v steps (v: speed of the extruder axis)
+	// add one step to the entry of the step buffer or skip steps of it (the direction is not changed)
+	// the lead is limited to the remaining steps and the steps of a following extruding movement => it can skip the lead, 0 at the end
+
+	CStepper* pStepper = pMovement->_pStepper;
+	uint8_t shift = pStepper->_pod._advanceAxis * 4;
+	uint8_t count = (uint8_t)(dirCount >> shift) & 7;
+
+	_advanceRemaining -= count;
+
+	timer_t timer = _timer;
+#ifndef REDUCED_SIZE
+	// speed of the extruder with the speed override (see CalcNextSteps)
+	if (_speedOverride != (CStepper::SpeedOverride100P << 8))
+		timer = (timer_t)max(1ul, min((unsigned long)TIMER1MAX, RoundMulDivU32(timer, CStepper::SpeedOverride100P << 8, _speedOverride)));
+#endif
+
+	unsigned long lead = pMovement->_pod._move._advanceScale / timer;
+	if (lead > _advanceRemaining)
+	{
+		unsigned long maxLead = _advanceRemaining;
+		SMovement* mvNext = pStepper->GetNextMovement(pStepper->_movements._queue.GetHeadPos());
+		if (mvNext != NULL && mvNext->IsReadyForMove())
+			maxLead += mvNext->_pod._move._advanceSteps;
+		if (lead > maxLead)
+			lead = maxLead;
+	}
+
+	if (lead > _advance && count < 7)
+	{
+		count++;
+		_advance++;
+	}
+	else if (lead < _advance && count > 0)
+	{
+		uint8_t skip = (uint8_t)min((unsigned long)count, _advance - lead);
+		count -= skip;
+		_advance -= skip;
+	}
+	else
+	{
+		return;
+	}
+
+	dirCount = (dirCount & ~(((DirCount_t)15) << shift)) | (((DirCount_t)(count ? count + 8 : 0)) << shift);
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_BACKLASHBLEND
+
+timer_t CStepper::GetBacklashTimerMin(axisArray_t axes) const
+{
+	timer_t timerMin = max(_pod._timerMaxDefault, (timer_t)TIMER1MIN);
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+	{
+		if ((axes & (1 << i)) && _pod._timerMax[i] > timerMin)
+			timerMin = _pod._timerMax[i];
+	}
+	return timerMin;
+}
+
+////////////////////////////////////////////////////////
+
+DirCount_t CStepper::SMovementState::BacklashStep(SMovement* pMovement)
+{
+	// one step of all axes with pending backlash (direction of movement), not counted as position
+
+	CStepper* pStepper = pMovement->_pStepper;
+	DirCountByte_t x = DirCountByte_t(); //POD
+	x.byte.byteInfo.nocount = 1;
+	DirCount_t stepcount = x.all;
+
+	for (axis_t i = 0; i < NUM_AXIS; i++)
+	{
+		if ((pMovement->_backlashAxes & (1 << i)) && _backlashN < pStepper->_pod._backlash[i])
+			stepcount += (((pMovement->_dirCount >> (i * 4)) & 8) + 1) << (i * 4);
+	}
+
+	_backlashN++;
+	return stepcount;
+}
+
+////////////////////////////////////////////////////////
+
+bool CStepper::SMovementState::Backlash(SMovement* pMovement)
+{
+	// interleave a backlash step with the step of the movement (tail of step buffer, not enqueued yet)
+	// the timer of the step is split => the speed of the movement is not changed
+	// backlash steps are limited to the backlash speed (_timerbacklash) and the split step to the max speed of the axes
+	// return true if the step and the backlash step are enqueued
+
+	CStepper* pStepper = pMovement->_pStepper;
+	SStepBuffer& step = pStepper->_steps.NextTail();
+	timer_t timer = step.Timer;
+
+	_backlashTime += timer;
+
+	if (_backlashTime < pStepper->_pod._timerbacklash || timer / 2 < _backlashTimerMin || pStepper->_steps.FreeCount() < 2)
+		return false;
+
+	step.Timer = timer / 2;
+	pStepper->_steps.Enqueue();
+
+	pStepper->_steps.NextTail().Init(BacklashStep(pMovement));
+	pStepper->_steps.NextTail().Timer = timer - timer / 2;
+	pStepper->_steps.Enqueue();
+
+	_backlashTime = 0;
+	return true;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_ARCMOVE
+
+DirCount_t CStepper::SMovementState::ArcStep(SMovement* pMovement, mdist_t n)
+{
+	// step of axis0 and axis1 (as DirCount_t), the last step moves to the end
+
+	SMovement::SArc& arc = pMovement->_arc;
+	int8_t dx, dy;
+
+	sdist_t major = max(labs(_arcX), labs(_arcY));
+	if (major != _arcMajor)
+	{
+		// r/major = 1/(1-e) with e = (r-major)/r <= 1-1/sqrt(2) (about 0.5 for a small r)
+		// (1+e)(1+e^2)(1+e^4) = (1-e^8)/(1-e) => error < 0.01% (e < 0.3) without division
+
+		_arcMajor = major;
+		unsigned long e = 0;
+		if (major < (sdist_t)arc._radius)
+		{
+			e = ((((unsigned long)arc._radius - major) >> arc._radiusShift) * arc._invRadius) >> 15;
+			if (e > 0x4000) e = 0x4000;
+		}
+		unsigned long scale = 0x8000 + e;
+		e = (e * e) >> 15;	scale = (scale * (0x8000 + e)) >> 15;
+		e = (e * e) >> 15;	scale = (scale * (0x8000 + e)) >> 15;
+		_arcScale = (unsigned short)scale;
+	}
+
+	if (arc._snapEnd && n + 1 >= pMovement->_steps && labs(_arcX - arc._xEnd) <= 1 && labs(_arcY - arc._yEnd) <= 1)
+	{
+		dx = (int8_t)(arc._xEnd - _arcX);
+		dy = (int8_t)(arc._yEnd - _arcY);
+		_arcX = arc._xEnd;
+		_arcY = arc._yEnd;
+	}
+	else
+	{
+		SMovement::SArc::Next(_arcX, _arcY, _arcF, arc._clockwise, dx, dy);
+	}
+
+	DirCount_t stepcount = 0;
+	if (dx) stepcount += ((DirCount_t)(dx > 0 ? 9 : 1)) << (arc._axis0 * 4);
+	if (dy) stepcount += ((DirCount_t)(dy > 0 ? 9 : 1)) << (arc._axis1 * 4);
 
-	StartBackground();
+	return stepcount;
 }
 
+#endif
+
 ////////////////////////////////////////////////////////
 
-#if defined (stepperstatic_)
+#ifndef REDUCED_SIZE
 
-CStepper::SMovementState CStepper::_movementstate;
-CRingBufferQueue<CStepper::SStepBuffer, STEPBUFFERSIZE> CStepper::_steps;
-CStepper::SMovements CStepper::_movements;
-CStepper* CStepper::SMovement::_pStepper;
+unsigned long CStepper::SMovementState::GetMaxSpeedOverride(SMovement* pMovement)
+{
+	// faster than planned: max speed of axis and decelerate to the planned speed at the start of the "down" phase
+	// v^2 <= vplanned^2 + 2*a*s => ov^2 <= 1 + s * T^2/T0^2
+	// not calculated for each step: the limit is valid for a quarter of the remaining distance (s at the end of it)
+	// and uses the min timer of the "up" phase => the calculation is done about log(steps) times for a move
+	// the limit is the target of RampSpeedOverride (not a clamp) => the speed changes with the dec of the move at the range boundaries
 
-#endif
+	if (_n < _maxOverrideUntil)
+		return _maxOverride;
 
-////////////////////////////////////////////////////////
+	mdist_t downStartAt = pMovement->_pod._move._ramp._downStartAt;
+	if (_n >= downStartAt || pMovement->_state >= SMovement::StateDownDec)
+	{
+		_maxOverrideUntil = pMovement->_steps;
+		return _maxOverride = SpeedOverride100P << 8;
+	}
 
-void CStepper::SMovementState::Init(SMovement* pMovement)
-{
-	mdist_t steps = pMovement->_steps;
+	mdist_t s = downStartAt - _n;
+	mdist_t range = s / 4 + 1;
+	_maxOverrideUntil = _n + range;
+	s -= range;
 
-	if (pMovement->_state == SMovement::StateReadyMove)
+	unsigned long timer = min(_timer, pMovement->_pod._move._ramp._timerRun);
+	unsigned long maxOverride = 0xffff;
+
+	unsigned long r = (timer << 8) / pMovement->_pod._move._timerDec;		// T/T0 * 256
+	unsigned long sr = ((unsigned long)s) * r;
+	if (r < 256 && sr < 0x30000 / (r + 1))
 	{
-		_count = pMovement->GetMaxStepMultiplier();
-		_timer = pMovement->_pod._move._ramp._timerStart;
+		maxOverride = SpeedOverride100P * _ulsqrt(0x10000 + sr * r);	// sqrt(0x10000) = 256 => 100%
 	}
-	else
+
+	if (pMovement->_pod._move._timerOverrideMin != 0)
 	{
-		_count = 1;
-		_timer = pMovement->_pod._wait._timer;
+		unsigned long maxAxisOverride = MulDivU32(timer, SpeedOverride100P << 8, pMovement->_pod._move._timerOverrideMin);
+		if (maxAxisOverride < maxOverride)
+			maxOverride = maxAxisOverride;
 	}
-	
-	steps = (steps / _count) >> 1;
-	for (axis_t i = 0; i < NUM_AXIS; i++)
-		_add[i] = steps;
-	_n = 0;
-	_rest = 0;
-#ifndef REDUCED_SIZE
-	_sumTimer = 0;
-#endif
+
+	return _maxOverride = (unsigned short)max(maxOverride, (unsigned long)(SpeedOverride100P << 8));
 }
 
 ////////////////////////////////////////////////////////
 
-bool CStepper::SMovementState::CalcTimerAcc(timer_t maxtimer, mdist_t n, uint8_t cnt)
+void CStepper::SMovementState::RampSpeedOverride(SMovement* pMovement, uint8_t cnt)
 {
-	// use for float: Cn = Cn-1 - 2*Cn-1 / (4*N + 1)
-	// use for INTEGER:
-	// In = ((2*In-1)+Rn-1) / (4*N + 1)		=> quot
-	// Rn = ((2*In-1)+Rn-1) % (4*N + 1)		=> remainer of division
-	// Cn = Cn-1 - In
+	// change the speed override with the acceleration of the movement (a = v0^2/2, v0 => timerAcc)
+	// one step: dv = a/v => dov/ov = a/v^2 = T^2 / (2*T0^2)
 
-	if (maxtimer < _timer)
+	CStepper* pStepper = pMovement->_pStepper;
+	unsigned long target = ((unsigned long)(pMovement->_rapid ? pStepper->_pod._rapidoverride : pStepper->_pod._speedoverride)) << 8;
+	unsigned long current = _speedOverride;
+
+	if (target > (SpeedOverride100P << 8))
 	{
-		mudiv_t udivremainer = mudiv(_timer*(2 * cnt) + _rest, n * 4 + 2 - cnt);
-		_rest = udivremainer.rem;
-		_timer = _timer - udivremainer.quot;
-		if (maxtimer >= _timer)
-		{
-			_timer = maxtimer;
-			return true;
-		}
+#ifdef USE_BACKLASHBLEND
+		if (IsBacklashPending())
+			target = SpeedOverride100P << 8;		// interleaved backlash is planned for 100% (see QueueMove)
+		else
+#endif
+		target = min(target, GetMaxSpeedOverride(pMovement));
 	}
-	return false;
-}
 
-////////////////////////////////////////////////////////
+	if (target == current)
+		return;
 
-bool CStepper::SMovementState::CalcTimerDec(timer_t mintimer, mdist_t n, uint8_t cnt)
-{
-	// use for float: Cn = Cn-1 + 2*Cn-1 / (4*N - 1)
-	// use for INTEGER:
-	// In = ((2*In-1)+Rn-1) / (4*N - 1)		=> quot
-	// Rn = ((2*In-1)+Rn-1) % (4*N - 1)		=> remainer of division
-	// Cn = Cn-1 - In
+	timer_t timer0 = target > current ? pMovement->_pod._move._timerAcc : pMovement->_pod._move._timerDec;
+	unsigned long timer = MulDivU32(_timer, SpeedOverride100P << 8, current);
+	unsigned long diff;
 
-	if (mintimer > _timer)
+	if (timer >= timer0)
 	{
-		if (n <= 1)
-		{
-			_timer = mintimer;
-			return true;
-		}
-		mudiv_t udivremainer = mudiv(_timer*(2 * cnt) + _rest, n * 4 - 1 - cnt);
-		_rest = udivremainer.rem;
-		_timer = _timer + udivremainer.quot;
-		if (mintimer <= _timer)
-		{
-			_timer = mintimer;
-			return true;
-		}
+		// slower than v0 => no ramp
+		diff = target > current ? target - current : current - target;
 	}
-	return false;
+	else
+	{
+		unsigned long r = (timer << 8) / timer0;	// < 256
+		diff = ((((current * r) >> 8) * r) >> 9) * cnt + 1;
+	}
+
+	if (target > current)
+		_speedOverride = (unsigned short)min(target, current + diff);
+	else
+		_speedOverride = (unsigned short)(current > target + diff ? current - diff : target);
 }
 
+#endif
+
 ////////////////////////////////////////////////////////
 
 bool CStepper::SMovement::IsEndWait() const
@@ -1780,6 +3504,17 @@ bool CStepper::SMovement::CalcNextSteps(bool continues)
 		{
 			// End of move/wait/io
 
+#ifdef USE_BACKLASHBLEND
+			if (pState->IsBacklashPending())
+			{
+				// should not happen (see QueueMove), e.g. a stop: rest at backlash speed
+				pStepper->_steps.NextTail().Init(pState->BacklashStep(this));
+				pStepper->_steps.NextTail().Timer = max(pStepper->_pod._timerbacklash, pState->_backlashTimerMin);
+				pStepper->_steps.Enqueue();
+				continue;
+			}
+#endif
+
 			for (i = 0; i<NUM_AXIS; i++)
 			{
 				if (_distance_[i] != 0)
@@ -1803,6 +3538,7 @@ bool CStepper::SMovement::CalcNextSteps(bool continues)
 			{
 				register DirCount_t stepcount = 0;
 				register DirCount_t mask = 15;
+				register mdist_t steps = _steps << _smoothLevel;
 
 				if (_backlash)
 				{
@@ -1817,23 +3553,40 @@ bool CStepper::SMovement::CalcNextSteps(bool continues)
 					// Check overflow!
 					mdist_t oldadd = pState->_add[i];
 					pState->_add[i] += _distance_[i];
-					if (pState->_add[i] >= _steps || pState->_add[i] < oldadd)
+					if (pState->_add[i] >= steps || pState->_add[i] < oldadd)
 					{
-						pState->_add[i] -= _steps;
+						pState->_add[i] -= steps;
 						stepcount += mask&_dirCount;
 					}
 					if (i == NUM_AXIS - 1)
 						break;
 					mask *= 16;
 				}
+#ifdef USE_ARCMOVE
+				if (IsArc())
+				{
+					// replace (Bresenham) steps of axis0 and axis1 with the steps on the arc
+					stepcount &= ~((((DirCount_t)15) << (_arc._axis0 * 4)) | (((DirCount_t)15) << (_arc._axis1 * 4)));
+					stepcount += pState->ArcStep(this, n);
+				}
+#endif
 				pStepper->_steps.NextTail().Init(stepcount);
 			}
 		}
 
+#ifdef USE_ADVANCE
+		if (IsActiveMove() && _pod._move._advanceSteps != 0)
+			pState->Advance(this, pStepper->_steps.NextTail().DirStepCount);
+#endif
+
 		////////////////////////////////////
 		// calc new timer
 
-		if (_state == StateReadyMove)
+		if (pState->_subStep != 0)
+		{
+			// step smoothing: timer is calculated once for each step
+		}
+		else if (_state == StateReadyMove)
 		{
 			if (pState->_timer == _pod._move._ramp._timerRun)
 				_state = StateRun;
@@ -1874,49 +3627,109 @@ bool CStepper::SMovement::CalcNextSteps(bool continues)
 			{
 				if (n >= _pod._move._ramp._downStartAt)
 				{
-					pState->_rest = 0;
+					pState->StartRamp();
 					_state = _pod._move._ramp._timerStop > pState->_timer ? StateDownDec : StateDownAcc;
 				}
 			}
 
-			switch (_state)
+#ifdef USE_INPUTSHAPING
+			if (IsInputShaping())
 			{
-				case StateUpAcc:
+				// shaped ramp: timer from v(t)
+				if (_state != StateRun && pState->CalcTimerInputShaping(this, count) && _state < StateRun)
+					_state = StateRun;
+			}
+			else
+#endif
+			{
+#ifdef USE_SCURVE
+				// n of linear ramp
+				mdist_t nUp = _state < StateRun ? pState->SCurve(n, _pod._move._ramp._upSteps, _pod._move._ramp._upRampSteps, _pod._move._ramp._upTime, _pod._move._ramp._upK) : n;
+				mdist_t nDown = _state > StateRun ? _pod._move._ramp._downRampSteps - pState->SCurve(n - _pod._move._ramp._downStartAt, _pod._move._ramp._downSteps, _pod._move._ramp._downRampSteps, _pod._move._ramp._downTime, _pod._move._ramp._downK) : _steps - n;
+#else
+				mdist_t nUp = n;
+				mdist_t nDown = _steps - n;
+#endif
 
-					if (pState->CalcTimerAcc(_pod._move._ramp._timerRun, n + _pod._move._ramp._nUpOffset, count))
-					{
-						_state = StateRun;
-					}
-					break;
+				switch (_state)
+				{
+					case StateUpAcc:
 
-				case StateUpDec:
+						if (pState->CalcTimerAcc(_pod._move._ramp._timerRun, nUp + _pod._move._ramp._nUpOffset, count))
+						{
+							_state = StateRun;
+						}
+						break;
 
-					if (pState->CalcTimerDec(_pod._move._ramp._timerRun,_pod._move._ramp._nUpOffset - n,count))
-					{
-						_state = StateRun;
-					}
-					break;
+					case StateUpDec:
 
-				case StateDownDec:
+						if (pState->CalcTimerDec(_pod._move._ramp._timerRun,_pod._move._ramp._nUpOffset - nUp,count))
+						{
+							_state = StateRun;
+						}
+						break;
+
+					case StateDownDec:
 
-					pState->CalcTimerDec(_pod._move._ramp._timerStop, _steps - n + _pod._move._ramp._nDownOffset, count);
-					break;
+						pState->CalcTimerDec(_pod._move._ramp._timerStop, nDown + _pod._move._ramp._nDownOffset, count);
+						break;
 
-				case StateDownAcc:
+					case StateDownAcc:
 
-					pState->CalcTimerAcc(_pod._move._ramp._timerStop, _pod._move._ramp._nDownOffset - (_steps - n - 1), count);
-					break;
+						pState->CalcTimerAcc(_pod._move._ramp._timerStop, _pod._move._ramp._nDownOffset - (nDown - 1), count);
+						break;
 
+				}
 			}
 		}
 		
-		timer_t t = pState->_timer*count;
+		timer_t t;
+		if (_smoothLevel != 0)
+		{
+			// step smoothing: distribute timer to ISR calls of step
+			unsigned long timer = pState->_timer;
+			uint8_t subStep = pState->_subStep;
+			t = (timer_t)(((timer * (subStep + 1)) >> _smoothLevel) - ((timer * subStep) >> _smoothLevel));
+
+			pState->_subStep = (subStep + 1) & ((1 << _smoothLevel) - 1);
+			if (pState->_subStep != 0)
+				count = 0;								// same step (n)
+		}
+		else
+		{
+			t = pState->_timer*count;
+		}
+#ifdef USE_ARCMOVE
+		if (IsArc())
+		{
+			// constant speed on arc: timer is for distance 1, a step moves sqrt(1+(minor/major)^2) = r/max(|x|,|y|) (see ArcStep)
+			unsigned long tl = MulU15(t, pState->_arcScale);
+			t = tl >= TIMER1MAX ? TIMER1MAX : (timer_t)tl;
+		}
+#endif
+#ifdef USE_SCURVE
+		pState->_sCurveTime += t;
+#endif
 
 #ifndef REDUCED_SIZE
-		if (pStepper->GetSpeedOverride()!=CStepper::SpeedOverride100P)
+		// speed override (feed or rapid): ramp to the requested value while moving
+
+		unsigned short speedOverride = pState->_speedOverride;
+
+		if (_state >= StateUpAcc && _state <= StateDownAcc)
+		{
+			if (count != 0)
+			{
+				// faster => the max speed of axis and planned speed at end of move is the target of the ramp (see GetMaxSpeedOverride)
+				pState->RampSpeedOverride(this, count);
+				speedOverride = pState->_speedOverride;
+			}
+		}
+
+		if (speedOverride != (CStepper::SpeedOverride100P << 8))
 		{
 			// slower => increase timer
-			unsigned long tl = RoundMulDivU32(t, CStepper::SpeedOverride100P, pStepper->GetSpeedOverride());
+			unsigned long tl = RoundMulDivU32(t, CStepper::SpeedOverride100P << 8, speedOverride);
 			if (tl >= TIMER1MAX)	    t = TIMER1MAX;		// to slow
 			else if (tl < TIMER1MIN)    t = TIMER1MIN;		// to fast
 			else						t = (timer_t) tl;
@@ -1947,6 +3760,27 @@ bool CStepper::SMovement::CalcNextSteps(bool continues)
 		}
 #endif
 
+#ifdef USE_BACKLASHBLEND
+		if (pState->IsBacklashPending() && pState->Backlash(this))
+			continue;
+#endif
+
+#if STEPBUFFERMAXREPEAT > 0
+		// same step as last element => repeat it (run length)
+		// the consumer (StepOut) reads Repeat of the head => do not modify head or head+1
+
+		if (pStepper->_steps.Count() > 2)
+		{
+			SStepBuffer& tail = pStepper->_steps.Tail();
+			SStepBuffer& next = pStepper->_steps.NextTail();
+			if (tail.Repeat < STEPBUFFERMAXREPEAT && tail.Timer == next.Timer && tail.DirStepCount == next.DirStepCount)
+			{
+				tail.Repeat++;
+				continue;
+			}
+		}
+#endif
+
 		pStepper->_steps.Enqueue();
 	} while (continues);
 
@@ -2258,6 +4092,158 @@ void CStepper::MoveAbs(const udist_t d[NUM_AXIS], steprate_t vMax)
 
 ////////////////////////////////////////////////////////
 
+bool CStepper::IsInLimit(const udist_t d[NUM_AXIS]) const
+{
+	// same check as QueueAndSplitStep
+
+	if (_pod._limitCheck)
+	{
+		for (axis_t i = 0; i < NUM_AXIS; i++)
+		{
+			if ((long) d[i] > (long) GetLimitMax(i) || (long) d[i] < (long) GetLimitMin(i))
+				return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////
+
+#ifdef USE_ARCMOVE
+
+bool CStepper::ArcAbs(const udist_t d[NUM_AXIS], axis_t axis0, axis_t axis1, sdist_t center0, sdist_t center1, bool clockwise, steprate_t vMax)
+{
+	// circle (or helix) as one movement: each step of the movement is one step on the circle (axis0 or axis1 or both)
+	// return false if the arc can't be done as one movement (nothing queued) => caller must split into lines
+
+	_pod._error = 0;
+
+	if (IsSetBacklash() || axis0 == axis1)
+		return false;
+
+	SMovement::SArc arc;
+
+	arc._axis0 = axis0;
+	arc._axis1 = axis1;
+	arc._clockwise = clockwise;
+	arc._snapEnd = true;
+	arc._x = (sdist_t)_pod._calculatedpos[axis0] - center0;
+	arc._y = (sdist_t)_pod._calculatedpos[axis1] - center1;
+	arc._xEnd = (sdist_t)d[axis0] - center0;
+	arc._yEnd = (sdist_t)d[axis1] - center1;
+
+	if (labs(arc._x) >= 0x1000000 || labs(arc._y) >= 0x1000000)
+		return false;
+
+	// r = (int) sqrt(x^2+y^2) => f=x^2+y^2-r^2 is small (no overflow in ISR)
+
+	int64_t r2 = (int64_t)arc._x * arc._x + (int64_t)arc._y * arc._y;
+	int64_t r = (int64_t)sqrt((double)r2);
+	while (r * r > r2)				r--;
+	while ((r + 1) * (r + 1) <= r2)	r++;
+
+	if (r == 0)
+		return false;
+
+	arc._radius = (udist_t)r;
+	arc._f = (long)(r2 - r * r);
+	for (arc._radiusShift = 0; (arc._radius >> arc._radiusShift) >= 0x8000; arc._radiusShift++);
+	arc._invRadius = (1ul << 30) / (arc._radius >> arc._radiusShift);
+
+	// estimate steps: one step for each step of the "major" axis => between r*angle/sqrt(2) and r*angle
+
+	float angle0 = atan2((float)arc._y, (float)arc._x);
+	float angle1 = atan2((float)arc._yEnd, (float)arc._xEnd);
+	float angle = clockwise ? angle0 - angle1 : angle1 - angle0;
+	if (angle <= 0.0 || (arc._x == arc._xEnd && arc._y == arc._yEnd))
+		angle += (float)(2 * M_PI);
+
+	float maxSteps = r * angle + 8;
+	if (maxSteps >= MAXSTEPSPERMOVE)
+		return false;
+
+	float minSteps = r * angle * 0.6f - 2;
+
+	register axis_t i;
+	mdist_t dist[NUM_AXIS];
+	bool directionUp[NUM_AXIS];
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		directionUp[i] = d[i] >= _pod._calculatedpos[i];
+		dist[i] = (mdist_t)(directionUp[i] ? d[i] - _pod._calculatedpos[i] : _pod._calculatedpos[i] - d[i]);
+
+		if (_pod._limitCheck)
+		{
+			long minPos = (long)d[i];
+			long maxPos = (long)d[i];
+			if (i == axis0)			{ minPos = center0 - (long)r; maxPos = center0 + (long)r; }
+			else if (i == axis1)	{ minPos = center1 - (long)r; maxPos = center1 + (long)r; }
+
+			if (maxPos > (long)GetLimitMax(i) || minPos < (long)GetLimitMin(i))
+				return false;		// lines will check the limit
+		}
+	}
+
+	mdist_t steps = SMovement::CalcArcSteps(arc, minSteps < 1 ? 1 : (mdist_t)minSteps, (mdist_t)maxSteps);
+	if (steps == 0)
+		return false;				// end is not on the circle
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		if (i != axis0 && i != axis1 && dist[i] > steps)
+			return false;			// helix: linear axis must be slower
+	}
+
+	// tangent at start and end for the junction speed, scaled as a line with "steps"
+
+	sdist_t pos[2][2] = { { arc._x, arc._y }, { arc._xEnd, arc._yEnd } };
+	for (uint8_t end = 0; end < 2; end++)
+	{
+		sdist_t tx = clockwise ? pos[end][1] : -pos[end][1];
+		sdist_t ty = clockwise ? -pos[end][0] : pos[end][0];
+		udist_t major = max(labs(tx), labs(ty));
+		arc._tangent[end][0] = (mdist_t)RoundMulDivU32(labs(tx), steps, major);
+		arc._tangent[end][1] = (mdist_t)RoundMulDivU32(labs(ty), steps, major);
+		arc._tangentUp[end][0] = tx >= 0;
+		arc._tangentUp[end][1] = ty >= 0;
+	}
+
+	dist[axis0] = steps;
+	dist[axis1] = steps;
+	directionUp[axis0] = arc._tangentUp[0][0];
+	directionUp[axis1] = arc._tangentUp[0][1];
+
+	// speed is on the arc, no step multiplier (one step of axis0/axis1 per step of the move)
+
+	timer_t timerMax = vMax == 0 ? _pod._timerMaxDefault : SpeedToTimer(vMax);
+	if (timerMax < _pod._timerMaxDefault)				timerMax = _pod._timerMaxDefault;
+	if (timerMax < _pod._timerMax[axis0])				timerMax = _pod._timerMax[axis0];
+	if (timerMax < _pod._timerMax[axis1])				timerMax = _pod._timerMax[axis1];
+	if (timerMax < TIMER1VALUE(SPEED_MULTIPLIER_2))		timerMax = TIMER1VALUE(SPEED_MULTIPLIER_2);
+
+	for (i = 0; i < NUM_AXIS; i++)
+	{
+		_pod._calculatedpos[i] = d[i];
+	}
+
+#ifndef REDUCED_SIZE
+	_pod._totalSteps += steps;
+#endif
+
+	WaitUntilCanQueue();
+
+	_movements._queue.NextTail().InitArc(this, GetPrevMovement(_movements._queue.GetNextTailPos()), steps, dist, directionUp, timerMax, arc);
+
+	EnqueuAndStartTimer(true);
+
+	return true;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
 void CStepper::MoveRel(const sdist_t d[NUM_AXIS], steprate_t vMax)
 {
 	udist_t dist[NUM_AXIS];
@@ -2351,6 +4337,93 @@ void CStepper::MoveRelEx(steprate_t vMax, unsigned short axis, sdist_t d, ...)
 
 ////////////////////////////////////////////////////////
 
+#ifdef USE_STATUSSNAPSHOT
+
+void CStepper::GetCurrentPositions(udist_t pos[NUM_AXIS]) const
+{
+	// seqlock: the ISR (StepOut) increments _snapshotSeq before and after the update => copy again if the ISR was called while copying
+
+	uint8_t seq;
+	do
+	{
+		seq = _pod._snapshotSeq;
+		HALCompilerBarrier();
+		memcpy(pos, _pod._current, sizeof(_pod._current));
+		HALCompilerBarrier();
+	} while ((seq & 1) != 0 || seq != _pod._snapshotSeq);
+}
+
+////////////////////////////////////////////////////////
+
+udist_t CStepper::GetCurrentPosition(axis_t axis) const
+{
+	uint8_t seq;
+	udist_t pos;
+	do
+	{
+		seq = _pod._snapshotSeq;
+		HALCompilerBarrier();
+		pos = _pod._current[axis];
+		HALCompilerBarrier();
+	} while ((seq & 1) != 0 || seq != _pod._snapshotSeq);
+
+	return pos;
+}
+
+#endif
+
+////////////////////////////////////////////////////////
+
+void CStepper::GetStatusSnapshot(SStatusSnapshot& snapshot) const
+{
+	// single byte values (queue, state) are read without seqlock
+
+#ifdef USE_STATUSSNAPSHOT
+
+	uint8_t seq;
+	timer_t timer;
+	DirCount_t dirCount;
+	do
+	{
+		seq = _pod._snapshotSeq;
+		HALCompilerBarrier();
+		memcpy(snapshot._current, _pod._current, sizeof(_pod._current));
+		timer = _pod._snapshotTimer;
+		dirCount = _pod._snapshotDirCount;
+		HALCompilerBarrier();
+	} while ((seq & 1) != 0 || seq != _pod._snapshotSeq);
+
+#else
+
+	GetCurrentPositions(snapshot._current);
+
+#endif
+
+	snapshot._running = _pod._timerRunning;
+	snapshot._pause = _pod._pause;
+	snapshot._emergencyStop = _pod._emergencyStop;
+	snapshot._queued = _movements._queue.Count();
+	snapshot._speed = 0;
+
+#ifdef USE_STATUSSNAPSHOT
+	if (snapshot._running && timer != 0)
+	{
+		// fastest axis: max count (4 bit for each axis, see DirCount_t)
+
+		uint8_t count = 0;
+		for (axis_t i = 0; i < NUM_AXIS; i++)
+		{
+			uint8_t axiscount = dirCount & 7;
+			if (axiscount > count) count = axiscount;
+			dirCount /= 16;
+		}
+		snapshot._speed = TimerToSpeed(timer) * count;
+	}
+#endif
+}
+
+////////////////////////////////////////////////////////
+
 void CStepper::SetPosition(axis_t axis, udist_t pos)
 {
 	WaitBusy();
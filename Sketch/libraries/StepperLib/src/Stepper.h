@@ -24,6 +24,13 @@
 #include "RingBuffer.h"
 #include "Singleton.h"
 #include "UtilitiesStepperLib.h"
+#ifdef USE_ACCCURVE
+#include "LinearLookUp.h"
+#endif
+
+////////////////////////////////////////////////////////
+
+#define STEPFRACTION	256		// unit of distances below one step (junction deviation, curve tolerance): 1/256 steps
 
 ////////////////////////////////////////////////////////
 //
@@ -84,6 +91,20 @@ public:
 		SpeedOverrideMin = 1
 	};
 
+#ifdef USE_INPUTSHAPING
+	enum EInputShaper
+	{
+		InputShaperNone = 0,
+		InputShaperZV = 1,										// 2 impulses, duration 1/2 period
+		InputShaperZVD = 2,										// 3 impulses, duration 1 period, robust to frequency error
+		InputShaperMZV = 3										// 3 impulses, duration 3/4 period
+	};
+#endif
+
+#ifdef USE_ACCCURVE
+	typedef CLinearLookup<uint16_t, float, false> CAccCurve;	// speed of axis (steps/sec) => factor of acc/dec (1.0 = SetAcc/SetDec), table in RAM
+#endif
+
 	enum EDumpOptions		// use bit
 	{
 		DumpAll			= 0xff,
@@ -142,6 +163,9 @@ public:
 	
 	void SetSpeedOverride(EnumAsByte(ESpeedOverride) speed)		{ _pod._speedoverride = speed; }
 	EnumAsByte(ESpeedOverride) GetSpeedOverride()				{ return _pod._speedoverride; }
+	void SetRapidOverride(EnumAsByte(ESpeedOverride) speed)		{ _pod._rapidoverride = speed; }
+	EnumAsByte(ESpeedOverride) GetRapidOverride()				{ return _pod._rapidoverride; }
+	void SetRapidMove(bool rapid)								{ _pod._rapidMove = rapid; }		// following moves are rapid moves (G0) => rapid override
 
 	static uint8_t SpeedOverrideToP(EnumAsByte(ESpeedOverride) speed)	  {	return RoundMulDivU8((uint8_t) speed, 100, SpeedOverride100P);	}
 	static  EnumAsByte(ESpeedOverride) PToSpeedOverride(uint8_t speedP) { return (EnumAsByte(ESpeedOverride)) RoundMulDivU8(speedP, SpeedOverride100P, 100); }
@@ -149,7 +173,26 @@ public:
 	void SetUsual(steprate_t vMax);
 
 	void SetJerkSpeed(axis_t axis, steprate_t vMaxJerk)			{ _pod._maxJerkSpeed[axis] = vMaxJerk; }
+#ifdef USE_SCURVE
+	void SetMaxJerk(axis_t axis, unsigned long jerk)			{ _pod._maxJerk[axis] = jerk; }		// S-curve ramp: max change of acceleration in steps/sec^3, 0 => trapezoid ramp
+#endif
+#ifdef USE_INPUTSHAPING
+	void SetInputShaper(axis_t axis, EnumAsByte(EInputShaper) shaper, float frequency, float damping);	// acc/dec ramp convolved with the impulses of the shaper (resonance frequency in Hz, damping ratio), replaces S-curve, the speed change at a junction is not shaped
+#endif
+#ifdef USE_ACCCURVE
+	void SetAccCurve(axis_t axis, const CAccCurve::SLookupTable* table, uint8_t size)	{ _pod._accCurve[axis] = table; _pod._accCurveSize[axis] = size; }	// table sorted by speed, not copied, size 0 => constant acc/dec
+	float GetAccCurveFactor(axis_t axis, steprate_t speed) const;
+	timer_t GetAccCurveTimer(axis_t axis, timer_t timerAccDec, steprate_t speed) const;		// acc/dec timer (see SetAcc) scaled by the factor of the curve at speed
+#endif
+#ifdef USE_ADVANCE
+	void SetAdvance(axis_t axis, float k)						{ _pod._advanceAxis = axis; _pod._advanceK = k; }	// extruder axis leads by k*v steps (k in sec, v speed of axis), k=0 => off
+#endif
 	
+#ifdef USE_PLANNER2PASS
+	void SetPlanner2Pass(bool fullQueue)						{ _pod._planner2Pass = fullQueue; }	// false => incremental planner (stops at the first unchanged movement)
+	bool IsPlanner2Pass() const									{ return _pod._planner2Pass; }
+#endif
+
 	void SetWaitFinishMove(bool wait)                           { _pod._waitFinishMove = wait; };
 	bool IsWaitFinishMove() const								{ return _pod._waitFinishMove; }
 
@@ -165,6 +208,8 @@ public:
 
 	bool CanQueueMovement()	 const								{ return !_movements._queue.IsFull(); }
 	uint8_t QueuedMovements()	 const							{ return _movements._queue.Count(); }
+	uint8_t FreeMovements()	 const								{ return _movements._queue.FreeCount(); }
+	uint8_t GetOptimizedMovements() const						{ return _movements._optimizeCount; }	// entries recalculated by last OptimizeMovementQueue
 
 	uint8_t GetEnableTimeout(axis_t axis) const					{ return _pod._timeOutEnable[axis]; }
 	void SetEnableTimeout(axis_t axis, uint8_t sec) 			{ _pod._timeOutEnable[axis] = sec; }
@@ -182,6 +227,17 @@ public:
 
 	void SetBacklash(axis_t axis, mdist_t dist)					{ _pod._backlash[axis] = dist; }
 
+#ifndef REDUCED_SIZE
+	void SetMergeTolerance(mdist_t tolerance)					{ _pod._mergeTolerance = tolerance; }	// merge collinear moves into the (not started) tail of the queue, max deviation in steps, 0 => off
+	mdist_t GetMergeTolerance() const							{ return _pod._mergeTolerance; }
+
+	void SetCurveTolerance(udist_t tolerance)					{ _pod._curveTolerance = tolerance; }	// junction speed of curves by centripetal acceleration, max deviation of segments to the curve in 1/STEPFRACTION steps, 0 => off
+	udist_t GetCurveTolerance() const							{ return _pod._curveTolerance; }
+	void SetArcRadius(udist_t radius)							{ _pod._arcRadius = radius; }			// following moves are segments of an arc (radius in steps), 0 => no arc
+	void SetJunctionDeviation(udist_t deviation)				{ _pod._junctionDeviation = deviation; }	// junction speed by deviation (1/STEPFRACTION steps) and acceleration instead of max jerk, 0 => max jerk
+	udist_t GetJunctionDeviation() const						{ return _pod._junctionDeviation; }
+#endif
+
 	void StopMove(steprate_t v0Dec=0);							// Stop all pendinge/current moves, WITH dec ramp, clear buffer
 	void AbortMove();											// Abort all pendinge/current moves, NO dec ramp, clear buffer
 
@@ -206,6 +262,9 @@ public:
 	//////////////////////////////
 
 	void MoveAbs(const udist_t d[NUM_AXIS], steprate_t vMax = 0);
+#ifdef USE_ARCMOVE
+	bool ArcAbs(const udist_t d[NUM_AXIS], axis_t axis0, axis_t axis1, sdist_t center0, sdist_t center1, bool clockwise, steprate_t vMax = 0);	// false => not possible, use lines
+#endif
 	void MoveRel(const sdist_t d[NUM_AXIS], steprate_t vMax = 0);
 
 	void MoveAbs(axis_t axis, udist_t d, steprate_t vMax = 0);
@@ -225,10 +284,28 @@ public:
 	void GetPositions(udist_t pos[NUM_AXIS]) const				{ memcpy(pos, _pod._calculatedpos, sizeof(_pod._calculatedpos)); }
 	udist_t GetPosition(axis_t axis) const						{ return _pod._calculatedpos[axis]; }
 
+	struct SStatusSnapshot
+	{
+		udist_t		_current[NUM_AXIS];								// position (steps)
+		steprate_t	_speed;											// steps/sec of the fastest axis (last step), 0 if not running (or no USE_STATUSSNAPSHOT)
+		uint8_t		_queued;										// movements in queue
+		bool		_running;
+		bool		_pause;
+		bool		_emergencyStop;
+	};
+
+	void GetStatusSnapshot(SStatusSnapshot& snapshot) const;	// USE_STATUSSNAPSHOT: no critical region (seqlock with the ISR), may be polled at any rate
+
+#ifdef USE_STATUSSNAPSHOT
+	void GetCurrentPositions(udist_t pos[NUM_AXIS]) const;
+	udist_t GetCurrentPosition(axis_t axis) const;
+#else
 	void GetCurrentPositions(udist_t pos[NUM_AXIS]) const		{ CCriticalRegion crit; memcpy(pos, _pod._current, sizeof(_pod._current)); }
 	udist_t GetCurrentPosition(axis_t axis) const				{ CCriticalRegion crit; return (*((volatile udist_t*)&_pod._current[axis])); }
+#endif
 
 	udist_t GetLimitMax(axis_t axis) const						{ return _pod._limitMax[axis]; }
+	bool IsInLimit(const udist_t d[NUM_AXIS]) const;			// absolute position is in range (if limit check is on)
 #ifdef REDUCED_SIZE
 	udist_t GetLimitMin(axis_t ) const							{ return 0; }
 #else
@@ -243,6 +320,16 @@ public:
 	steprate_t GetAcc(axis_t axis) const						{ return TimerToSpeed(_pod._timerAcc[axis]); }
 	steprate_t GetDec(axis_t axis) const						{ return TimerToSpeed(_pod._timerDec[axis]); }
 	steprate_t GetJerkSpeed(axis_t axis) const					{ return _pod._maxJerkSpeed[axis]; }
+#ifdef USE_SCURVE
+	unsigned long GetMaxJerk(axis_t axis) const					{ return _pod._maxJerk[axis]; }
+#endif
+#ifdef USE_INPUTSHAPING
+	EnumAsByte(EInputShaper) GetInputShaper(axis_t axis) const	{ return _pod._inputShaper[axis]._shaper; }
+#endif
+#ifdef USE_ADVANCE
+	axis_t GetAdvanceAxis() const								{ return _pod._advanceAxis; }
+	float GetAdvance() const									{ return _pod._advanceK; }
+#endif
 
 #ifndef REDUCED_SIZE
 	unsigned long GetTotalSteps() const							{ return _pod._totalSteps; }
@@ -274,6 +361,10 @@ private:
 
 	void QueueMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NUM_AXIS], timer_t timerMax, uint8_t stepmult);
 	void QueueWait(const mdist_t dist, timer_t timerMax, bool checkCondition);
+#ifndef REDUCED_SIZE
+	bool MergeMove(const mdist_t dist[NUM_AXIS], const bool directionUp[NUM_AXIS], axisArray_t directionmask, axisArray_t direction, timer_t timerMax);
+	void AddMergePoint(const mdist_t point[NUM_AXIS]);
+#endif
 
 	void EnqueuAndStartTimer(bool waitfinish);
 	void WaitUntilCanQueue();
@@ -285,7 +376,7 @@ private:
 		return (sdist_t)current - (sdist_t)dist;
 	}
 
-	inline void StepOut();
+	inline bool StepOut();										// return false if head of step buffer is repeated
 	inline void StartBackground();
 	inline void FillStepBuffer();
 	void Background();
@@ -305,6 +396,12 @@ protected:
 
 	debugvirtula void StepRequest(bool isr);
 	debugvirtula void OptimizeMovementQueue(bool force);
+#ifdef USE_PLANNER2PASS
+	void PlanMovementQueue();
+#endif
+#ifdef USE_BACKLASHBLEND
+	timer_t GetBacklashTimerMin(axisArray_t axes) const;										// min timer of an interleaved backlash step (max speed of axes)
+#endif
 
 	////////////////////////////////////////////////////////
 
@@ -320,6 +417,10 @@ protected:
 
 	static mdist_t GetSteps(timer_t timer1, timer_t timer2, timer_t timerstart, timer_t timerstop);		// from v1 to v2 (v1<v2 uses acc, dec otherwise)
 
+#ifdef USE_RAMPTABLE
+	static rampfactor_t GetRampFactor(mdist_t n);												// base ramp: timer(n)/timer(0) with 1.0 = 1<<RAMPFACTORBITS
+#endif
+
 	unsigned long GetAccelerationFromTimer(mdist_t timerV0);
 	unsigned long GetAccelerationFromSpeed(steprate_t speedV0)									{ return GetAccelerationFromSpeed(SpeedToTimer(speedV0)); }
 
@@ -330,6 +431,17 @@ protected:
 
 protected:
 
+#ifdef USE_INPUTSHAPING
+	struct SInputShaper												// impulses of shaper, see SetInputShaper
+	{
+		EnumAsByte(EInputShaper) _shaper;
+		uint8_t			_count;										// number of impulses (0 => no input shaping)
+		unsigned short	_a[3];										// amplitude, sum = 0x8000
+		unsigned long	_t[3];										// time of impulse in timer ticks, _t[0] = 0
+		unsigned long	_tMean;										// sum(a*t) => shift of the ramp center
+	};
+#endif
+
 	//////////////////////////////////////////
 	// often accessed members first => is faster
 	// even size of struct and 2byte alignement
@@ -344,6 +456,9 @@ protected:
 
 		bool			_waitFinishMove;
 		bool			_limitCheck;
+#ifdef USE_PLANNER2PASS
+		bool			_planner2Pass;								// plan the full queue each time
+#endif
 
 		timer_t			_timerbacklash;								// -1 or 0 for temporary enable/disable backlash without setting _backlash to 0
 
@@ -355,15 +470,34 @@ protected:
 		timer_t			_timerMaxDefault;							// timervalue of vMax (if vMax = 0)
 
 		udist_t			_current[NUM_AXIS];							// update in ISR
+#ifdef USE_STATUSSNAPSHOT
+		volatile uint8_t _snapshotSeq;								// seqlock of _current, _snapshotTimer and _snapshotDirCount: odd while the ISR writes
+		timer_t			_snapshotTimer;								// timer of the last step => speed
+		DirCount_t		_snapshotDirCount;							// steps of each axis of the last step
+#endif
 		udist_t			_calculatedpos[NUM_AXIS];					// calculated in advanced (use movement queue)
 
 		uint8_t			_referenceHitValue[NUM_REFERENCE];			// each axis min and max - used in ISR LOW,HIGH, 255(not used)
 
 		steprate_t		_maxJerkSpeed[NUM_AXIS];					// immediate change of speed without ramp (in junction)
+#ifdef USE_SCURVE
+		unsigned long	_maxJerk[NUM_AXIS];							// S-curve: max change of acceleration (steps/sec^3)
+#endif
+#ifdef USE_INPUTSHAPING
+		SInputShaper	_inputShaper[NUM_AXIS];
+#endif
 
 		timer_t			_timerMax[NUM_AXIS];						// maximum speed of axis
 		timer_t			_timerAcc[NUM_AXIS];						// acc timer start
 		timer_t			_timerDec[NUM_AXIS];						// dec timer start
+#ifdef USE_ACCCURVE
+		const CAccCurve::SLookupTable* _accCurve[NUM_AXIS];			// acc/dec factor depending on the speed of the axis (torque curve)
+		uint8_t			_accCurveSize[NUM_AXIS];
+#endif
+#ifdef USE_ADVANCE
+		axis_t			_advanceAxis;								// extruder axis
+		float			_advanceK;									// lead of extruder in sec (0 => off)
+#endif
 
 #ifndef REDUCED_SIZE
 		udist_t			_limitMin[NUM_AXIS];
@@ -372,11 +506,20 @@ protected:
 
 		mdist_t			_backlash[NUM_AXIS];						// backlash of each axis (signed mdist_t/2)
 
+#ifndef REDUCED_SIZE
+		mdist_t			_mergeTolerance;							// merge collinear moves, max deviation in steps (0 => off)
+		udist_t			_curveTolerance;							// junction of curves, max deviation in 1/STEPFRACTION steps (0 => off)
+		udist_t			_arcRadius;									// radius of queued arc segments (0 => no arc)
+		udist_t			_junctionDeviation;							// junction deviation model, in 1/STEPFRACTION steps (0 => max jerk)
+#endif
+
 		unsigned long	_timerStartOrOnIdle;						// timervalue if library start move or goes to Idle
 		unsigned long	_timerLastCheckEnable;						// timervalue
 
 		uint8_t	_idleLevel;											// level if idle (0..100)
 		volatile EnumAsByte(ESpeedOverride)	_speedoverride;			// Speed override, 128 => 100% (change in irq possible)
+		volatile EnumAsByte(ESpeedOverride)	_rapidoverride;			// Speed override of rapid moves
+		bool			_rapidMove;									// queue moves as rapid moves
 
 		axisArray_t		_lastdirection;								// for backlash
 		axisArray_t		_invertdirection;							// invert direction
@@ -393,7 +536,7 @@ protected:
 #endif
 
 		bool		_pause;											// PauseMove is called
-		bool		_dummy;	
+		uint8_t		_stepRepeat;									// steps done of repeat of step buffer head (ISR)
 
 	} _pod;
 
@@ -431,6 +574,12 @@ protected:
 
 		EnumAsByte(EMovementState) _state;						// emums are 16 bit in gcc => force byte
 		bool		_backlash;									// move is backlash
+#ifdef USE_BACKLASHBLEND
+		axisArray_t	_backlashAxes;								// backlash of axes is taken up while moving (interleaved steps, see SMovementState::Backlash)
+#endif
+		bool		_optimized;									// planner watermark: start speed is final (limited by acc from head), previous moves need no optimize
+		uint8_t		_smoothLevel;								// step smoothing: 1<<_smoothLevel ISR calls per step (Bresenham of all axes)
+		bool		_rapid;										// use rapid override
 
 		DirCount_t	_dirCount;
 		DirCount_t	_lastStepDirCount;
@@ -450,6 +599,33 @@ protected:
 			mdist_t _nUpOffset;									// offset of n rampe calculation(acc) 
 			mdist_t _nDownOffset;								// offset of n rampe calculation(dec)
 
+#ifdef USE_ACCCURVE
+			timer_t _upTimerAccDec;								// acc/dec of the phase with the torque curve (see GetAccCurveTimer)
+			timer_t _downTimerAccDec;
+#endif
+
+#ifdef USE_SCURVE
+			// S-curve: v(t) = v0 + (v1-v0) * smoothstep(t/T), _upSteps/_downSteps are stretched
+			mdist_t _upRampSteps;								// steps of the linear (trapezoid) ramp, equal to _upSteps if no S-curve
+			mdist_t _downRampSteps;
+			unsigned long _upTime;								// T in timer ticks
+			unsigned long _downTime;
+			unsigned short _upK;								// 2*v0/(v0+v1), 1.0 = 0x8000
+			unsigned short _downK;
+#ifdef USE_INPUTSHAPING
+			steprate_t _upV0;									// input shaping: v0 and v1 of phase, 0 => standstill
+			steprate_t _upV1;
+			steprate_t _downV0;
+			steprate_t _downV1;
+#endif
+
+			void SCurve(SMovement* pMovement, mdist_t upRampSteps, mdist_t downRampSteps);
+			bool IsSameUp(const SRamp& ramp) const				{ return _timerStart == ramp._timerStart && _timerRun == ramp._timerRun && _upSteps == ramp._upSteps && _nUpOffset == ramp._nUpOffset && _upTime == ramp._upTime && _upK == ramp._upK; }
+#endif
+#ifdef USE_INPUTSHAPING
+			void CutInputShaping(SMovement* pMovement, mdist_t upRampSteps, mdist_t downRampSteps);
+#endif
+
 			void RampUp(SMovement* pMovement, timer_t timerRun, timer_t timerJunction);
 			void RampDown(SMovement* pMovement, timer_t timerJunction);
 			void RampRun(SMovement* pMovement);
@@ -470,6 +646,20 @@ protected:
 
 				timer_t _timerAcc;										// timer for calc of acceleration while "up" state - depend on axis
 				timer_t _timerDec;										// timer for calc of decelerating while "down" state - depend on axis
+				timer_t _timerOverrideMin;								// min timer with speed override (max speed of axis)
+#ifndef REDUCED_SIZE
+				udist_t _radius;										// move is a segment of an arc with radius (steps), 0 => unknown
+#endif
+#ifdef USE_SCURVE
+				unsigned long _jerk;									// S-curve: max jerk of movement (steps/sec^3), 0 => trapezoid
+#endif
+#ifdef USE_INPUTSHAPING
+				const SInputShaper* _inputShaper;						// shaper of the axis with the longest shaper, NULL => no input shaping
+#endif
+#ifdef USE_ADVANCE
+				unsigned long _advanceScale;							// k*TIMER1FREQUENCE*d/steps => lead (steps) = _advanceScale/timer
+				mdist_t _advanceSteps;									// steps of extruder axis (up), 0 => no advance
+#endif
 			} _move;
 
 			struct SWait
@@ -482,6 +672,28 @@ protected:
 
 		} _pod;
 
+#ifdef USE_ARCMOVE
+		struct SArc												// circular move in plane axis0/axis1, one step of axis0 or axis1 (or both) for each step of the move
+		{
+			sdist_t _x;											// start, relative to center
+			sdist_t _y;
+			sdist_t _xEnd;										// end, relative to center
+			sdist_t _yEnd;
+			long	_f;											// x^2+y^2-r^2 of start
+			udist_t _radius;									// 0 => no arc
+			unsigned long _invRadius;							// (1<<30)/(_radius>>_radiusShift) => timer of step without division
+			uint8_t	_radiusShift;
+			axis_t	_axis0;
+			axis_t	_axis1;
+			bool	_clockwise;
+			bool	_snapEnd;									// last step moves to end (false for stop)
+			mdist_t	_tangent[2][2];								// tangent at [start,end] of [axis0,axis1] scaled to _steps => junction speed
+			bool	_tangentUp[2][2];
+
+			static void Next(sdist_t& x, sdist_t& y, long& f, bool clockwise, int8_t& dx, int8_t& dy);
+		} _arc;
+#endif
+
 		stepperstatic CStepper* _pStepper;						// give access to stepper (not static if multiinstance)  
 
 		timer_t GetUpTimerAcc()									{ return _pod._move._timerAcc; }
@@ -493,18 +705,63 @@ protected:
 		timer_t GetUpTimer(bool acc)							{ return acc ? GetUpTimerAcc() : GetUpTimerDec(); }
 		timer_t GetDownTimer(bool acc)							{ return acc ? GetDownTimerAcc() : GetDownTimerDec(); }
 
+#ifdef USE_ACCCURVE
+		timer_t GetAccCurveTimer(timer_t timerAccDec, bool acc, timer_t timer0, timer_t timer1);	// acc/dec of a ramp phase (timer0 => timer1) at its mid speed
+#endif
+
+#ifdef USE_SCURVE
+#ifdef USE_INPUTSHAPING
+		bool IsInputShaping() const								{ return _pod._move._inputShaper != NULL; }
+		bool IsSCurve() const									{ return _pod._move._jerk != 0 || IsInputShaping(); }
+#else
+		bool IsSCurve() const									{ return _pod._move._jerk != 0; }
+#endif
+		float GetSCurveRampSteps(float v0, float v1, float acc);								// steps of S-curve (input shaping: acc of linear ramp)
+		mdist_t GetSCurveSteps(mdist_t rampSteps, timer_t timer0, timer_t timer1);				// stretch linear ramp (v0 to v1)
+		timer_t GetTimerSCurve(mdist_t steps, timer_t timerv0, timer_t timerAccDec);			// calc "speed" after steps accelerating with S-curve
+
+		timer_t GetTimer(mdist_t steps, timer_t timerstart)										{ return IsSCurve() ? GetTimerSCurve(steps, (timer_t)-1, timerstart) : _pStepper->GetTimer(steps, timerstart); }
+		timer_t GetTimerAccelerating(mdist_t steps, timer_t timerv0, timer_t timerstart)		{ return IsSCurve() ? GetTimerSCurve(steps, timerv0, timerstart) : _pStepper->GetTimerAccelerating(steps, timerv0, timerstart); }
+#else
+		timer_t GetTimer(mdist_t steps, timer_t timerstart)										{ return _pStepper->GetTimer(steps, timerstart); }
+		timer_t GetTimerAccelerating(mdist_t steps, timer_t timerv0, timer_t timerstart)		{ return _pStepper->GetTimerAccelerating(steps, timerv0, timerstart); }
+#endif
+
 		mdist_t GetDistance(axis_t axis);
 		uint8_t GetStepMultiplier(axis_t axis)					{ return (_dirCount >> (axis * 4)) % 8; }
 		bool GetDirectionUp(axis_t axis)						{ return ((_dirCount >> (axis * 4)) & 8) != 0; }
 		uint8_t GetMaxStepMultiplier();
 
+#ifdef USE_ARCMOVE
+		bool IsArc() const										{ return _arc._radius != 0; }
+		mdist_t GetJunctionDistance(axis_t axis, bool end);		// distance and direction of axis at start or end of move
+		bool GetJunctionDirectionUp(axis_t axis, bool end);
+
+		static mdist_t CalcArcSteps(const SArc& arc, mdist_t minSteps, mdist_t maxSteps);	// 0 => end not reached
+#else
+		mdist_t GetJunctionDistance(axis_t axis, bool /* end */)	{ return GetDistance(axis); }
+		bool GetJunctionDirectionUp(axis_t axis, bool /* end */)	{ return GetDirectionUp(axis); }
+#endif
+
 		bool Ramp(SMovement*mvNext);
 
 		void CalcMaxJunktionSpeed(SMovement*mvNext);
+#ifndef REDUCED_SIZE
+		float GetJunctionCos(SMovement*mvPrev, float& len1, float& len2);		// cos of angle between moves
+		timer_t GetJunctionTimer(SMovement*mvPrev, float v, timer_t timerMaxJunctionAcc);	// v: speed on path
+		bool CalcCurveJunctionTimer(SMovement*mvPrev, timer_t timerMaxJunctionAcc, timer_t& timer);
+		timer_t CalcJunctionDeviationTimer(SMovement*mvPrev, timer_t timerMaxJunctionAcc);
+#endif
 
 		bool AdjustJunktionSpeedT2H(SMovement*mvPrev, SMovement*mvNext);
 		void AdjustJunktionSpeedH2T(SMovement*mvPrev, SMovement*mvNext);
 
+		timer_t GetTimerEndPossible(timer_t timerv0, timer_t timerAccDec);		// fastest speed at the end of the move (start with timerv0)
+#ifdef USE_PLANNER2PASS
+		timer_t GetTimerPlanned(timer_t timerv0, timer_t timerAccDec);
+		timer_t PlanJunktionSpeedT2H(SMovement*mvPrev, timer_t timerEnd);
+#endif
+
 		bool CalcNextSteps(bool continues);
 
 	private:
@@ -534,8 +791,14 @@ protected:
 		void InitIoControl(CStepper*pStepper, uint8_t tool, unsigned short level);
 
 		void InitStop(SMovement* mvPrev, timer_t timer, timer_t dectimer);
+#ifdef USE_ARCMOVE
+		void InitArc(CStepper*pStepper, SMovement* mvPrev, mdist_t steps, const mdist_t dist[NUM_AXIS], const bool directionUp[NUM_AXIS], timer_t timerMax, const SArc& arc);
+#endif
 
 		void SetBacklash()										{ _backlash = true; }
+#ifdef USE_BACKLASHBLEND
+		void SetBacklash(axisArray_t axes)						{ _backlashAxes = axes; }
+#endif
 
 		void Dump(uint8_t queueidx, uint8_t options);
 
@@ -548,7 +811,22 @@ protected:
 	struct SMovements
 	{
 		timer_t _timerStartPossible;							// timer for fastest possible start (break at the end)
+		uint8_t _optimizeCount;									// entries recalculated by last OptimizeMovementQueue
 		CRingBufferQueue<SMovement, MOVEMENTBUFFERSIZE>	_queue;
+
+#ifndef REDUCED_SIZE
+		struct SMerge											// last QueueMove, collinear moves are merged into this tail
+		{
+			uint8_t		_idx;									// queue position of tail, 255 => no merge possible
+			axisArray_t	_directionmask;
+			axisArray_t	_direction;
+			timer_t		_timerMax;
+			axis_t		_lead;									// axis with max steps of the merged moves
+			float		_slopeMin[NUM_AXIS];					// each junction point is within the tolerance of a line (from start) with dist[i]/dist[lead] in range
+			float		_slopeMax[NUM_AXIS];
+			mdist_t		_dist[NUM_AXIS];						// sum of merged moves
+		} _merge;
+#endif
 	};
 
 	stepperstatic struct SMovements _movements;
@@ -569,18 +847,78 @@ protected:
 		timer_t _rest;			// rest of rampcalculation
 
 		uint8_t _count;	// increment of _n
-		char _dummyalign;
+		uint8_t _subStep;		// step smoothing: ISR call within step (0..(1<<_smoothLevel)-1)
 
 #ifndef REDUCED_SIZE
 		unsigned long _sumTimer;	// for debug
+		unsigned short _speedOverride;	// current speed override (128<<8 => 100%), ramped to the requested override
+		unsigned short _maxOverride;	// max speed override (see GetMaxSpeedOverride), valid for _n < _maxOverrideUntil
+		mdist_t _maxOverrideUntil;
 #endif
 
 		mdist_t _add[NUM_AXIS];
 
+#ifdef USE_ARCMOVE
+		sdist_t _arcX;			// position on arc, relative to center
+		sdist_t _arcY;
+		long	_arcF;			// x^2+y^2-r^2
+		sdist_t _arcMajor;		// max(|x|,|y|) of last step => timer of step (constant speed on arc)
+		unsigned short _arcScale;	// r/_arcMajor as 1.15 fixed point
+
+		DirCount_t ArcStep(SMovement* pMovement, mdist_t n);
+#endif
+
+#ifdef USE_RAMPTABLE
+		rampscale_t _rampScale;	// timer of ramp (base table) - 0 if not calculated for current acc/dec phase
+
+#ifdef USE_SCURVE
+		unsigned long _sCurveTime;	// time (timer ticks) since start of current acc/dec phase
+		rampscale_t _sCurveInvTime;	// (1<<30)/T of current S-curve phase - 0 if not calculated
+
+		void StartRamp()									{ _rampScale = 0; _sCurveTime = 0; _sCurveInvTime = 0; }
+		mdist_t SCurve(mdist_t n, mdist_t steps, mdist_t rampSteps, unsigned long time, unsigned short k);
+#ifdef USE_INPUTSHAPING
+		unsigned long _shapingRampTime;	// Ta = T - t[last] of current phase, with _sCurveInvTime
+		unsigned long _shapingStopAcc;	// acc of the last impulse (steps/sec^2) at a stop
+
+		void StartInputShaping(SMovement* pMovement, bool up);
+		bool CalcTimerInputShaping(SMovement* pMovement, uint8_t cnt);
+		unsigned long GetInputShapingSpeed(SMovement* pMovement, bool up, unsigned long t) const;
+#endif
+#else
+		void StartRamp()									{ _rampScale = 0; }
+#endif
+		timer_t GetRampTimer(mdist_t n) const;
+#else
+		void StartRamp()									{ _rest = 0; }
+#endif
+
 		void Init(SMovement* pMovement);
 
+#ifdef USE_BACKLASHBLEND
+		mdist_t _backlashN;			// backlash steps done
+		mdist_t _backlashSteps;		// max backlash of axes
+		unsigned long _backlashTime;// time since last backlash step
+		timer_t _backlashTimerMin;	// half of the split step not faster than the max speed of the axes
+
+		bool IsBacklashPending() const						{ return _backlashN < _backlashSteps; }
+		DirCount_t BacklashStep(SMovement* pMovement);
+		bool Backlash(SMovement* pMovement);
+#endif
+
+#ifdef USE_ADVANCE
+		mdist_t _advance;			// current lead of the extruder axis (steps), kept for a following extruding movement
+		mdist_t _advanceRemaining;	// steps of extruder axis not added to the step buffer
+
+		void Advance(SMovement* pMovement, DirCount_t& dirCount);
+#endif
+
 		bool CalcTimerAcc(timer_t maxtimer, mdist_t n, uint8_t cnt);
 		bool CalcTimerDec(timer_t mintimer, mdist_t n, uint8_t cnt);
+#ifndef REDUCED_SIZE
+		void RampSpeedOverride(SMovement* pMovement, uint8_t cnt);
+		unsigned long GetMaxSpeedOverride(SMovement* pMovement);
+#endif
 
 	public:
 
@@ -597,6 +935,7 @@ protected:
 	public:
 		DirCount_t		DirStepCount;								// direction and count
 		timer_t			Timer;
+		uint8_t			Repeat;										// additional identical steps (run length)
 #ifdef _MSC_VER
 		mdist_t			_distance[NUM_AXIS];						// to calculate relative speed
 		mdist_t			_steps;
@@ -609,10 +948,17 @@ protected:
 		{
 			Timer		 = 0;
 			DirStepCount = dirCount;
+			Repeat		 = 0;
 		};
 	};
 
-	stepperstatic CRingBufferQueue<SStepBuffer, STEPBUFFERSIZE>	_steps;
+#ifdef USE_SPSC_STEPBUFFER
+	typedef CRingBufferQueueSPSC<SStepBuffer, STEPBUFFERSIZE> SStepBufferQueue;		// producer: CalcNextSteps, consumer: StepOut (ISR)
+#else
+	typedef CRingBufferQueue<SStepBuffer, STEPBUFFERSIZE> SStepBufferQueue;
+#endif
+
+	stepperstatic SStepBufferQueue	_steps;
 
 public:
 
@@ -656,6 +1002,18 @@ protected:
 	virtual void  StepEnd() {};
 #endif
 
+#ifdef STEPPERPROFILE
+	enum EProfileSection
+	{
+		ProfileStepOut,											// ISR: output of one step
+		ProfileCalcNextSteps,									// background: fill the step buffer
+		ProfileSectionCount
+	};
+
+	virtual void  ProfileBegin(EnumAsByte(EProfileSection) /* section */) {};
+	virtual void  ProfileEnd(EnumAsByte(EProfileSection) /* section */, uint8_t /* steps */) {};	// steps: entries added/removed to/from the step buffer
+#endif
+
 	virtual void  Step(const uint8_t steps[NUM_AXIS], axisArray_t directionUp) = 0;
 
 private: